@@ -0,0 +1,324 @@
+/*
+ * bloom.cpp
+ *
+ * The glow around the lights. The bright parts of the city are drawn into
+ * a texture through a framebuffer object, then shrunk to half size keeping
+ * only what's bright enough to glow, then blurred with a Gaussian, once
+ * across and once down. What comes out is added over the finished frame
+ * in a single pass. The old way of smearing the city across the screen
+ * with a few dozen offset copies is still used when the driver can't do
+ * framebuffer objects or shaders.
+ *
+ * Rather than drawing the city a second time just for the glow, the glow
+ * can also come from a shrunken copy of the frame itself, when that was
+ * drawn offscreen (see frame.cpp).
+ *
+ */
+
+#include "bloom.hpp"
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+#include "glext.hpp"
+
+#define BLUR_SIZE 256
+// About what the few dozen offset copies of the old way added up to
+#define BLOOM_GAIN 2.5f
+
+static bool ready;
+static GLuint source_fbo;
+static GLuint source_depth;
+static GLuint source_texture;
+static int source_size;
+static GLuint blur_fbo[2];
+static GLuint blur_texture[2];
+static GLuint bright_program;
+static GLuint blur_program;
+static GLint blur_offset;
+static GLint blur_gain;
+
+static char const *quad_vertex =
+    "varying vec2 uv;\n"
+    "void main()\n"
+    "{\n"
+    "    uv = gl_MultiTexCoord0.xy;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+// Sampling between four texels averages them, so this shrinks the image
+// by half on its way through.
+static char const *bright_fragment =
+    "uniform sampler2D image;\n"
+    "varying vec2 uv;\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 c = texture2D(image, uv).rgb;\n"
+    "    float peak = max(c.r, max(c.g, c.b));\n"
+    "    gl_FragColor = vec4(c * smoothstep(0.05, 0.5, peak), 1.0);\n"
+    "}\n";
+
+// Nine taps, folded into five by sampling between texel pairs
+static char const *blur_fragment =
+    "uniform sampler2D image;\n"
+    "uniform vec2 offset;\n"
+    "uniform float gain;\n"
+    "varying vec2 uv;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 near = offset * 1.3846154;\n"
+    "    vec2 far = offset * 3.2307692;\n"
+    "    vec3 sum = texture2D(image, uv).rgb * 0.2270270;\n"
+    "    sum += texture2D(image, uv + near).rgb * 0.3162162;\n"
+    "    sum += texture2D(image, uv - near).rgb * 0.3162162;\n"
+    "    sum += texture2D(image, uv + far).rgb * 0.0702703;\n"
+    "    sum += texture2D(image, uv - far).rgb * 0.0702703;\n"
+    "    gl_FragColor = vec4(sum * gain, 1.0);\n"
+    "}\n";
+
+static void target_texture(GLuint texture, int width, int height)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGBA,
+                 width,
+                 height,
+                 0,
+                 GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 NULL);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static bool attach(GLuint fbo, GLuint texture, GLuint depth)
+{
+    GLenum status;
+
+    pglBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    pglFramebufferTexture2D(GL_FRAMEBUFFER,
+                            GL_COLOR_ATTACHMENT0,
+                            GL_TEXTURE_2D,
+                            texture,
+                            0);
+
+    if(depth) {
+        pglFramebufferRenderbuffer(GL_FRAMEBUFFER,
+                                   GL_DEPTH_ATTACHMENT,
+                                   GL_RENDERBUFFER,
+                                   depth);
+    }
+
+    status = pglCheckFramebufferStatus(GL_FRAMEBUFFER);
+    pglBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return (status == GL_FRAMEBUFFER_COMPLETE);
+}
+
+static void depth_storage(GLuint depth, int width, int height)
+{
+    pglBindRenderbuffer(GL_RENDERBUFFER, depth);
+    pglRenderbufferStorage(GL_RENDERBUFFER,
+                           GL_DEPTH_COMPONENT24,
+                           width,
+                           height);
+
+    pglBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+
+// Draw part of src over the whole of dst with the given program
+static void pass(GLuint program,
+                 GLuint src,
+                 GLuint dst,
+                 float left,
+                 float bottom,
+                 float right,
+                 float top)
+{
+    pglBindFramebuffer(GL_FRAMEBUFFER, dst);
+    pglUseProgram(program);
+    glBindTexture(GL_TEXTURE_2D, src);
+    glBegin(GL_QUADS);
+    glTexCoord2f(left, bottom);
+    glVertex2f(0, 0);
+    glTexCoord2f(right, bottom);
+    glVertex2f(1, 0);
+    glTexCoord2f(right, top);
+    glVertex2f(1, 1);
+    glTexCoord2f(left, top);
+    glVertex2f(0, 1);
+    glEnd();
+}
+
+// Pick out the bright bits of part of a texture and blur them
+static void blur(GLuint src, float left, float bottom, float right, float top)
+{
+    glPushAttrib(GL_ENABLE_BIT | GL_VIEWPORT_BIT);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_FOG);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_TEXTURE_2D);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, 1, 0, 1, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glViewport(0, 0, BLUR_SIZE, BLUR_SIZE);
+
+    pass(bright_program, src, blur_fbo[0], left, bottom, right, top);
+    pglUseProgram(blur_program);
+    pglUniform2f(blur_offset, 1.0f / BLUR_SIZE, 0.0f);
+    pglUniform1f(blur_gain, 1.0f);
+    pass(blur_program, blur_texture[0], blur_fbo[1], 0, 0, 1, 1);
+    pglUniform2f(blur_offset, 0.0f, 1.0f / BLUR_SIZE);
+    pglUniform1f(blur_gain, BLOOM_GAIN);
+    pass(blur_program, blur_texture[1], blur_fbo[0], 0, 0, 1, 1);
+
+    pglUseProgram(0);
+    pglBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+}
+
+bool BloomActive(void)
+{
+    return ready;
+}
+
+// The blurred glow, ready to be added over the frame
+unsigned int BloomTexture(void)
+{
+    return blur_texture[0];
+}
+
+// Start drawing the bloom source into the given texture instead of the
+// screen. False means there's no offscreen target and the caller should
+// fall back to the old way.
+bool BloomBegin(unsigned int texture, int size)
+{
+    if(!ready) {
+        return false;
+    }
+
+    if((texture != source_texture) || (size != source_size)) {
+        target_texture(texture, size, size);
+        depth_storage(source_depth, size, size);
+        if(!attach(source_fbo, texture, source_depth)) {
+            ready = false;
+            return false;
+        }
+
+        source_texture = texture;
+        source_size = size;
+    }
+
+    // The texture may have been rebuilt with mipmaps since. Those don't
+    // follow along when we draw into it, so don't let anything use them.
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    pglBindFramebuffer(GL_FRAMEBUFFER, source_fbo);
+    glViewport(0, 0, size, size);
+
+    return true;
+}
+
+// The source is done. Pick out the bright bits and blur them.
+void BloomEnd(void)
+{
+    blur(source_texture, 0, 0, 1, 1);
+}
+
+// Make the glow from part of a finished frame, given in texture
+// coordinates
+void BloomFrame(unsigned int texture,
+                float left,
+                float bottom,
+                float right,
+                float top)
+{
+    // Shrinking it through its own mipmaps keeps small lights from
+    // flickering in and out of the glow.
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D,
+                    GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
+
+    pglGenerateMipmap(GL_TEXTURE_2D);
+    blur(texture, left, bottom, right, top);
+}
+
+void BloomTerm(void)
+{
+    if(bright_program) {
+        pglDeleteProgram(bright_program);
+    }
+
+    if(blur_program) {
+        pglDeleteProgram(blur_program);
+    }
+
+    if(source_fbo) {
+        pglDeleteFramebuffers(1, &source_fbo);
+        pglDeleteRenderbuffers(1, &source_depth);
+        pglDeleteFramebuffers(2, blur_fbo);
+        glDeleteTextures(2, blur_texture);
+    }
+
+    bright_program = blur_program = 0;
+    source_fbo = source_depth = 0;
+    source_texture = 0;
+    source_size = 0;
+    ready = false;
+}
+
+void BloomInit(void)
+{
+    int i;
+
+    if(!GlextFramebuffers() || !GlextShaders()) {
+        return;
+    }
+
+    bright_program = GlextProgram(quad_vertex, bright_fragment);
+    blur_program = GlextProgram(quad_vertex, blur_fragment);
+    if(!bright_program || !blur_program) {
+        BloomTerm();
+        return;
+    }
+
+    pglUseProgram(bright_program);
+    pglUniform1i(pglGetUniformLocation(bright_program, "image"), 0);
+    pglUseProgram(blur_program);
+    pglUniform1i(pglGetUniformLocation(blur_program, "image"), 0);
+    blur_offset = pglGetUniformLocation(blur_program, "offset");
+    blur_gain = pglGetUniformLocation(blur_program, "gain");
+    pglUseProgram(0);
+
+    pglGenFramebuffers(1, &source_fbo);
+    pglGenRenderbuffers(1, &source_depth);
+    pglGenFramebuffers(2, blur_fbo);
+    glGenTextures(2, blur_texture);
+    for(i = 0; i < 2; ++i) {
+        target_texture(blur_texture[i], BLUR_SIZE, BLUR_SIZE);
+        if(!attach(blur_fbo[i], blur_texture[i], 0)) {
+            BloomTerm();
+            return;
+        }
+    }
+
+    ready = true;
+}
@@ -0,0 +1,17 @@
+#ifndef BLOOM_HPP_
+#define BLOOM_HPP_
+
+void BloomInit(void);
+void BloomTerm(void);
+bool BloomActive(void);
+bool BloomBegin(unsigned int texture, int size);
+void BloomEnd(void);
+void BloomFrame(unsigned int texture,
+                float left,
+                float bottom,
+                float right,
+                float top);
+
+unsigned int BloomTexture(void);
+
+#endif /* BLOOM_HPP_ */
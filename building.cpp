@@ -94,6 +94,22 @@ GLuint Building::texture()
     return TextureRandomBuilding(texture_type_);
 }
 
+Mesh *Building::mesh()
+{
+    return mesh_;
+}
+
+gl_rgba Building::color()
+{
+    return color_;
+}
+
+void Building::bounds(gl_bbox *box)
+{
+    mesh_->Bounds(box);
+    mesh_flat_->Bounds(box);
+}
+
 GLint Building::poly_count()
 {
     return(mesh_->PolyCount() + mesh_flat_->PolyCount());
@@ -282,6 +298,7 @@ void Building::construct_roof(GLfloat left,
     GLfloat ac_height;
     GLfloat logo_offset;
     Decoration *d;
+    unsigned int noise[4];
     gl_vector2 start;
     gl_vector2 end;
 
@@ -377,10 +394,12 @@ void Building::construct_roof(GLfloat left,
     // 1 air conditioner block for every 15 floors sounds reasonable
     air_conditioners = height_ / 15;
     for(i = 0; i < air_conditioners; ++i) {
-        ac_size = (GLfloat)(10 + RandomVal(30)) / 10;
-        ac_height = ((GLfloat)RandomVal(20) / 10) + 1.0f;
-        ac_x = left + (GLfloat)RandomVal(width);
-        ac_y = front + (GLfloat)RandomVal(depth);
+        // The same four numbers as four RandomVal() calls, in one go
+        RandomFill(noise, 4);
+        ac_size = (GLfloat)(10 + (noise[0] % 30)) / 10;
+        ac_height = ((GLfloat)(noise[1] % 20) / 10) + 1.0f;
+        ac_x = left + (GLfloat)(width ? (noise[2] % width) : 0);
+        ac_y = front + (GLfloat)(depth ? (noise[3] % depth) : 0);
 
         // Make sure the unit doesn't hang off the right edge of the building
         if((ac_x + ac_size) > (GLfloat)right) {
@@ -580,6 +599,7 @@ void Building::create_blocky()
     GLfloat uv_start;
     GLboolean skip;
     GLboolean blank_corners;
+    unsigned int walls[4];
 
     // Choose if the corners of the building are to be windowless
     blank_corners = COIN_FLIP;
@@ -637,10 +657,11 @@ void Building::create_blocky()
         }
 
         // Pick new locations for our four outer walls
-        left = (RandomVal() % half_width) + 1;
-        right = (RandomVal() % half_width) + 1;
-        front = (RandomVal() % half_depth) + 1;
-        back = (RandomVal() % half_depth) + 1;
+        RandomFill(walls, 4);
+        left = (walls[0] % half_width) + 1;
+        right = (walls[1] % half_width) + 1;
+        front = (walls[2] % half_depth) + 1;
+        back = (walls[3] % half_depth) + 1;
         skip = false;
 
         // At least ONE of the walls must reach out beyond a previous maximum
@@ -31,6 +31,9 @@ public:
     GLint poly_count();
     void render_flat(GLboolean colored);
     GLuint texture();
+    Mesh *mesh();
+    gl_rgba color();
+    void bounds(gl_bbox *box);
 
 private:
     GLint x_;
@@ -20,6 +20,9 @@
 #include "ini.hpp"
 #include "macro.hpp"
 #include "math.hpp"
+#include "profile.hpp"
+#include "track.hpp"
+#include "visible.hpp"
 #include "win.hpp"
 #include "world.hpp"
 
@@ -31,6 +34,18 @@
 #define ONE_SECOND 1000
 #define CAMERA_CHANGE_GLINTERVAL 15
 #define CAMERA_CYCLE_LENGTH (CAMERA_MODES * CAMERA_CHANGE_GLINTERVAL)
+// Points the flight passes through along each side of the hot zone
+#define FLIGHT_STEPS 8
+#define FLIGHT_POINTS (FLIGHT_STEPS * 4)
+#define FLIGHT_LOW 25.0f
+#define FLIGHT_HIGH 60.0f
+// How far above the rooftops the flight keeps
+#define FLIGHT_CLEARANCE 6.0f
+// Milliseconds between keyframes written to a track
+#define RECORD_INTERVAL 100
+// Milliseconds a replayed track moves on each frame, however long the
+// frame actually took
+#define REPLAY_STEP (1000.0f / 60.0f)
 
 enum {
     CAMERA_FLYCAM1,
@@ -54,118 +69,175 @@ static GLfloat tracker;
 static GLuint last_update;
 static GLint camera_behavior;
 static GLuint last_move;
+static gl_vector3 flight[FLIGHT_POINTS];
+static int flight_serial = -1;
+static bool replaying;
+static bool replay_hold;
+static bool recording;
+static GLfloat replay_clock;
+static GLuint record_start;
+static GLuint record_next;
+
+// Is the straight line between two points over open street the whole
+// way? Nothing gets built on a road, so there's nothing to hit down there.
+static bool street_between(gl_vector3 a, gl_vector3 b)
+{
+    gl_vector3 p;
+    int steps;
+    int i;
+
+    steps = MAX((int)(b - a).length(), 1);
+    for(i = 0; i <= steps; ++i) {
+        p = a.interpolate(b, (GLfloat)i / (GLfloat)steps);
+        if(!(WorldCell((int)p.get_x(), (int)p.get_z()) & CLAIM_ROAD)) {
+            return false;
+        }
+    }
 
-static gl_vector3 flycam_position(GLuint t)
+    return true;
+}
+
+// Lay out the flight around the hot zone. It dives toward one corner and
+// climbs toward the next, as it always has. The hot zone is marked out by
+// streets, so where a leg runs down open street the flight is free to drop
+// between the buildings. Anywhere else, and near the corners where the
+// curve cuts across the block, it looks at the height field and stays
+// above whatever is there. This only happens once per city.
+static void plan_flight()
 {
-    GLuint leg;
-    GLfloat delta;
-    gl_vector3 start;
-    gl_vector3  end;
     gl_bbox hot_zone;
+    gl_vector3 corner[4];
+    gl_vector3 point;
+    gl_vector3 before;
+    gl_vector3 after;
+    GLfloat delta;
+    GLfloat from;
+    GLfloat to;
+    GLfloat spacing;
+    GLfloat ground;
+    int leg;
+    int step;
 
     hot_zone = WorldHotZone();
-    t %= FLYCAM_CIRCUIT;
-    leg = t / FLYCAM_LEG;
-    delta = (GLfloat)(t % FLYCAM_LEG) / FLYCAM_LEG;
-    
-    switch(leg) {
-    case 0:
-        start = gl_vector3(hot_zone.get_min().get_x(),
-                           25.0f,
+    corner[0] = gl_vector3(hot_zone.get_min().get_x(),
+                           FLIGHT_LOW,
                            hot_zone.get_min().get_z());
 
-        end = gl_vector3(hot_zone.get_min().get_x(),
-                         60.0f,
-                         hot_zone.get_max().get_z());
-
-        break;
-    case 1:
-        start = gl_vector3(hot_zone.get_min().get_x(),
-                           60.0f,
+    corner[1] = gl_vector3(hot_zone.get_min().get_x(),
+                           FLIGHT_HIGH,
                            hot_zone.get_max().get_z());
 
-        end = gl_vector3(hot_zone.get_max().get_x(),
-                         25.0f,
-                         hot_zone.get_max().get_z());
-
-        break;
-    case 2:
-        start = gl_vector3(hot_zone.get_max().get_x(), 
-                           25.0f,
+    corner[2] = gl_vector3(hot_zone.get_max().get_x(),
+                           FLIGHT_LOW,
                            hot_zone.get_max().get_z());
 
-        end = gl_vector3(hot_zone.get_max().get_x(), 
-                         60.0f,
-                         hot_zone.get_min().get_z());
-
-        break;
-    case 3:
-        start = gl_vector3(hot_zone.get_max().get_x(),
-                           60.0f,
+    corner[3] = gl_vector3(hot_zone.get_max().get_x(),
+                           FLIGHT_HIGH,
                            hot_zone.get_min().get_z());
 
-        end = gl_vector3(hot_zone.get_min().get_x(), 
-                         25.0f,
-                         hot_zone.get_min().get_z());
-
-        break;
+    for(leg = 0; leg < 4; ++leg) {
+        from = corner[leg].get_y();
+        to = corner[(leg + 1) % 4].get_y();
+        spacing = (corner[(leg + 1) % 4] - corner[leg]).length();
+        spacing /= FLIGHT_STEPS;
+        for(step = 0; step < FLIGHT_STEPS; ++step) {
+            delta = (GLfloat)step / FLIGHT_STEPS;
+            point = corner[leg].interpolate(corner[(leg + 1) % 4], delta);
+            before = corner[leg].interpolate(corner[(leg + 1) % 4],
+                                             delta - (1.0f / FLIGHT_STEPS));
+            after = corner[leg].interpolate(corner[(leg + 1) % 4],
+                                            delta + (1.0f / FLIGHT_STEPS));
+
+            if((step > 1)
+               && (step < (FLIGHT_STEPS - 1))
+               && street_between(before, point)
+               && street_between(point, after)) {
+                ground = 0.0f;
+            }
+            else {
+                ground = VisibleHeightNear(point.get_x(),
+                                           point.get_z(),
+                                           spacing);
+            }
+
+            point.set_y(MAX(MathInterpolate(from, to, MathScalarCurve(delta)),
+                            ground + FLIGHT_CLEARANCE));
+
+            flight[(leg * FLIGHT_STEPS) + step] = point;
+        }
     }
 
-    delta = MathScalarCurve(delta);
-
-    return start.interpolate(end, delta);
+    flight_serial = VisibleBoundsSerial();
 }
 
-static void do_auto_cam()
+static gl_vector3 flycam_position(GLuint t)
 {
-    GLfloat dist;
-    GLuint elapsed;
-    GLuint now;
-    GLint behavior;
-    gl_vector3 target;
+    GLfloat along;
+    int i;
 
-    now = SDL_GetTicks();
-    elapsed = now - last_update;
-    elapsed = MIN(elapsed, 50); // Limit to 1/20th second worth of time
-    if(elapsed == 0) {
-        return;
-    }
+    t %= FLYCAM_CIRCUIT;
+    along = ((GLfloat)t * FLIGHT_POINTS) / FLYCAM_CIRCUIT;
+    i = (int)along;
+
+    return spline(flight[(i + FLIGHT_POINTS - 1) % FLIGHT_POINTS],
+                  flight[i],
+                  flight[(i + 1) % FLIGHT_POINTS],
+                  flight[(i + 2) % FLIGHT_POINTS],
+                  along - (GLfloat)i);
+}
 
-    last_update = now;
+// Can the manual camera be here, at the height it's at?
+static bool clear(GLfloat x, GLfloat z)
+{
+    return (VisibleHeight(x, z) + EYE_HEIGHT) <= position.get_y();
+}
 
-    behavior = camera_behavior;
+// Keep a point out of whatever is built under it
+static void stay_above(gl_vector3 *pos)
+{
+    pos->set_y(MAX(pos->get_y(),
+                   VisibleHeight(pos->get_x(), pos->get_z()) + EYE_HEIGHT));
+}
 
-    tracker += ((GLfloat)elapsed / 300.0f);
-    // behavior = CAMERA_FLYCAM;
+// Where the automatic camera is and which way it faces at a given time
+// and point in its orbit. Nothing here depends on what came before, so
+// it can just as well say where the camera is going to be.
+static void auto_view(GLuint now,
+                      GLfloat track,
+                      gl_vector3 *pos,
+                      gl_vector3 *ang)
+{
+    GLfloat dist;
+    gl_vector3 target;
 
-    switch(behavior) {
+    switch(camera_behavior) {
     case CAMERA_ORBIT_INWARD:
-        auto_position.set_x(WORLD_HALF + (sinf(tracker * DEGREES_TO_RADIANS) * 150.0f));
+        pos->set_x(WORLD_HALF + (sinf(track * DEGREES_TO_RADIANS) * 150.0f));
         
-        auto_position.set_y(60.0f);
+        pos->set_y(60.0f);
         
-        auto_position.set_z(WORLD_HALF + (cosf(tracker * DEGREES_TO_RADIANS) * 150.0f));
+        pos->set_z(WORLD_HALF + (cosf(track * DEGREES_TO_RADIANS) * 150.0f));
 
         target = gl_vector3(WORLD_HALF, 40.0f, WORLD_HALF);
 
         break;
     case CAMERA_ORBIT_OUTWARD:
-        auto_position.set_x(WORLD_HALF + (sinf(tracker * DEGREES_TO_RADIANS) * 250.0f));
+        pos->set_x(WORLD_HALF + (sinf(track * DEGREES_TO_RADIANS) * 250.0f));
         
-        auto_position.set_y(60.0f);
+        pos->set_y(60.0f);
 
-        auto_position.set_z(WORLD_HALF + (cosf(tracker * DEGREES_TO_RADIANS) * 250.0f));
+        pos->set_z(WORLD_HALF + (cosf(track * DEGREES_TO_RADIANS) * 250.0f));
 
         target = gl_vector3(WORLD_HALF, 30.0f, WORLD_HALF);
 
         break;
     case CAMERA_ORBIT_ELLIPTICAL:
-        dist = 150.0f + (sinf((tracker * DEGREES_TO_RADIANS) / 1.1f) * 50);
-        auto_position.set_x(WORLD_HALF + (sinf(tracker * DEGREES_TO_RADIANS) * dist));
+        dist = 150.0f + (sinf((track * DEGREES_TO_RADIANS) / 1.1f) * 50);
+        pos->set_x(WORLD_HALF + (sinf(track * DEGREES_TO_RADIANS) * dist));
 
-        auto_position.set_y(60.0f);
+        pos->set_y(60.0f);
         
-        auto_position.set_z(WORLD_HALF + (cosf(tracker * DEGREES_TO_RADIANS) * dist));
+        pos->set_z(WORLD_HALF + (cosf(track * DEGREES_TO_RADIANS) * dist));
 
         target = gl_vector3(WORLD_HALF, 50.0f, WORLD_HALF);
 
@@ -173,48 +245,103 @@ static void do_auto_cam()
     case CAMERA_FLYCAM1:
     case CAMERA_FLYCAM2:
     case CAMERA_FLYCAM3:
-        auto_position =
+        *pos =
             (flycam_position(now) + flycam_position(now + 4000)) / 2.0f;
 
         target = flycam_position(now + FLYCAM_CIRCUIT_HALF - (ONE_SECOND * 3));
 
         break;
     case CAMERA_SPEED:
-        auto_position = 
+        *pos = 
             (flycam_position(now) + flycam_position(now + 500)) / 2.0f;
 
         target = flycam_position(now + (ONE_SECOND * 5));
-        auto_position.set_y(auto_position.get_y() / 2);
+        pos->set_y(pos->get_y() / 2);
 
         break;
     default:
-        target.set_x(WORLD_HALF + (sinf(tracker * DEGREES_TO_RADIANS) * 300.0f));
+        target.set_x(WORLD_HALF + (sinf(track * DEGREES_TO_RADIANS) * 300.0f));
         target.set_y(30.0f);
-        target.set_z(WORLD_HALF + (cosf(tracker * DEGREES_TO_RADIANS) * 300.0f));
+        target.set_z(WORLD_HALF + (cosf(track * DEGREES_TO_RADIANS) * 300.0f));
         
-        auto_position.set_x(WORLD_HALF + (sinf(tracker * DEGREES_TO_RADIANS) * 50.0f));
+        pos->set_x(WORLD_HALF + (sinf(track * DEGREES_TO_RADIANS) * 50.0f));
             
-        auto_position.set_y(60.0f);
+        pos->set_y(60.0f);
         
-        auto_position.set_z(WORLD_HALF + (cosf(tracker * DEGREES_TO_RADIANS) * 50.0f));
+        pos->set_z(WORLD_HALF + (cosf(track * DEGREES_TO_RADIANS) * 50.0f));
     }
 
-    dist = MathDistance(auto_position.get_x(),
-                        auto_position.get_z(),
+    stay_above(pos);
+    dist = MathDistance(pos->get_x(),
+                        pos->get_z(),
                         target.get_x(),
                         target.get_z());
     
-    auto_angle.set_y(-MathAngle(auto_position.get_x(),
-                                auto_position.get_y(),
+    ang->set_y(-MathAngle(pos->get_x(),
+                                pos->get_y(),
                                 target.get_x(),
                                 target.get_y()));
 
-    auto_angle.set_x(90.f + MathAngle(0, 
-                                      auto_position.get_y(),
+    ang->set_x(90.f + MathAngle(0, 
+                                      pos->get_y(),
                                       dist,
                                       target.get_y()));
 }
 
+static void do_auto_cam()
+{
+    GLuint elapsed;
+    GLuint now;
+
+    now = SDL_GetTicks();
+    elapsed = now - last_update;
+    elapsed = MIN(elapsed, 50); // Limit to 1/20th second worth of time
+    if(elapsed == 0) {
+        return;
+    }
+
+    last_update = now;
+    if(flight_serial != VisibleBoundsSerial()) {
+        plan_flight();
+    }
+
+    tracker += ((GLfloat)elapsed / 300.0f);
+    auto_view(now, tracker, &auto_position, &auto_angle);
+}
+
+// Where the camera will be and which way it will face, every step
+// milliseconds from now, for as many views as asked. Returns how many it
+// could fill in: the automatic camera and a replayed track are known in
+// advance, but someone at the controls isn't.
+int camera_predict(gl_vector3 *positions,
+                   gl_vector3 *angles,
+                   int count,
+                   GLuint step)
+{
+    GLuint ahead;
+    int i;
+
+    for(i = 0; i < count; ++i) {
+        ahead = (i + 1) * step;
+        if(replaying) {
+            TrackPeek((GLuint)replay_clock + ahead,
+                      &positions[i],
+                      &angles[i]);
+        }
+        else if(cam_auto) {
+            auto_view(last_update + ahead,
+                      tracker + ((GLfloat)ahead / 300.0f),
+                      &positions[i],
+                      &angles[i]);
+        }
+        else {
+            return 0;
+        }
+    }
+
+    return count;
+}
+
 void camera_auto_toggle()
 {
     cam_auto = !cam_auto;
@@ -322,13 +449,89 @@ void camera_init()
     
     angle = IniVector(const_cast<char *>(camera_angle.c_str()));
     position = IniVector(const_cast<char *>(camera_position.c_str()));
+
+    // A track to replay takes over the camera. Otherwise, if asked, we
+    // write down where it goes.
+    replaying = TrackLoad(IniString("CameraReplay"));
+    replay_clock = 0.0f;
+    recording = !replaying && TrackRecordStart(IniString("CameraRecord"));
+    record_start = 0;
+    record_next = 0;
+}
+
+// Start the track over from the beginning. With hold set, reaching the
+// end leaves the camera on the last keyframe instead of ending the run,
+// for when someone else decides how long to keep going.
+void camera_replay_rewind(bool hold)
+{
+    replay_clock = 0.0f;
+    replay_hold = hold;
+    TrackRewind();
+}
+
+// Follow the track at a fixed step per frame, so every run sees the
+// same views in the same order. When it's over, so is the run.
+static void do_replay()
+{
+    if(!TrackReplay((GLuint)replay_clock, &position, &angle)
+       && !replay_hold) {
+        AppQuit();
+    }
+
+    replay_clock += REPLAY_STEP;
+    cam_auto = false;
+}
+
+static void do_record()
+{
+    GLuint now;
+
+    // Count from the first frame we write down, not from when we started
+    // up, so the track starts at zero however long loading took
+    if(!record_next) {
+        record_start = SDL_GetTicks();
+    }
+
+    now = SDL_GetTicks() - record_start;
+    if(now < record_next) {
+        return;
+    }
+
+    TrackRecord(now, camera_position(), camera_angle());
+    record_next = now + RECORD_INTERVAL;
 }
 
 void camera_update()
 {
+    PROFILE("camera_update");
+    gl_vector3 from;
+
+    if(replaying) {
+        do_replay();
+        return;
+    }
+
+    // Moving into a building stops at its wall, sliding along it if
+    // only one way is blocked
+    from = position;
     camera_pan(movement.get_x());
     camera_forward(movement.get_z());
     position.set_y(position.get_y() + (movement.get_y() / 10.0f));
+    if(!clear(position.get_x(), position.get_z())) {
+        if(clear(position.get_x(), from.get_z())) {
+            position.set_z(from.get_z());
+        }
+        else if(clear(from.get_x(), position.get_z())) {
+            position.set_x(from.get_x());
+        }
+        else {
+            position.set_x(from.get_x());
+            position.set_z(from.get_z());
+        }
+    }
+
+    // Nor can it sink into the roof it's over
+    stay_above(&position);
     if((SDL_GetTicks() - last_move) > 1000) {
         movement *= 0.9f;
     }
@@ -346,6 +549,9 @@ void camera_update()
 
     angle.set_y((GLfloat)fmod(angle.get_y(), 360.0f));
     angle.set_x(CLAMP(angle.get_x(), -MAX_PITCH, MAX_PITCH));
+    if(recording) {
+        do_record();
+    }
 }
 
 void camera_term()
@@ -356,4 +562,5 @@ void camera_term()
     // Just store our most recent position in the ini
     IniVectorSet(const_cast<char *>(camera_angle.c_str()), angle);
     IniVectorSet(const_cast<char *>(camera_position.c_str()), position);
+    TrackTerm();
 }
@@ -14,8 +14,13 @@ void camera_init();
 void camera_next_behavior();
 gl_vector3 camera_position();
 void camera_position_set(gl_vector3 new_pos);
+void camera_replay_rewind(bool hold);
 void camera_reset();
 void camera_update();
+int camera_predict(gl_vector3 *positions,
+                   gl_vector3 *angles,
+                   int count,
+                   GLuint step);
 void camera_term();
 
 void camera_forward(GLfloat delta);
@@ -0,0 +1,550 @@
+/*
+ * canvas.cpp
+ *
+ * A tiny software rasterizer for the procedural textures. It only knows the
+ * handful of shapes texture.cpp actually draws: rectangles, single pixels,
+ * shaded lines and a few kinds of radial gradient. The rows are contiguous
+ * in memory, so the heavy lifting is done a row at a time, four pixels per
+ * step where SSE2 is around.
+ *
+ */
+
+#include "canvas.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "macro.hpp"
+#include "math.hpp"
+
+#define ROW(c, y) ((c)->bits + ((((c)->size - 1) - (y)) * (c)->size * 4))
+#define PIXEL(c, x, y) (ROW(c, y) + ((x) * 4))
+
+// Exact (x / 255) for anything a blend can produce, with rounding
+static inline int div255(int x)
+{
+    x += 128;
+
+    return (x + (x >> 8)) >> 8;
+}
+
+static inline unsigned char to_byte(float f)
+{
+    if(f <= 0.0f) {
+        return 0;
+    }
+
+    if(f >= 1.0f) {
+        return 255;
+    }
+
+    return (unsigned char)((f * 255.0f) + 0.5f);
+}
+
+static void to_bytes(gl_rgba color, unsigned char *out)
+{
+    out[0] = to_byte(color.get_red());
+    out[1] = to_byte(color.get_green());
+    out[2] = to_byte(color.get_blue());
+    out[3] = to_byte(color.get_alpha());
+}
+
+static inline void blend(unsigned char *dst, unsigned char const *src)
+{
+    int a;
+    int inv;
+
+    a = src[3];
+    inv = 255 - a;
+    dst[0] = div255((src[0] * a) + (dst[0] * inv));
+    dst[1] = div255((src[1] * a) + (dst[1] * inv));
+    dst[2] = div255((src[2] * a) + (dst[2] * inv));
+    dst[3] = div255((src[3] * a) + (dst[3] * inv));
+}
+
+// Overwrite count pixels with the same value
+static void fill_span(unsigned char *dst, int count, unsigned char const *src)
+{
+    unsigned int pixel;
+
+    memcpy(&pixel, src, 4);
+
+#ifdef __SSE2__
+    __m128i wide = _mm_set1_epi32((int)pixel);
+
+    for(/* empty */; count >= 4; count -= 4, dst += 16) {
+        _mm_storeu_si128((__m128i *)dst, wide);
+    }
+#endif
+
+    for(/* empty */; count > 0; --count, dst += 4) {
+        memcpy(dst, &pixel, 4);
+    }
+}
+
+// Blend the same color over count pixels
+static void blend_span(unsigned char *dst, int count, unsigned char const *src)
+{
+    if(src[3] == 255) {
+        fill_span(dst, count, src);
+        return;
+    }
+
+    if(src[3] == 0) {
+        return;
+    }
+
+#ifdef __SSE2__
+    int a = src[3];
+    __m128i zero = _mm_setzero_si128();
+    __m128i inv = _mm_set1_epi16((short)(255 - a));
+
+    // The source half of the blend never changes, so work it out once,
+    // along with the rounding term div255() would add.
+    __m128i term = _mm_setr_epi16((short)((src[0] * a) + 128),
+                                  (short)((src[1] * a) + 128),
+                                  (short)((src[2] * a) + 128),
+                                  (short)((src[3] * a) + 128),
+                                  (short)((src[0] * a) + 128),
+                                  (short)((src[1] * a) + 128),
+                                  (short)((src[2] * a) + 128),
+                                  (short)((src[3] * a) + 128));
+
+    for(/* empty */; count >= 4; count -= 4, dst += 16) {
+        __m128i d = _mm_loadu_si128((__m128i const *)dst);
+        __m128i lo = _mm_unpacklo_epi8(d, zero);
+        __m128i hi = _mm_unpackhi_epi8(d, zero);
+
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, inv), term);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, inv), term);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for(/* empty */; count > 0; --count, dst += 4) {
+        blend(dst, src);
+    }
+}
+
+// How far along the way out to the rim each pixel in a row is, for a fan of
+// triangles from an apex (which needn't be the center) out to a circle.
+// Zero at the apex, one on the rim. The pixel at (x, y) is w = (x, y) minus
+// the apex, and d is the apex minus the center of the circle.
+static void fan_row(float *out,
+                    int count,
+                    float wx,
+                    float wy,
+                    float dx,
+                    float dy,
+                    float k)
+{
+    int i;
+    float b;
+    float ww;
+
+    i = 0;
+
+#ifdef __SSE2__
+    __m128 x = _mm_setr_ps(wx, wx + 1.0f, wx + 2.0f, wx + 3.0f);
+    __m128 y = _mm_set1_ps(wy);
+    __m128 yy = _mm_mul_ps(y, y);
+    __m128 by = _mm_mul_ps(_mm_set1_ps(dy), y);
+    __m128 vdx = _mm_set1_ps(dx);
+    __m128 vk = _mm_set1_ps(k);
+    __m128 inv_k = _mm_set1_ps(1.0f / k);
+    __m128 four = _mm_set1_ps(4.0f);
+
+    for(/* empty */; (i + 4) <= count; i += 4) {
+        __m128 vb = _mm_add_ps(_mm_mul_ps(vdx, x), by);
+        __m128 vww = _mm_add_ps(_mm_mul_ps(x, x), yy);
+        __m128 root = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vb, vb),
+                                             _mm_mul_ps(vww, vk)));
+
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(vb, root), inv_k));
+        x = _mm_add_ps(x, four);
+    }
+#endif
+
+    for(/* empty */; i < count; ++i) {
+        b = (dx * (wx + (float)i)) + (dy * wy);
+        ww = ((wx + (float)i) * (wx + (float)i)) + (wy * wy);
+        out[i] = (b + sqrtf((b * b) + (ww * k))) / k;
+    }
+}
+
+// Distance from the center for a row of pixels, where u steps by du each
+// pixel and v is the same for the whole row
+static void distance_row(float *out, int count, float u, float du, float v)
+{
+    int i;
+    float uu;
+
+    i = 0;
+
+#ifdef __SSE2__
+    __m128 x = _mm_setr_ps(u, u + du, u + (du * 2.0f), u + (du * 3.0f));
+    __m128 step = _mm_set1_ps(du * 4.0f);
+    __m128 vv = _mm_set1_ps(v * v);
+
+    for(/* empty */; (i + 4) <= count; i += 4) {
+        _mm_storeu_ps(out + i, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), vv)));
+        x = _mm_add_ps(x, step);
+    }
+#endif
+
+    for(/* empty */; i < count; ++i) {
+        uu = u + (du * (float)i);
+        out[i] = sqrtf((uu * uu) + (v * v));
+    }
+}
+
+canvas *CanvasCreate(int size)
+{
+    canvas *c;
+
+    c = new canvas;
+    c->size = size;
+    c->bits = (unsigned char *)malloc(size * size * 4);
+
+    return c;
+}
+
+void CanvasDestroy(canvas *c)
+{
+    free(c->bits);
+    delete c;
+}
+
+void CanvasClear(canvas *c, gl_rgba color)
+{
+    unsigned char src[4];
+
+    to_bytes(color, src);
+    fill_span(c->bits, c->size * c->size, src);
+}
+
+void CanvasFill(canvas *c,
+                int left,
+                int top,
+                int right,
+                int bottom,
+                gl_rgba color)
+{
+    int y;
+    unsigned char src[4];
+
+    left = MAX(left, 0);
+    top = MAX(top, 0);
+    right = MIN(right, c->size);
+    bottom = MIN(bottom, c->size);
+    if((left >= right) || (top >= bottom)) {
+        return;
+    }
+
+    to_bytes(color, src);
+    for(y = top; y < bottom; ++y) {
+        blend_span(PIXEL(c, left, y), right - left, src);
+    }
+}
+
+// Replace whole rows with a vertical gradient. Like the old quad strip, this
+// ignores what was there before.
+void CanvasGradient(canvas *c,
+                    int top,
+                    int bottom,
+                    gl_rgba top_color,
+                    gl_rgba bottom_color)
+{
+    int y;
+    float delta;
+    unsigned char src[4];
+
+    if(bottom <= top) {
+        return;
+    }
+
+    for(y = MAX(top, 0); y < MIN(bottom, c->size); ++y) {
+        delta = ((float)y + 0.5f - (float)top) / (float)(bottom - top);
+        to_bytes(top_color.interpolate(bottom_color, delta), src);
+        src[3] = to_byte(MathInterpolate(top_color.get_alpha(),
+                                         bottom_color.get_alpha(),
+                                         delta));
+
+        fill_span(ROW(c, y), c->size, src);
+    }
+}
+
+void CanvasPlot(canvas *c, int x, int y, gl_rgba color)
+{
+    unsigned char src[4];
+
+    if((x < 0) || (y < 0) || (x >= c->size) || (y >= c->size)) {
+        return;
+    }
+
+    to_bytes(color, src);
+    blend(PIXEL(c, x, y), src);
+}
+
+// A one pixel wide vertical line of black, fading from alpha1 at y1 to
+// alpha2 at y2
+void CanvasShade(canvas *c, int x, int y1, int y2, float alpha1, float alpha2)
+{
+    int y;
+    float delta;
+    unsigned char src[4];
+
+    if((x < 0) || (x >= c->size) || (y1 == y2)) {
+        return;
+    }
+
+    src[0] = 0;
+    src[1] = 0;
+    src[2] = 0;
+    for(y = MAX(MIN(y1, y2), 0); y < MIN(MAX(y1, y2), c->size); ++y) {
+        delta = ((float)y + 0.5f - (float)y1) / (float)(y2 - y1);
+        src[3] = to_byte(alpha1 + ((alpha2 - alpha1) * delta));
+        blend(PIXEL(c, x, y), src);
+    }
+}
+
+void CanvasLine(canvas *c,
+                int x1,
+                int y1,
+                int x2,
+                int y2,
+                int width,
+                gl_rgba color)
+{
+    int i;
+    int j;
+    int first;
+    int last;
+    int dx;
+    int dy;
+    float center;
+    float half;
+    unsigned char src[4];
+
+    dx = x2 - x1;
+    dy = y2 - y1;
+    half = (float)width / 2.0f;
+    to_bytes(color, src);
+
+    // Walk the long axis one pixel at a time, and cover whichever pixels
+    // on the short axis fall inside the width of the line.
+    if(abs(dx) >= abs(dy)) {
+        if(!dx) {
+            return;
+        }
+
+        for(i = MIN(x1, x2); i < MAX(x1, x2); ++i) {
+            center = (float)y1
+                + ((float)dy * ((float)i + 0.5f - (float)x1) / (float)dx);
+
+            first = (int)ceilf(center - half - 0.5f);
+            last = (int)ceilf(center + half - 0.5f);
+            for(j = first; j < last; ++j) {
+                if((i >= 0) && (j >= 0) && (i < c->size) && (j < c->size)) {
+                    blend(PIXEL(c, i, j), src);
+                }
+            }
+        }
+    }
+    else {
+        for(j = MIN(y1, y2); j < MAX(y1, y2); ++j) {
+            center = (float)x1
+                + ((float)dx * ((float)j + 0.5f - (float)y1) / (float)dy);
+
+            first = (int)ceilf(center - half - 0.5f);
+            last = (int)ceilf(center + half - 0.5f);
+            for(i = first; i < last; ++i) {
+                if((i >= 0) && (j >= 0) && (i < c->size) && (j < c->size)) {
+                    blend(PIXEL(c, i, j), src);
+                }
+            }
+        }
+    }
+}
+
+// A rectangle shaded from one color in the middle to another at the edges,
+// the way a triangle fan out from the center would come out.
+void CanvasRectFan(canvas *c,
+                   int left,
+                   int top,
+                   int right,
+                   int bottom,
+                   gl_rgba center,
+                   gl_rgba edge)
+{
+    int x;
+    int y;
+    float cx;
+    float cy;
+    float fx;
+    float fy;
+    float along;
+    unsigned char src[4];
+
+    if((left >= right) || (top >= bottom)) {
+        return;
+    }
+
+    cx = (float)((left + right) / 2);
+    cy = (float)((top + bottom) / 2);
+    for(y = MAX(top, 0); y < MIN(bottom, c->size); ++y) {
+        fy = (float)y + 0.5f - cy;
+        if(fy < 0.0f) {
+            fy /= (float)top - cy;
+        }
+        else {
+            fy /= (float)bottom - cy;
+        }
+
+        for(x = MAX(left, 0); x < MIN(right, c->size); ++x) {
+            fx = (float)x + 0.5f - cx;
+            if(fx < 0.0f) {
+                fx /= (float)left - cx;
+            }
+            else {
+                fx /= (float)right - cx;
+            }
+
+            along = MIN(MAX(fx, fy), 1.0f);
+            to_bytes(center.interpolate(edge, along), src);
+            src[3] = to_byte(MathInterpolate(center.get_alpha(),
+                                             edge.get_alpha(),
+                                             along));
+
+            blend(PIXEL(c, x, y), src);
+        }
+    }
+}
+
+// A triangle fan from the apex out to a circle, shading from one color to
+// the other. The apex has to be inside the circle.
+void CanvasFan(canvas *c,
+               float apex_x,
+               float apex_y,
+               float center_x,
+               float center_y,
+               float radius,
+               gl_rgba apex,
+               gl_rgba edge)
+{
+    int x;
+    int y;
+    int left;
+    int right;
+    int top;
+    int bottom;
+    float k;
+    float dx;
+    float dy;
+    float *along;
+    unsigned char src[4];
+
+    dx = apex_x - center_x;
+    dy = apex_y - center_y;
+    k = (radius * radius) - ((dx * dx) + (dy * dy));
+    if(k <= 0.0f) {
+        return;
+    }
+
+    left = MAX((int)floorf(center_x - radius), 0);
+    right = MIN((int)ceilf(center_x + radius), c->size);
+    top = MAX((int)floorf(center_y - radius), 0);
+    bottom = MIN((int)ceilf(center_y + radius), c->size);
+    if((left >= right) || (top >= bottom)) {
+        return;
+    }
+
+    along = (float *)malloc((right - left) * sizeof(float));
+    for(y = top; y < bottom; ++y) {
+        fan_row(along,
+                right - left,
+                (float)left + 0.5f - apex_x,
+                (float)y + 0.5f - apex_y,
+                dx,
+                dy,
+                k);
+
+        for(x = left; x < right; ++x) {
+            if(along[x - left] >= 1.0f) {
+                continue;
+            }
+
+            to_bytes(apex.interpolate(edge, along[x - left]), src);
+            src[3] = to_byte(MathInterpolate(apex.get_alpha(),
+                                             edge.get_alpha(),
+                                             along[x - left]));
+
+            blend(PIXEL(c, x, y), src);
+        }
+    }
+
+    free(along);
+}
+
+// The soft circle texture stretched over a rectangle and tinted with the
+// given color. The radius is a fraction of the rectangle, and the circle
+// fades from solid in the middle to nothing at the radius. (Squared, since
+// the circle was itself blended onto black.)
+void CanvasBlob(canvas *c,
+                int left,
+                int top,
+                int right,
+                int bottom,
+                float radius,
+                gl_rgba color)
+{
+    int x;
+    int y;
+    int x1;
+    int x2;
+    float du;
+    float dv;
+    float fade;
+    float *distance;
+    unsigned char src[4];
+
+    x1 = MAX(left, 0);
+    x2 = MIN(right, c->size);
+    if((x1 >= x2) || (top >= bottom)) {
+        return;
+    }
+
+    du = 1.0f / (float)(right - left);
+    dv = 1.0f / (float)(bottom - top);
+    distance = (float *)malloc((x2 - x1) * sizeof(float));
+    for(y = MAX(top, 0); y < MIN(bottom, c->size); ++y) {
+        distance_row(distance,
+                     x2 - x1,
+                     (((float)(x1 - left) + 0.5f) * du) - 0.5f,
+                     du,
+                     (((float)(y - top) + 0.5f) * dv) - 0.5f);
+
+        for(x = x1; x < x2; ++x) {
+            fade = 1.0f - (distance[x - x1] / radius);
+            if(fade <= 0.0f) {
+                continue;
+            }
+
+            fade *= fade;
+            src[0] = to_byte(color.get_red() * fade);
+            src[1] = to_byte(color.get_green() * fade);
+            src[2] = to_byte(color.get_blue() * fade);
+            src[3] = to_byte(color.get_alpha() * fade);
+            blend(PIXEL(c, x, y), src);
+        }
+    }
+
+    free(distance);
+}
@@ -0,0 +1,67 @@
+#ifndef CANVAS_HPP_
+#define CANVAS_HPP_
+
+#include "gl-rgba.hpp"
+
+// A square block of RGBA8 pixels for building textures on the CPU.
+// Coordinates match the old glOrtho() setup, with (0, 0) at the top left,
+// but rows are stored bottom-up so the bits can go straight to
+// glTexImage2D(). Everything that draws blends the way
+// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) would.
+struct canvas {
+    int size;
+    unsigned char *bits;
+};
+
+canvas *CanvasCreate(int size);
+void CanvasDestroy(canvas *c);
+void CanvasClear(canvas *c, gl_rgba color);
+void CanvasFill(canvas *c,
+                int left,
+                int top,
+                int right,
+                int bottom,
+                gl_rgba color);
+
+void CanvasGradient(canvas *c,
+                    int top,
+                    int bottom,
+                    gl_rgba top_color,
+                    gl_rgba bottom_color);
+
+void CanvasPlot(canvas *c, int x, int y, gl_rgba color);
+void CanvasShade(canvas *c, int x, int y1, int y2, float alpha1, float alpha2);
+void CanvasLine(canvas *c,
+                int x1,
+                int y1,
+                int x2,
+                int y2,
+                int width,
+                gl_rgba color);
+
+void CanvasRectFan(canvas *c,
+                   int left,
+                   int top,
+                   int right,
+                   int bottom,
+                   gl_rgba center,
+                   gl_rgba edge);
+
+void CanvasFan(canvas *c,
+               float apex_x,
+               float apex_y,
+               float center_x,
+               float center_y,
+               float radius,
+               gl_rgba apex,
+               gl_rgba edge);
+
+void CanvasBlob(canvas *c,
+                int left,
+                int top,
+                int right,
+                int bottom,
+                float radius,
+                gl_rgba color);
+
+#endif /* CANVAS_HPP_ */
@@ -11,13 +11,15 @@
 
 #include <SDL.h>
 #include <cmath>
+#include <vector>
 
 #include "building.hpp"
 #include "camera.hpp"
-#include "gl-vector2.hpp"
 #include "macro.hpp"
 #include "math.hpp"
 #include "mesh.hpp"
+#include "pass.hpp"
+#include "profile.hpp"
 #include "random.hpp"
 #include "render.hpp"
 #include "texture.hpp"
@@ -40,16 +42,32 @@ static gl_vector3 direction[] = {
 
 static int dangles[] = { 0, 90, 180, 270 };
 
-static gl_vector2 angles[360];
-static bool angles_done;
+// Headlights coming toward the camera, taillights going away
+static unsigned char const headlight[4] = { 255, 255, 204, 255 };
+static unsigned char const taillight[4] = { 128, 51, 0, 255 };
+
 static unsigned char carmap[WORLD_SIZE][WORLD_SIZE];
 static Car *head;
 static unsigned next_update;
 static int count;
+static int active;
+static std::vector<pass_vertex> vertices;
 
+// Cars in play, which can be fewer than have been made
 int CarCount()
 {
-    return count;
+    return MIN(count, active);
+}
+
+// Make sure there are this many cars, and park any past that. Cars are
+// never freed, so going down and back up again costs nothing.
+void CarPopulate(int cars)
+{
+    while(count < cars) {
+        new Car();
+    }
+
+    active = cars;
 }
 
 void CarClear()
@@ -61,35 +79,37 @@ void CarClear()
     }
 
     memset(carmap, '\0', sizeof(carmap));
-    count = 0;
 }
 
-void CarRender()
+// Work out where every visible car's quad goes. There's no GL in here,
+// so it runs on a worker while the buildings are drawn.
+void CarPrepare()
 {
     Car *c;
+    pass_vertex quad[4];
 
-    if(!angles_done) {
-        for(int i = 0; i < 360; ++i) {
-            angles[i].set_x((float)cos((float)i * DEGREES_TO_RADIANS) * CAR_SIZE);
-            angles[i].set_y((float)sin((float)i * DEGREES_TO_RADIANS) * CAR_SIZE);
+    vertices.clear();
+    for(c = head; c; c = c->next_) {
+        if(c->Fill(quad)) {
+            vertices.insert(vertices.end(), quad, quad + 4);
         }
     }
+}
 
-    glDepthMask(false);
-    glEnable(GL_BLEND);
-    glDisable(GL_CULL_FACE);
-    glBlendFunc(GL_ONE, GL_ONE);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindTexture(GL_TEXTURE_2D, TextureId(TEXTURE_HEADLIGHT));
-    for(c = head; c; c = c->next_) {
-        c->Render();
+// Draw what CarPrepare() came up with
+void CarRender()
+{
+    if(vertices.empty()) {
+        return;
     }
 
-    glDepthMask(true);
+    glBindTexture(GL_TEXTURE_2D, TextureId(TEXTURE_HEADLIGHT));
+    PassQuads(&vertices[0], vertices.size());
 }
 
 void CarUpdate()
 {
+    PROFILE("CarUpdate");
     Car *c;
     unsigned int now;
 
@@ -115,7 +135,7 @@ Car::Car()
     ready_ = false;
     next_ = head;
     head = this;
-    count++;
+    index_ = count++;
 }
 
 bool Car::TestPosition(int row, int col)
@@ -137,9 +157,21 @@ void Car::Update(void)
 {
     int new_row;
     int new_col;
+    int angle;
+    int turn;
     gl_vector3 old_pos;
     gl_vector3 camera;
 
+    // We've got more cars than we want right now, so sit this one out
+    if(index_ >= active) {
+        if(ready_) {
+            carmap[row_][col_]--;
+            ready_ = false;
+        }
+
+        return;
+    }
+
     // If the car isn't ready, place it on the map and get it moving
     camera = camera_position();
     if(!ready_) {
@@ -157,7 +189,9 @@ void Car::Update(void)
             return;
         }
 
-        if(!Visible(gl_vector3((float)row_, 0.0f, (float)col_))) {
+        // Streets about to come into view get their traffic early, so
+        // it's already moving when the camera gets there
+        if(!VisibleSoon(gl_vector3((float)row_, 0.0f, (float)col_))) {
             return;
         }
 
@@ -196,7 +230,7 @@ void Car::Update(void)
     position_ += direction[direction_] * MOVEMENT_SPEED * speed_;
     
     // If the car has moved out of view, there's no need to keep simulating it
-    if(!Visible(gl_vector3((float)row_, 0.0f, (float)col_))) {
+    if(!VisibleSoon(gl_vector3((float)row_, 0.0f, (float)col_))) {
         ready_ = false;
     }
     
@@ -260,69 +294,90 @@ void Car::Update(void)
 
     drive_position_ = (drive_position_ + position_) / 2.0f;
 
+    // Steer toward where it's headed. This used to happen as it was drawn,
+    // which turned it faster the more times it got drawn in a frame.
+    angle = 360 - (int)MathAngle(position_.get_x(),
+                                 position_.get_z(),
+                                 drive_position_.get_x(),
+                                 drive_position_.get_z());
+
+    turn = (int)MathAngleDifference((float)drive_angle_, (float)(angle % 360));
+    drive_angle_ += SIGN(turn);
+
     // Place the car back on the map
     carmap[row_][col_]++;
 }
 
-void Car::Render()
+// Put the corners of this car into quad, unless it can't be seen
+bool Car::Fill(pass_vertex *quad)
 {
     gl_vector3 pos;
-    int angle;
-    int turn;
+    float angle;
+    float side_x;
+    float side_z;
     float top;
+    unsigned char const *color;
 
     if(!ready_) {
-        return;
+        return false;
     }
 
     if(!Visible(drive_position_)) {
-        return;
+        return false;
     }
 
     if(front_) {
-        glColor3f(1, 1, 0.8f);
+        color = headlight;
         top = CAR_SIZE;
     }
     else {
-        glColor3f(0.5, 0.2f, 0);
+        color = taillight;
         top = 0.0f;
     }
 
-    glBegin(GL_QUADS);
-    
-    angle = dangles[direction_];
     pos = drive_position_;
-    angle = 360 - (int)MathAngle(position_.get_x(),
-                                 position_.get_z(),
-                                 pos.get_x(),
-                                 pos.get_z());
+    angle = 360.0f - MathAngle(position_.get_x(),
+                               position_.get_z(),
+                               pos.get_x(),
+                               pos.get_z());
 
-    angle %= 360;
-    turn = (int)MathAngleDifference((float)drive_angle_, (float)angle);
-    drive_angle_ += SIGN(turn);
+    side_x = MathCos(angle) * CAR_SIZE;
+    side_z = MathSin(angle) * CAR_SIZE;
     pos += gl_vector3(0.5f, 0.0f, 0.5f);
 
-    glTexCoord2f(0, 0);
-    glVertex3f(pos.get_x() + angles[angle].get_x(), 
+    PassVertex(&quad[0],
+               0,
+               0,
+               color,
+               pos.get_x() + side_x,
                -CAR_SIZE,
-               pos.get_z() + angles[angle].get_y());
+               pos.get_z() + side_z);
 
-    glTexCoord2f(1, 0);
-    glVertex3f(pos.get_x() - angles[angle].get_x(),
+    PassVertex(&quad[1],
+               1,
+               0,
+               color,
+               pos.get_x() - side_x,
                -CAR_SIZE,
-               pos.get_z() - angles[angle].get_y());
+               pos.get_z() - side_z);
 
-    glTexCoord2f(1, 1);
-    glVertex3f(pos.get_x() - angles[angle].get_x(),
+    PassVertex(&quad[2],
+               1,
+               1,
+               color,
+               pos.get_x() - side_x,
                top,
-               pos.get_z() - angles[angle].get_y());
+               pos.get_z() - side_z);
 
-    glTexCoord2f(0, 1);
-    glVertex3f(pos.get_x() + angles[angle].get_x(),
+    PassVertex(&quad[3],
+               0,
+               1,
+               color,
+               pos.get_x() + side_x,
                top,
-               pos.get_z() + angles[angle].get_y());
+               pos.get_z() + side_z);
 
-    glEnd();
+    return true;
 }
 
 void Car::Park()
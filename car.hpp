@@ -2,12 +2,13 @@
 #define CAR_HPP_
 
 #include "gl-vector3.hpp"
+#include "pass.hpp"
 
 class Car {
 public:
     Car();
     bool TestPosition(int row, int col);
-    void Render();
+    bool Fill(pass_vertex *quad);
     void Update();
     void Park();
     
@@ -19,6 +20,7 @@ private:
     bool ready_;
     bool front_;
     int drive_angle_;
+    int index_;
     int row_;
     int col_;
     int direction_;
@@ -30,6 +32,8 @@ private:
 
 void CarClear();
 int CarCount();
+void CarPopulate(int cars);
+void CarPrepare();
 void CarRender();
 void CarUpdate();
 
@@ -0,0 +1,339 @@
+/*
+ * compress.cpp
+ *
+ * Squeezes finished textures down to BC1 (DXT1) before they go to the card,
+ * which takes an eighth of the memory of plain RGBA. This is the quick
+ * "bounding box" sort of encoder: each 4x4 block just uses the darkest and
+ * brightest corners of its colors as the two endpoints, pulled in a bit,
+ * and every pixel picks whichever of the four colors along that line it
+ * lands closest to. It's nowhere near as good as an offline tool, but the
+ * textures are mostly flat colors and soft noise, and it's fast enough to
+ * run on every texture the workers make.
+ *
+ */
+
+#include "compress.hpp"
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "glext.hpp"
+
+#define BLOCK_BYTES 8
+#define SWAP_PAIRS _MM_SHUFFLE(2, 3, 0, 1)
+
+// Order of the colors from the second endpoint to the first
+static unsigned int const remap[4] = { 1, 3, 2, 0 };
+
+static size_t level_size(int size)
+{
+    int blocks;
+
+    blocks = (size + 3) / 4;
+    return (size_t)blocks * blocks * BLOCK_BYTES;
+}
+
+// Pull one 4x4 block out of the image. Levels smaller than a block repeat
+// their edge pixels to fill it out.
+static void load_block(unsigned char const *src,
+                       int size,
+                       int bx,
+                       int by,
+                       unsigned int *block)
+{
+    int x;
+    int y;
+    int sx;
+    int sy;
+    unsigned int const *pixels;
+
+    pixels = (unsigned int const *)src;
+    for(y = 0; y < 4; ++y) {
+        sy = (by * 4) + y;
+        if(sy >= size) {
+            sy = size - 1;
+        }
+
+        for(x = 0; x < 4; ++x) {
+            sx = (bx * 4) + x;
+            if(sx >= size) {
+                sx = size - 1;
+            }
+
+            block[(y * 4) + x] = pixels[(sy * size) + sx];
+        }
+    }
+}
+
+static void bounds(unsigned char const *block,
+                   unsigned char *lo,
+                   unsigned char *hi)
+{
+#ifdef __SSE2__
+    int packed;
+    __m128i r0 = _mm_loadu_si128((__m128i const *)block);
+    __m128i r1 = _mm_loadu_si128((__m128i const *)(block + 16));
+    __m128i r2 = _mm_loadu_si128((__m128i const *)(block + 32));
+    __m128i r3 = _mm_loadu_si128((__m128i const *)(block + 48));
+    __m128i mn = _mm_min_epu8(_mm_min_epu8(r0, r1), _mm_min_epu8(r2, r3));
+    __m128i mx = _mm_max_epu8(_mm_max_epu8(r0, r1), _mm_max_epu8(r2, r3));
+
+    // Fold the four pixels in each down to one
+    mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 8));
+    mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 8));
+    mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 4));
+    mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 4));
+    packed = _mm_cvtsi128_si32(mn);
+    memcpy(lo, &packed, 4);
+    packed = _mm_cvtsi128_si32(mx);
+    memcpy(hi, &packed, 4);
+#else
+    int i;
+    int c;
+
+    for(c = 0; c < 4; ++c) {
+        lo[c] = hi[c] = block[c];
+    }
+
+    for(i = 1; i < 16; ++i) {
+        for(c = 0; c < 4; ++c) {
+            if(block[(i * 4) + c] < lo[c]) {
+                lo[c] = block[(i * 4) + c];
+            }
+
+            if(block[(i * 4) + c] > hi[c]) {
+                hi[c] = block[(i * 4) + c];
+            }
+        }
+    }
+#endif
+}
+
+static unsigned short to_565(unsigned char const *c)
+{
+    return ((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3);
+}
+
+// What the card will turn a 565 color back into
+static void from_565(unsigned short c, int *rgb)
+{
+    int r;
+    int g;
+    int b;
+
+    r = (c >> 11) & 31;
+    g = (c >> 5) & 63;
+    b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Project every pixel onto the line from e1 to e0 and pick the nearest of
+// the four colors on it. Comparing six times the projection against odd
+// multiples of the length keeps it all in integers.
+static unsigned int indices(unsigned char const *block,
+                            int const *e0,
+                            int const *e1)
+{
+    int i;
+    int k;
+    int t;
+    int dir[3];
+    int len;
+    int base;
+    int dots[16];
+    unsigned int bits;
+
+    dir[0] = e0[0] - e1[0];
+    dir[1] = e0[1] - e1[1];
+    dir[2] = e0[2] - e1[2];
+    len = (dir[0] * dir[0]) + (dir[1] * dir[1]) + (dir[2] * dir[2]);
+    if(!len) {
+        return 0;
+    }
+
+    base = (e1[0] * dir[0]) + (e1[1] * dir[1]) + (e1[2] * dir[2]);
+    i = 0;
+
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+    __m128i d = _mm_setr_epi16(dir[0], dir[1], dir[2], 0,
+                               dir[0], dir[1], dir[2], 0);
+
+    for(/* empty */; i < 16; i += 4) {
+        __m128i p = _mm_loadu_si128((__m128i const *)(block + (i * 4)));
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(p, zero), d);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(p, zero), d);
+
+        // Each pixel is now red+green and blue+alpha. Add the halves.
+        lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, SWAP_PAIRS));
+        hi = _mm_add_epi32(hi, _mm_shuffle_epi32(hi, SWAP_PAIRS));
+        lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 0, 2, 0));
+        hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 0, 2, 0));
+        _mm_storeu_si128((__m128i *)&dots[i], _mm_unpacklo_epi64(lo, hi));
+    }
+#endif
+
+    for(/* empty */; i < 16; ++i) {
+        dots[i] = (block[(i * 4)] * dir[0])
+            + (block[(i * 4) + 1] * dir[1])
+            + (block[(i * 4) + 2] * dir[2]);
+    }
+
+    bits = 0;
+    for(i = 0; i < 16; ++i) {
+        t = (dots[i] - base) * 6;
+        k = (t > len) + (t > (len * 3)) + (t > (len * 5));
+        bits |= remap[k] << (i * 2);
+    }
+
+    return bits;
+}
+
+static void encode_block(unsigned char const *block, unsigned char *dst)
+{
+    int c;
+    int inset;
+    int e0[3];
+    int e1[3];
+    unsigned char lo[4];
+    unsigned char hi[4];
+    unsigned short c0;
+    unsigned short c1;
+    unsigned int bits;
+
+    bounds(block, lo, hi);
+
+    // Pulling the ends in a little puts the in-between colors where most
+    // of the pixels actually are.
+    for(c = 0; c < 3; ++c) {
+        inset = (hi[c] - lo[c]) >> 4;
+        hi[c] -= inset;
+        lo[c] += inset;
+    }
+
+    // Every channel of hi is at least that of lo, so c0 can't be less than
+    // c1. If they're equal the block is one flat color and index 0 is it.
+    c0 = to_565(hi);
+    c1 = to_565(lo);
+    bits = 0;
+    if(c0 != c1) {
+        from_565(c0, e0);
+        from_565(c1, e1);
+        bits = indices(block, e0, e1);
+    }
+
+    dst[0] = c0 & 0xff;
+    dst[1] = c0 >> 8;
+    dst[2] = c1 & 0xff;
+    dst[3] = c1 >> 8;
+    dst[4] = bits & 0xff;
+    dst[5] = (bits >> 8) & 0xff;
+    dst[6] = (bits >> 16) & 0xff;
+    dst[7] = bits >> 24;
+}
+
+// Bytes taken by an image and the first few of its smaller versions once
+// they've been compressed
+size_t CompressChainSize(int size, int levels)
+{
+    size_t bytes;
+
+    bytes = 0;
+    while(levels-- > 0) {
+        bytes += level_size(size);
+        size /= 2;
+    }
+
+    return bytes;
+}
+
+// Compress one size x size RGBA image. Alpha is thrown away.
+void CompressBC1(unsigned char const *src, unsigned char *dst, int size)
+{
+    int bx;
+    int by;
+    int blocks;
+    unsigned int block[16];
+
+    blocks = (size + 3) / 4;
+    for(by = 0; by < blocks; ++by) {
+        for(bx = 0; bx < blocks; ++bx) {
+            load_block(src, size, bx, by, block);
+            encode_block((unsigned char const *)block, dst);
+            dst += BLOCK_BYTES;
+        }
+    }
+}
+
+// Compress a whole chain as laid out by MipmapBuild()
+void CompressChain(unsigned char const *chain,
+                   unsigned char *dst,
+                   int size,
+                   int levels)
+{
+    while(levels-- > 0) {
+        CompressBC1(chain, dst, size);
+        chain += (size_t)size * size * 4;
+        dst += level_size(size);
+        size /= 2;
+    }
+}
+
+// A layer of -1 means a plain 2D texture, as with the uncompressed uploads
+static void upload_chain(unsigned char const *chain,
+                         int size,
+                         int levels,
+                         int layer)
+{
+    int level;
+
+    for(level = 0; level < levels; ++level) {
+        if(layer < 0) {
+            pglCompressedTexImage2D(GL_TEXTURE_2D,
+                                    level,
+                                    GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                    size,
+                                    size,
+                                    0,
+                                    level_size(size),
+                                    chain);
+        }
+        else {
+            pglCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY_EXT,
+                                       level,
+                                       0,
+                                       0,
+                                       layer,
+                                       size,
+                                       size,
+                                       1,
+                                       GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                       level_size(size),
+                                       chain);
+        }
+
+        chain += level_size(size);
+        size /= 2;
+    }
+}
+
+void CompressUpload(unsigned char const *chain, int size, int levels)
+{
+    upload_chain(chain, size, levels, -1);
+}
+
+void CompressUploadLayer(unsigned char const *chain,
+                         int size,
+                         int levels,
+                         int layer)
+{
+    upload_chain(chain, size, levels, layer);
+}
@@ -0,0 +1,19 @@
+#ifndef COMPRESS_HPP_
+#define COMPRESS_HPP_
+
+#include <cstddef>
+
+size_t CompressChainSize(int size, int levels);
+void CompressBC1(unsigned char const *src, unsigned char *dst, int size);
+void CompressChain(unsigned char const *chain,
+                   unsigned char *dst,
+                   int size,
+                   int levels);
+
+void CompressUpload(unsigned char const *chain, int size, int levels);
+void CompressUploadLayer(unsigned char const *chain,
+                         int size,
+                         int levels,
+                         int layer);
+
+#endif /* COMPRESS_HPP_ */
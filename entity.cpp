@@ -16,16 +16,23 @@
 #include <SDL.h>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 
 #include "camera.hpp"
 #include "macro.hpp"
 #include "math.hpp"
+#include "pass.hpp"
+#include "profile.hpp"
 #include "render.hpp"
 #include "texture.hpp"
 #include "visible.hpp"
 #include "win.hpp"
 #include "world.hpp"
 
+// How long we're willing to spend each frame compiling the next city while
+// the current one is on display. (Milliseconds)
+#define PENDING_COMPILE_TIME 2
+
 struct entity {
     Entity *object;
 };
@@ -38,17 +45,40 @@ struct cell {
     gl_vector3 pos;
 };
 
-static cell cell_list[GRID_SIZE][GRID_SIZE];
-static int entity_count;
-static entity *entity_list;
-static bool sorted;
-static bool compiled;
-static int polycount;
-static int compile_x;
-static int compile_y;
-static int compile_count;
+// Everything that makes up one city's worth of entities. There are two of
+// these: the one on screen, and the one the generator is filling in the
+// background.
+struct entity_set {
+    cell cell_list[GRID_SIZE][GRID_SIZE];
+    int entity_count;
+    entity *entity_list;
+    bool sorted;
+    bool compiled;
+    bool built;
+    int polycount;
+    visible_bounds bounds;
+    bool cell_done[GRID_SIZE][GRID_SIZE];
+    int compile_count;
+};
+
+static entity_set sets[2];
+static entity_set *live = &sets[0];
+static entity_set *pending = &sets[1];
 static int compile_end;
 
+// Note how much room an entity takes up, in its cell's box and in the
+// height field
+static void add_bounds(entity_set *s, Entity *e, gl_bbox *cell_box)
+{
+    gl_bbox box;
+
+    box.clear();
+    e->bounds(&box);
+    VisibleBoundsStamp(&s->bounds, box);
+    cell_box->contain_point(box.get_min());
+    cell_box->contain_point(box.get_max());
+}
+
 static int do_compare(const void *arg1, const void *arg2)
 {
     struct entity *e1 = (struct entity *)arg1;
@@ -70,29 +100,73 @@ static int do_compare(const void *arg1, const void *arg2)
     return 0;
 }
 
+// New entities always go into the city being built
 void add(Entity *b)
 {
-    entity_list = (entity *)realloc(entity_list, 
-                                    sizeof(entity) * (entity_count + 1));
+    pending->entity_list = 
+        (entity *)realloc(pending->entity_list,
+                          sizeof(entity) * (pending->entity_count + 1));
     
-    entity_list[entity_count].object = b;
-    entity_count++;
+    pending->entity_list[pending->entity_count].object = b;
+    pending->entity_count++;
     
-    polycount = 0;
+    pending->polycount = 0;
+}
+
+// Which cell to compile next. For the city on screen, cells in view go
+// first and then ones about to come into view, so it fills in wherever
+// it's being looked at. Otherwise it's just the next one along.
+static void next_cell(entity_set *s, int *cell_x, int *cell_y)
+{
+    int x;
+    int y;
+    int rank;
+    int best;
+
+    best = -1;
+    for(y = 0; y < GRID_SIZE; ++y) {
+        for(x = 0; x < GRID_SIZE; ++x) {
+            if(s->cell_done[x][y]) {
+                continue;
+            }
+
+            rank = 0;
+            if(s == live) {
+                rank = Visible(x, y) ? 2 : (VisibleSoon(x, y) ? 1 : 0);
+            }
+
+            if(rank > best) {
+                best = rank;
+                *cell_x = x;
+                *cell_y = y;
+            }
+
+            if((best == 2) || ((best == 0) && (s != live))) {
+                return;
+            }
+        }
+    }
 }
 
-static void do_compile()
+static void do_compile(entity_set *s)
 {
+    PROFILE("do_compile");
     int i;
     int x;
     int y;
+    cell *c;
+    entity *entity_list;
+    int entity_count;
+    gl_bbox box;
     
-    if(compiled) {
+    if(s->compiled) {
         return;
     }
 
-    x = compile_x;
-    y = compile_y;
+    next_cell(s, &x, &y);
+    c = &s->cell_list[x][y];
+    entity_list = s->entity_list;
+    entity_count = s->entity_count;
 
     // Changing texture is pretty expensive, and thus sorting the entities
     // so that they are grouped by texture used can really improve
@@ -102,36 +176,36 @@ static void do_compile()
 
     // Not group entities on the grid
     // Make a list for the textured objects in this region
-    if(!cell_list[x][y].list_textured) {
-        cell_list[x][y].list_textured = glGenLists(1);
+    if(!c->list_textured) {
+        c->list_textured = glGenLists(1);
     }
 
-    glNewList(cell_list[x][y].list_textured, GL_COMPILE);
-    cell_list[x][y].pos = gl_vector3(GRID_TO_WORLD(x), 
-                                     0.0f, 
-                                     (float)y * GRID_RESOLUTION);
+    glNewList(c->list_textured, GL_COMPILE);
+    c->pos = gl_vector3(GRID_TO_WORLD(x), 0.0f, (float)y * GRID_RESOLUTION);
 
+    // While we're going through what's in the cell, note how much room
+    // it all takes up
+    box.clear();
     for(i = 0; i < entity_count; ++i) {
         gl_vector3 pos = entity_list[i].object->center();
         if((WORLD_TO_GRID(pos.get_x()) == x)
            && (WORLD_TO_GRID(pos.get_z()) == y)
            && !entity_list[i].object->alpha()) {
-            glBindTexture(GL_TEXTURE_2D, entity_list[i].object->texture());
+            TextureBind(entity_list[i].object->texture());
             entity_list[i].object->render();
+            add_bounds(s, entity_list[i].object, &box);
         }
     }
+    TextureBind(0);
     glEndList();
 
     // Make a list of flat-color stuff (A/C units, ledges, roofs, etc.)
-    if(!cell_list[x][y].list_flat) {
-        cell_list[x][y].list_flat = glGenLists(1);
+    if(!c->list_flat) {
+        c->list_flat = glGenLists(1);
     }
 
-    glNewList(cell_list[x][y].list_flat, GL_COMPILE);
-    glEnable(GL_CULL_FACE);
-    cell_list[x][y].pos = gl_vector3(GRID_TO_WORLD(x),
-                                     0.0f, 
-                                     (float)y * GRID_RESOLUTION);
+    glNewList(c->list_flat, GL_COMPILE);
+    c->pos = gl_vector3(GRID_TO_WORLD(x), 0.0f, (float)y * GRID_RESOLUTION);
 
     for(i = 0; i < entity_count; ++i) {
         gl_vector3 pos = entity_list[i].object->center();
@@ -144,15 +218,12 @@ static void do_compile()
     glEndList();
     
     // Now a list of flat-colored stuff that will be wireframe friendly
-    if(!cell_list[x][y].list_flat_wireframe) {
-        cell_list[x][y].list_flat_wireframe = glGenLists(1);
+    if(!c->list_flat_wireframe) {
+        c->list_flat_wireframe = glGenLists(1);
     }
 
-    glNewList(cell_list[x][y].list_flat_wireframe, GL_COMPILE);
-    glEnable(GL_CULL_FACE);
-    cell_list[x][y].pos = gl_vector3(GRID_TO_WORLD(x),
-                                     0.0f,
-                                     (float)y * GRID_RESOLUTION);
+    glNewList(c->list_flat_wireframe, GL_COMPILE);
+    c->pos = gl_vector3(GRID_TO_WORLD(x), 0.0f, (float)y * GRID_RESOLUTION);
     
     for(i = 0; i < entity_count; ++i) {
         gl_vector3 pos = entity_list[i].object->center();
@@ -165,82 +236,178 @@ static void do_compile()
     glEndList();
 
     // Now a list of stuff to be alpha-blended, and thus rendered last
-    if(!cell_list[x][y].list_alpha) {
-        cell_list[x][y].list_alpha = glGenLists(1);
+    if(!c->list_alpha) {
+        c->list_alpha = glGenLists(1);
     }
     
-    glNewList(cell_list[x][y].list_alpha, GL_COMPILE);
-    cell_list[x][y].pos = gl_vector3(GRID_TO_WORLD(x),
-                                     0.0f,
-                                     (float)y * GRID_RESOLUTION);
-    glDepthMask(false);
-    glEnable(GL_BLEND);
-    glDisable(GL_CULL_FACE);
+    glNewList(c->list_alpha, GL_COMPILE);
+    c->pos = gl_vector3(GRID_TO_WORLD(x), 0.0f, (float)y * GRID_RESOLUTION);
     for(i = 0; i < entity_count; ++i) {
         gl_vector3 pos = entity_list[i].object->center();
         if((WORLD_TO_GRID(pos.get_x()) == x)
            && (WORLD_TO_GRID(pos.get_z()) == y)
            && entity_list[i].object->alpha()) {
-            glBindTexture(GL_TEXTURE_2D, entity_list[i].object->texture());
+            TextureBind(entity_list[i].object->texture());
             entity_list[i].object->render();
+            add_bounds(s, entity_list[i].object, &box);
         }
     }
-    glDepthMask(true);
+    TextureBind(0);
     glEndList();
-
-    // Now walk the grid
-    compile_x++;
-    if(compile_x == GRID_SIZE) {
-        compile_x = 0;
-        compile_y++;
-        if(compile_y == GRID_SIZE) {
-            compiled = true;
+    VisibleBoundsCell(&s->bounds, x, y, box);
+
+    s->cell_done[x][y] = true;
+    s->compile_count++;
+    if(s->compile_count == (GRID_SIZE * GRID_SIZE)) {
+        s->compiled = true;
+        VisibleBoundsBuild(&s->bounds);
+        if(s == live) {
+            VisibleBoundsUse(&s->bounds);
         }
 
         compile_end = SDL_GetTicks();
     }
+}
+
+// Throw away every entity in the set and blank out its render lists
+static void clear_set(entity_set *s)
+{
+    int x;
+    int y;
+
+    for(int i = 0; i < s->entity_count; ++i) {
+        delete s->entity_list[i].object;
+    }
+
+    if(s->entity_list) {
+        free(s->entity_list);
+    }
+
+    s->entity_list = NULL;
+    s->entity_count = 0;
+    memset(s->cell_done, 0, sizeof(s->cell_done));
+    s->compile_count = 0;
+    s->compiled = false;
+    s->sorted = false;
+    s->built = false;
+    s->polycount = 0;
+    VisibleBoundsClear(&s->bounds);
+
+    for(x = 0; x < GRID_SIZE; ++x) {
+        for(y = 0; y < GRID_SIZE; ++y) {
+            cell *c = &s->cell_list[x][y];
+
+            if(!c->list_textured) {
+                continue;
+            }
 
-    compile_count++;
+            glNewList(c->list_textured, GL_COMPILE);
+            glEndList();
+            glNewList(c->list_alpha, GL_COMPILE);
+            glEndList();
+            glNewList(c->list_flat_wireframe, GL_COMPILE);
+            glEndList();
+            glNewList(c->list_flat, GL_COMPILE);
+            glEndList();
+        }
+    }
 }
 
 bool EntityReady()
 {
-    return compiled;
+    return live->compiled;
 }
 
 float EntityProgress()
 {
-    return (float)compile_count / (GRID_SIZE * GRID_SIZE);
+    return (float)live->compile_count / (GRID_SIZE * GRID_SIZE);
+}
+
+// The generator has finished filling the pending set, so it's safe to
+// start compiling it.
+void EntityPendingDone()
+{
+    pending->built = true;
+}
+
+// Is the city being built completely generated and compiled? Once it is,
+// there's nothing left for EntityUpdate to do until the next swap, which
+// is what WorldSettled() waits for.
+bool EntityPendingReady()
+{
+    return pending->compiled;
+}
+
+// Put the pending city on screen and throw away the old one
+void EntitySwap()
+{
+    entity_set *old;
+
+    old = live;
+    live = pending;
+    pending = old;
+    VisibleBoundsUse(&live->bounds);
+    clear_set(pending);
 }
 
 void EntityUpdate()
 {
+    PROFILE("EntityUpdate");
     unsigned int stop_time;
 
     if(!TextureReady()) {
-        sorted = false;
+        live->sorted = false;
         return;
     }
     
-    if(!sorted) {
-        qsort(entity_list, entity_count, sizeof(struct entity), do_compare);
-        sorted = true;
+    if(!live->sorted) {
+        qsort(live->entity_list,
+              live->entity_count,
+              sizeof(struct entity),
+              do_compare);
+
+        live->sorted = true;
     }
 
     // We want to do several cells at once. Enough to get things done, but
     // not so many that they program is unresponsive.
-    if(LOADING_SCREEN) {
-        // If we're using a loading screen, we want to build as
-        // fast as possible
-        stop_time = SDL_GetTicks() + 100;
-        while(!compiled && (SDL_GetTicks() < stop_time)) {
-            do_compile();
+    if(!live->compiled) {
+        if(LOADING_SCREEN) {
+            // If we're using a loading screen, we want to build as
+            // fast as possible
+            stop_time = SDL_GetTicks() + 100;
+            while(!live->compiled && (SDL_GetTicks() < stop_time)) {
+                do_compile(live);
+            }
+        }
+        else {
+            // Take it slow
+            do_compile(live);
         }
+
+        return;
+    }
+
+    // The city on screen is done, so trickle the next one in behind it
+    // a little at a time. The user never sees this happen.
+    if(!pending->built || pending->compiled) {
+        return;
     }
-    else {
-        // Take it slow
-        do_compile();
+
+    if(!pending->sorted) {
+        qsort(pending->entity_list,
+              pending->entity_count,
+              sizeof(struct entity),
+              do_compare);
+
+        pending->sorted = true;
+        return;
     }
+
+    stop_time = SDL_GetTicks() + PENDING_COMPILE_TIME;
+    do {
+        do_compile(pending);
+    } while(!pending->compiled && (SDL_GetTicks() < stop_time));
 }
     
 void EntityRender()
@@ -255,7 +422,7 @@ void EntityRender()
     glGetIntegerv(GL_POLYGON_MODE, &polymode[0]);
     wireframe = (polymode[0] != GL_FILL);
     if(RenderFlat()) {
-        glDisable(GL_TEXTURE_2D);
+        PassEnable(GL_TEXTURE_2D, false);
     }
 
     // If we're not using a loading screen, make the wireframe fade out via fog
@@ -269,25 +436,28 @@ void EntityRender()
         }
     }
 
+    TexturePrepare();
     for(x = 0; x < GRID_SIZE; ++x) {
         for(y = 0; y < GRID_SIZE; ++y) {
             if(Visible(x, y)) {
-                glCallList(cell_list[x][y].list_textured);
+                glCallList(live->cell_list[x][y].list_textured);
             }
         }
     }
 
-    // Draw all flat colored objects
+    // Draw all flat colored objects. State changes go through the pass
+    // cache rather than into the lists, so it always knows what's set.
     glBindTexture(GL_TEXTURE_2D, 0);
     glColor3f(0, 0, 0);
+    PassEnable(GL_CULL_FACE, true);
     for(x = 0; x < GRID_SIZE; ++x) {
         for(y = 0; y < GRID_SIZE; ++y) {
             if(Visible(x, y)) {
                 if(wireframe) {
-                    glCallList(cell_list[x][y].list_flat_wireframe);
+                    glCallList(live->cell_list[x][y].list_flat_wireframe);
                 }
                 else {
-                    glCallList(cell_list[x][y].list_flat);
+                    glCallList(live->cell_list[x][y].list_flat);
                 }
             }
         }
@@ -296,53 +466,41 @@ void EntityRender()
     // Draw all alpha-blended objects
     glBindTexture(GL_TEXTURE_2D, 0);
     glColor3f(0, 0, 0);
-    glEnable(GL_BLEND);
+    PassEnable(GL_BLEND, true);
+    PassEnable(GL_CULL_FACE, false);
+    PassDepthMask(false);
     for(x = 0; x < GRID_SIZE; ++x) {
         for(y = 0; y < GRID_SIZE; ++y) {
             if(Visible(x, y)) {
-                glCallList(cell_list[x][y].list_alpha);
+                glCallList(live->cell_list[x][y].list_alpha);
             }
         }
     }
+
+    PassDepthMask(true);
 }
 
+// Throw away the city being built, so the generator can start a new one.
+// This touches GL, so it has to happen on the main thread before the
+// generator gets going.
 void EntityClear()
 {
-    for(int i = 0; i < entity_count; ++i) {
-        delete entity_list[i].object;
-    }
-
-    if(entity_list) {
-        free(entity_list);
-    }
+    clear_set(pending);
+}
 
-    entity_list = NULL;
-    entity_count = 0;
-    compile_x = 0;
-    compile_y = 0;
-    compile_count = 0;
-    compiled = false;
-    sorted = false;
+int EntityCount()
+{
+    return live->entity_count;
+}
 
-    int x;
-    int y;
-    for(x = 0; x < GRID_SIZE; ++x) {
-        for(y = 0; y < GRID_SIZE; ++y) {
-            glNewList(cell_list[x][y].list_textured, GL_COMPILE);
-            glEndList();
-            glNewList(cell_list[x][y].list_alpha, GL_COMPILE);
-            glEndList();
-            glNewList(cell_list[x][y].list_flat_wireframe, GL_COMPILE);
-            glEndList();
-            glNewList(cell_list[x][y].list_flat, GL_COMPILE);
-            glEndList();
-        }
-    }
+int EntityPendingCount()
+{
+    return pending->entity_count;
 }
 
-int EntityCount()
+Entity *EntityPendingAt(int index)
 {
-    return entity_count;
+    return pending->entity_list[index].object;
 }
 
 void EnitityInit(void)
@@ -351,19 +509,19 @@ void EnitityInit(void)
 
 int EntityPolyCount(void)
 {
-    if(!sorted) {
+    if(!live->sorted) {
         return 0;
     }
     
-    if(polycount) {
-        return polycount;
+    if(live->polycount) {
+        return live->polycount;
     }
 
-    for(int i = 0; i < entity_count; ++i) {
-        polycount += entity_list[i].object->poly_count();
+    for(int i = 0; i < live->entity_count; ++i) {
+        live->polycount += live->entity_list[i].object->poly_count();
     }
 
-    return polycount;
+    return live->polycount;
 }
 
 Entity::Entity(void)
@@ -406,3 +564,21 @@ int Entity::poly_count()
 {
     return 0;
 }
+
+// The mesh drawn by render(), if there is one
+Mesh *Entity::mesh()
+{
+    return NULL;
+}
+
+gl_rgba Entity::color()
+{
+    return gl_rgba(0.0f);
+}
+
+// Grow box to take in everything this draws. Without a mesh to go on,
+// all we know is where it is.
+void Entity::bounds(gl_bbox *box)
+{
+    box->contain_point(center_);
+}
@@ -1,8 +1,12 @@
 #ifndef ENTITY_HPP_
 #define ENTITY_HPP_
 
+#include "gl-bbox.hpp"
+#include "gl-rgba.hpp"
 #include "gl-vector3.hpp"
 
+class Mesh;
+
 class Entity {
 public:
     Entity();;
@@ -13,6 +17,9 @@ public:
     virtual void update();
     virtual bool alpha();
     virtual int poly_count();
+    virtual Mesh *mesh();
+    virtual gl_rgba color();
+    virtual void bounds(gl_bbox *box);
     gl_vector3 center();
 
 protected:
@@ -21,6 +28,11 @@ protected:
 
 void EntityClear();
 int EntityCount();
+int EntityPendingCount();
+Entity *EntityPendingAt(int index);
+void EntityPendingDone();
+bool EntityPendingReady();
+void EntitySwap();
 float EntityProgress();
 bool EntityReady();
 void EntityRender();
@@ -0,0 +1,342 @@
+/*
+ * font.cpp
+ *
+ * A tiny 8x8 bitmap font, baked into a texture when we start up, so text
+ * works the same everywhere without asking the system for fonts. Printing
+ * just queues up one textured quad per character. FontFlush() draws the
+ * whole queue at once, so a screen full of text costs a single draw call.
+ *
+ */
+
+#include "font.hpp"
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+#include <vector>
+
+#define FIRST_CHAR 32
+#define CHAR_COUNT 95
+#define GLYPH_PIXELS 8
+#define ATLAS_COLUMNS 16
+#define ATLAS_WIDTH (ATLAS_COLUMNS * GLYPH_PIXELS)
+// Rounded up to a power of two
+#define ATLAS_HEIGHT 64
+// The bottom row of each glyph is for descenders
+#define BASELINE (7.0f / 8.0f)
+
+using namespace std;
+
+// Laid out for glInterleavedArrays(GL_T2F_C4UB_V3F)
+struct font_vertex {
+    float s;
+    float t;
+    unsigned char color[4];
+    float x;
+    float y;
+    float z;
+};
+
+// Stand-ins for the handful of different fonts the logos used to pick from
+struct font_style {
+    float width;
+    float slant;
+    bool bold;
+};
+
+// One byte per row, top row first, lowest bit on the left
+static unsigned char const glyphs[CHAR_COUNT][GLYPH_PIXELS] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // space
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // !
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // #
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // $
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // %
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // &
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // (
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // )
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // *
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // +
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ,
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // .
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // /
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // 0
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // 1
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // 2
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // 3
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // 4
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // 5
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // 6
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // 7
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // 8
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // 9
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // :
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ;
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // <
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // =
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // >
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // ?
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // @
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // A
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // B
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // C
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // D
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // E
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // F
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // G
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // H
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // I
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // J
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // K
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // L
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // M
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // N
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // O
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // P
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // Q
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // R
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // S
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // T
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // U
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // V
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // W
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // X
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // Y
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // Z
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // [
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // backslash
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ]
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // _
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // `
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // a
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // b
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // c
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // d
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // e
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // f
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // g
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // h
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // i
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // j
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // k
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // l
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // m
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // n
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // o
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // p
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // q
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // r
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // s
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // t
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // u
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // v
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // w
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // x
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // y
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // z
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // {
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // |
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // }
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ~
+};
+
+static font_style const styles[FONT_STYLES] = {
+    { 1.0f, 0.0f, false },   // plain
+    { 1.0f, 0.0f, true },    // bold
+    { 1.0f, 0.25f, false },  // italic
+    { 1.25f, 0.0f, false },  // wide
+    { 0.75f, 0.0f, false },  // narrow
+    { 1.0f, 0.25f, true },   // bold italic
+    { 0.875f, 0.0f, true },  // condensed
+};
+
+static GLuint atlas;
+static vector<font_vertex> batch;
+
+static void add_vertex(float s,
+                       float t,
+                       unsigned char const *color,
+                       float x,
+                       float y)
+{
+    font_vertex v;
+
+    v.s = s;
+    v.t = t;
+    v.color[0] = color[0];
+    v.color[1] = color[1];
+    v.color[2] = color[2];
+    v.color[3] = color[3];
+    v.x = x;
+    v.y = y;
+    v.z = 0.0f;
+    batch.push_back(v);
+}
+
+static void add_glyph(float x,
+                      float top,
+                      float width,
+                      float height,
+                      float slant,
+                      int glyph,
+                      unsigned char const *color)
+{
+    float s0;
+    float s1;
+    float t0;
+    float t1;
+
+    s0 = (float)((glyph % ATLAS_COLUMNS) * GLYPH_PIXELS) / ATLAS_WIDTH;
+    s1 = s0 + ((float)GLYPH_PIXELS / ATLAS_WIDTH);
+    t0 = (float)((glyph / ATLAS_COLUMNS) * GLYPH_PIXELS) / ATLAS_HEIGHT;
+    t1 = t0 + ((float)GLYPH_PIXELS / ATLAS_HEIGHT);
+
+    // Leaning the top of the quad over makes a passable italic
+    add_vertex(s0, t1, color, x, top + height);
+    add_vertex(s1, t1, color, x + width, top + height);
+    add_vertex(s1, t0, color, x + width + slant, top);
+    add_vertex(s0, t0, color, x + slant, top);
+}
+
+// Queue up a line of text. y is the baseline, and size is the height of a
+// whole character cell, descender included.
+void FontPrint(float x,
+               float y,
+               float size,
+               int style,
+               gl_rgba color,
+               char const *text)
+{
+    int glyph;
+    float top;
+    float width;
+    float slant;
+    unsigned char rgba[4];
+    font_style const *fs;
+
+    fs = &styles[style % FONT_STYLES];
+    width = size * fs->width;
+    slant = size * fs->slant;
+    top = y - (size * BASELINE);
+    rgba[0] = (unsigned char)(color.get_red() * 255.0f);
+    rgba[1] = (unsigned char)(color.get_green() * 255.0f);
+    rgba[2] = (unsigned char)(color.get_blue() * 255.0f);
+    rgba[3] = (unsigned char)(color.get_alpha() * 255.0f);
+
+    for(/* empty */; *text; ++text, x += width) {
+        glyph = (unsigned char)*text - FIRST_CHAR;
+        if((glyph <= 0) || (glyph >= CHAR_COUNT)) {
+            continue;
+        }
+
+        add_glyph(x, top, width, size, slant, glyph, rgba);
+        if(fs->bold) {
+            add_glyph(x + (size / 16), top, width, size, slant, glyph, rgba);
+        }
+    }
+}
+
+// Draw everything queued so far, in pixels from the top left of a
+// width x height area, and empty the queue.
+void FontFlush(int width, int height)
+{
+    if(batch.empty()) {
+        return;
+    }
+
+    glPushAttrib(GL_ENABLE_BIT
+                 | GL_COLOR_BUFFER_BIT
+                 | GL_DEPTH_BUFFER_BIT
+                 | GL_POLYGON_BIT
+                 | GL_TEXTURE_BIT);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, width, height, 0, 0.1f, 2048);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glTranslatef(0, 0, -1.0f);
+
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(false);
+    glDisable(GL_FOG);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_LIGHTING);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    glInterleavedArrays(GL_T2F_C4UB_V3F, 0, &batch[0]);
+    glDrawArrays(GL_QUADS, 0, batch.size());
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopAttrib();
+    batch.clear();
+}
+
+void FontTerm(void)
+{
+    glDeleteTextures(1, &atlas);
+    atlas = 0;
+    batch.clear();
+}
+
+// Spread the glyphs out into a texture, white where there's ink, and let
+// the color come from the vertices.
+void FontInit(void)
+{
+    int i;
+    int x;
+    int y;
+    int left;
+    int top;
+    static unsigned char pixels[ATLAS_WIDTH * ATLAS_HEIGHT];
+
+    for(i = 0; i < CHAR_COUNT; ++i) {
+        left = (i % ATLAS_COLUMNS) * GLYPH_PIXELS;
+        top = (i / ATLAS_COLUMNS) * GLYPH_PIXELS;
+        for(y = 0; y < GLYPH_PIXELS; ++y) {
+            for(x = 0; x < GLYPH_PIXELS; ++x) {
+                if(glyphs[i][y] & (1 << x)) {
+                    pixels[((top + y) * ATLAS_WIDTH) + left + x] = 255;
+                }
+            }
+        }
+    }
+
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_ALPHA,
+                 ATLAS_WIDTH,
+                 ATLAS_HEIGHT,
+                 0,
+                 GL_ALPHA,
+                 GL_UNSIGNED_BYTE,
+                 pixels);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // Blocky is the look we want when these get scaled up
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,19 @@
+#ifndef FONT_HPP_
+#define FONT_HPP_
+
+#include "gl-rgba.hpp"
+
+#define FONT_STYLES 7
+
+void FontInit(void);
+void FontTerm(void);
+void FontPrint(float x,
+               float y,
+               float size,
+               int style,
+               gl_rgba color,
+               char const *text);
+
+void FontFlush(int width, int height);
+
+#endif /* FONT_HPP_ */
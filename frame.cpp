@@ -0,0 +1,257 @@
+/*
+ * frame.cpp
+ *
+ * Somewhere other than the screen to draw the city. The frame goes into a
+ * texture the size of the window and is copied out to the screen once it's
+ * done, which lets the bloom make its glow from it. It also lets us draw
+ * into only part of the texture and stretch that over the window. How big
+ * that part is follows how long the card has been taking over the frame,
+ * so a huge display on a modest card gets a bit softer in the busy parts
+ * of the city instead of missing frames. The timings are read back a few
+ * frames late, so we never sit waiting on the card for them.
+ *
+ */
+
+#include "frame.hpp"
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+#include <cmath>
+
+#include "glext.hpp"
+#include "ini.hpp"
+#include "macro.hpp"
+
+#define QUERIES 4
+#define MIN_SCALE 0.5f
+// Milliseconds, leaving some room under a 60Hz refresh
+#define DEFAULT_TARGET 14
+// How much of each new timing goes into the running average
+#define SMOOTHING 0.2f
+// Only grow back once there's clearly time to spare, and then slowly
+#define SLACK 0.8f
+#define GROW 1.02f
+#define SHRINK 0.9f
+
+static bool ready;
+static bool failed;
+static GLuint fbo;
+static GLuint depth;
+static GLuint texture;
+static int width;
+static int height;
+static float scale = 1.0f;
+static bool scaling;
+static float target;
+static float average;
+static GLuint queries[QUERIES];
+static int query_next;
+static int query_pending;
+static bool query_running;
+
+// Pixels cost about the square of the scale, so that's how far to go to
+// hit the target. Take it a step at a time since the timings lag behind.
+static void adjust(float ms)
+{
+    if(average == 0.0f) {
+        average = ms;
+    }
+
+    average += (ms - average) * SMOOTHING;
+    if(average > target) {
+        scale *= MAX(sqrtf(target / average), SHRINK);
+    }
+    else if(average < (target * SLACK)) {
+        scale *= GROW;
+    }
+
+    scale = CLAMP(scale, MIN_SCALE, 1.0f);
+}
+
+// Collect whatever timings the card has finished with, oldest first
+static void read_timers(void)
+{
+    GLint available;
+    GLuint64 elapsed;
+    GLuint query;
+
+    while(query_pending) {
+        query = queries[(query_next + QUERIES - query_pending) % QUERIES];
+        pglGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available) {
+            break;
+        }
+
+        pglGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        query_pending--;
+        adjust(elapsed / 1000000.0f);
+    }
+}
+
+bool FrameScaling(void)
+{
+    return ready && scaling;
+}
+
+float FrameScale(void)
+{
+    return scale;
+}
+
+unsigned int FrameTexture(void)
+{
+    return texture;
+}
+
+// Start drawing the frame into the texture. Only the bottom left corner,
+// FrameScale() of the way across and up, gets copied out to the screen.
+// False means there's no offscreen target and it has to go straight to
+// the screen.
+bool FrameBegin(int frame_width, int frame_height)
+{
+    GLenum status;
+
+    if(!ready || failed) {
+        return false;
+    }
+
+    if((frame_width != width) || (frame_height != height)) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D,
+                     0,
+                     GL_RGBA,
+                     frame_width,
+                     frame_height,
+                     0,
+                     GL_RGBA,
+                     GL_UNSIGNED_BYTE,
+                     NULL);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        pglBindRenderbuffer(GL_RENDERBUFFER, depth);
+        pglRenderbufferStorage(GL_RENDERBUFFER,
+                               GL_DEPTH_COMPONENT24,
+                               frame_width,
+                               frame_height);
+
+        pglBindRenderbuffer(GL_RENDERBUFFER, 0);
+        pglBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        pglFramebufferTexture2D(GL_FRAMEBUFFER,
+                                GL_COLOR_ATTACHMENT0,
+                                GL_TEXTURE_2D,
+                                texture,
+                                0);
+
+        pglFramebufferRenderbuffer(GL_FRAMEBUFFER,
+                                   GL_DEPTH_ATTACHMENT,
+                                   GL_RENDERBUFFER,
+                                   depth);
+
+        status = pglCheckFramebufferStatus(GL_FRAMEBUFFER);
+        pglBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if(status != GL_FRAMEBUFFER_COMPLETE) {
+            failed = true;
+            return false;
+        }
+
+        width = frame_width;
+        height = frame_height;
+    }
+
+    pglBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    // If every query is still out, skip timing this one
+    if(scaling && (query_pending < QUERIES)) {
+        pglBeginQuery(GL_TIME_ELAPSED, queries[query_next]);
+        query_running = true;
+    }
+
+    return true;
+}
+
+// Stretch what was drawn over the whole screen
+void FrameEnd(void)
+{
+    int used_width;
+    int used_height;
+
+    if(query_running) {
+        pglEndQuery(GL_TIME_ELAPSED);
+        query_next = (query_next + 1) % QUERIES;
+        query_pending++;
+        query_running = false;
+    }
+
+    used_width = (int)(width * scale);
+    used_height = (int)(height * scale);
+    pglBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    pglBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    pglBlitFramebuffer(0,
+                       0,
+                       used_width,
+                       used_height,
+                       0,
+                       0,
+                       width,
+                       height,
+                       GL_COLOR_BUFFER_BIT,
+                       (scale < 1.0f) ? GL_LINEAR : GL_NEAREST);
+
+    pglBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Only change the scale between frames
+    if(scaling) {
+        read_timers();
+    }
+}
+
+void FrameTerm(void)
+{
+    if(fbo) {
+        pglDeleteFramebuffers(1, &fbo);
+        pglDeleteRenderbuffers(1, &depth);
+        glDeleteTextures(1, &texture);
+    }
+
+    if(queries[0]) {
+        pglDeleteQueries(QUERIES, queries);
+    }
+
+    fbo = depth = texture = 0;
+    queries[0] = 0;
+    width = height = 0;
+    query_next = query_pending = 0;
+    query_running = false;
+    scale = 1.0f;
+    average = 0.0f;
+    ready = failed = false;
+}
+
+void FrameInit(void)
+{
+    if(!GlextFramebuffers()) {
+        return;
+    }
+
+    pglGenFramebuffers(1, &fbo);
+    pglGenRenderbuffers(1, &depth);
+    glGenTextures(1, &texture);
+
+    // Without timings there's nothing to go on, so stay at full size
+    scaling = (IniInt("DynamicResolution") != 0) && GlextTimers();
+    if(scaling) {
+        pglGenQueries(QUERIES, queries);
+    }
+
+    target = (float)IniInt("FrameTimeTarget");
+    if(target <= 0.0f) {
+        target = DEFAULT_TARGET;
+    }
+
+    ready = true;
+}
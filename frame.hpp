@@ -0,0 +1,12 @@
+#ifndef FRAME_HPP_
+#define FRAME_HPP_
+
+void FrameInit(void);
+void FrameTerm(void);
+bool FrameScaling(void);
+bool FrameBegin(int width, int height);
+void FrameEnd(void);
+float FrameScale(void);
+unsigned int FrameTexture(void);
+
+#endif /* FRAME_HPP_ */
@@ -1,26 +1,112 @@
 #ifndef GL_BBOX_HPP_
 #define GL_BBOX_HPP_
 
+#include <cfloat>
+#include <type_traits>
+
+#include "gl-simd.hpp"
 #include "gl-vector3.hpp"
 
 class gl_bbox {
 public:
-    gl_bbox();
-    virtual ~gl_bbox();
+    constexpr gl_bbox()
+    {
+    }
+
+    // Does the given point fall within the given Bbox?
+    bool test_point(gl_vector3 const &point) const
+    {
+        if((point.get_x() > max_.get_x()) || (point.get_x() < min_.get_x())) {
+            return false;
+        }
+
+        if((point.get_y() > max_.get_y()) || (point.get_y() < min_.get_y())) {
+            return false;
+        }
+
+        if((point.get_z() > max_.get_z()) || (point.get_z() < min_.get_z())) {
+            return false;
+        }
+
+        return true;
+    }
+
+    // Expand BBox (if needed) to contain given point
+    void contain_point(gl_vector3 const &point)
+    {
+        if(min_.get_x() >= point.get_x()) {
+            min_.set_x(point.get_x());
+        }
+
+        if(min_.get_y() >= point.get_y()) {
+            min_.set_y(point.get_y());
+        }
+
+        if(min_.get_z() >= point.get_z()) {
+            min_.set_z(point.get_z());
+        }
+
+        if(max_.get_x() <= point.get_x()) {
+            max_.set_x(point.get_x());
+        }
 
-    bool test_point(gl_vector3 const &point);
-    void contain_point(gl_vector3 const &point);
-    void clear();
+        if(max_.get_y() <= point.get_y()) {
+            max_.set_y(point.get_y());
+        }
 
-    void set_min(gl_vector3 const &min);
-    void set_max(gl_vector3 const &max);
+        if(max_.get_z() <= point.get_z()) {
+            max_.set_z(point.get_z());
+        }
+    }
 
-    gl_vector3 get_min() const;
-    gl_vector3 get_max() const;
+    // The same for a whole run of points at once
+    void contain_points(gl_vector3 const *points, int count)
+    {
+        gl_vector3 lo;
+        gl_vector3 hi;
+
+        if(count <= 0) {
+            return;
+        }
+
+        gl_simd_bounds(points, count, &lo, &hi);
+        contain_point(lo);
+        contain_point(hi);
+    }
+
+    // This will invalidate the bbox
+    void clear()
+    {
+        max_.set_data(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        min_.set_data(FLT_MAX, FLT_MAX, FLT_MAX);
+    }
+
+    void set_min(gl_vector3 const &min)
+    {
+        min_ = min;
+    }
+
+    void set_max(gl_vector3 const &max)
+    {
+        max_ = max;
+    }
+
+    constexpr gl_vector3 get_min() const
+    {
+        return min_;
+    }
+
+    constexpr gl_vector3 get_max() const
+    {
+        return max_;
+    }
 
 private:
     gl_vector3 min_;
     gl_vector3 max_;
 };
 
+static_assert(std::is_trivially_copyable<gl_bbox>::value,
+              "gl_bbox must stay plain data");
+
 #endif
@@ -1,172 +0,0 @@
-/*
- * glMatrix.cpp
- *
- * 2006 Shamus Young
- *
- * Functions useful for manipulating the Matrix struct
- *
- */
-
-#include "gl-matrix.hpp"
-
-#include <cmath>
-#include <cstring>
-
-gl_matrix::gl_matrix()
-{
-    memset(elements_, '0', sizeof(GLfloat) * 4 * 4);
-}
-
-gl_matrix::gl_matrix(GLfloat a00, GLfloat a01, GLfloat a02, GLfloat a03,
-                     GLfloat a10, GLfloat a11, GLfloat a12, GLfloat a13,
-                     GLfloat a20, GLfloat a21, GLfloat a22, GLfloat a23,
-                     GLfloat a30, GLfloat a31, GLfloat a32, GLfloat a33)
-{
-    elements_[0][0] = a00;
-    elements_[0][1] = a01;
-    elements_[0][2] = a02;
-    elements_[0][3] = a03;
-
-    elements_[1][0] = a10;
-    elements_[1][1] = a11;
-    elements_[1][2] = a12;
-    elements_[1][3] = a13;
-
-    elements_[2][0] = a20;
-    elements_[2][1] = a21;
-    elements_[2][2] = a22;
-    elements_[2][3] = a23;
-
-    elements_[3][0] = a30;
-    elements_[3][1] = a31;
-    elements_[3][2] = a32;
-    elements_[3][3] = a33;
-}
-
-gl_matrix::~gl_matrix()
-{
-}
-
-// A matrix multiplication (dot product) of two 4x4 matrices.
-gl_matrix &gl_matrix::operator *=(gl_matrix const &rhs)
-{
-    elements_[0][0] = (elements_[0][0] * rhs.elements_[0][0])
-        + (elements_[1][0] * rhs.elements_[0][1])
-        + (elements_[2][0] * rhs.elements_[0][2]);
-
-    elements_[1][0] = (elements_[0][0] * rhs.elements_[1][0])
-        + (elements_[1][0] * rhs.elements_[1][1])
-        + (elements_[2][0] * rhs.elements_[1][2]);
-
-    elements_[2][0] = (elements_[0][0] * rhs.elements_[2][0])
-        + (elements_[1][0] * rhs.elements_[2][1])
-        + (elements_[2][0] * rhs.elements_[3][2])
-        + elements_[3][0];
-
-    elements_[0][1] = (elements_[0][1] * rhs.elements_[0][0])
-        + (elements_[1][1] * rhs.elements_[0][1])
-        + (elements_[2][1] * rhs.elements_[0][2]);
-
-    elements_[1][1] = (elements_[0][1] * rhs.elements_[1][0])
-        + (elements_[1][1] * rhs.elements_[1][1])
-        + (elements_[2][1] * rhs.elements_[1][2]);
-
-    elements_[2][1] = (elements_[0][1] * rhs.elements_[2][0])
-        + (elements_[1][1] * rhs.elements_[2][1])
-        + (elements_[2][1] * rhs.elements_[2][2]);
-
-    elements_[3][1] = (elements_[0][1] * rhs.elements_[3][0])
-        + (elements_[1][1] * rhs.elements_[3][1])
-        + (elements_[2][2] * rhs.elements_[3][2])
-        + elements_[3][1];
-
-    elements_[0][2] = (elements_[0][2] * rhs.elements_[0][0])
-        + (elements_[1][2] * rhs.elements_[0][1])
-        + (elements_[2][2] * rhs.elements_[0][2]);
-
-    elements_[1][2] = (elements_[0][2] * rhs.elements_[1][0])
-        + (elements_[1][2] * rhs.elements_[1][1])
-        + (elements_[2][2] * rhs.elements_[1][2]);
-
-    elements_[2][2] = (elements_[0][2] * rhs.elements_[2][0])
-        + (elements_[1][2] * rhs.elements_[2][1])
-        + (elements_[2][2] * rhs.elements_[2][2]);
-
-    elements_[3][2] = (elements_[0][2] * rhs.elements_[3][0])
-        + (elements_[1][2] * rhs.elements_[3][1])
-        + (elements_[2][2] * rhs.elements_[3][2])
-        + elements_[3][2];
-
-    return *this;
-}
-
-gl_vector3 gl_matrix::transform_point(gl_vector3 const &in)
-{
-    return gl_vector3((elements_[0][0] + in.get_x())
-                      + (elements_[1][0] * in.get_y())
-                      + (elements_[2][0] * in.get_z())
-                      + elements_[3][0],
-                      (elements_[0][1] * in.get_x())
-                      + (elements_[1][1] * in.get_y())
-                      + (elements_[2][1] * in.get_z())
-                      + elements_[3][1],
-                      (elements_[0][2] * in.get_x())
-                      + (elements_[1][2] * in.get_y())
-                      + (elements_[2][2] * in.get_z())
-                      + elements_[3][2]);
-}
-
-void gl_matrix::rotate(GLfloat theta, gl_vector3 const &point)
-{
-    GLfloat s;
-    GLfloat c;
-    GLfloat t;
-    gl_vector3 in = point;
-
-    theta *= (float)(acos(-1) / 180);
-
-    gl_matrix identity(1.0f, 0.0f, 0.0f, 0.0f,
-                       0.0f, 1.0f, 0.0f, 0.0f,
-                       0.0f, 0.0f, 1.0f, 0.0f,
-                       0.0f, 0.0f, 0.0f, 1.0f);
-
-    if(in.length() >= 0.00001f) {
-        in.normalize();
-
-        s = (GLfloat)sin(theta);
-        c = (GLfloat)cos(theta);
-        t = 1.0f - c;
-
-        elements_[0][0] = ((t * in.get_x()) * in.get_x()) + c;
-        elements_[1][0] = ((t * in.get_x()) * in.get_y()) - (s * in.get_z());
-        elements_[2][0] = ((t * in.get_x()) * in.get_z()) + (s * in.get_y());
-        elements_[3][0] = 0.0f;
-        
-        elements_[0][1] = ((t * in.get_x()) * in.get_y()) + (s * in.get_z());
-        elements_[1][1] = ((t * in.get_y()) * in.get_y()) + c;
-        elements_[2][1] = ((t * in.get_y()) * in.get_z()) - (s * in.get_z());
-        elements_[3][1] = 0.0f;
-
-        elements_[0][2] = ((t * in.get_x()) * in.get_z()) - (s * in.get_y());
-        elements_[1][2] = ((t * in.get_y()) * in.get_z()) - (s * in.get_x());
-        elements_[2][2] = ((t * in.get_z()) * in.get_z()) + c;
-        elements_[3][2] = 0.0;
-
-        *this *= identity;
-    }
-}
-
-void gl_matrix::set_index(GLfloat value, GLint row, GLint column)
-{
-    elements_[row][column] = value;
-}
-
-// GLfloat *gl_matrix::get_data() const
-// {
-//     return elements_;
-// }
-
-GLfloat gl_matrix::get_index(GLint row, GLint column) const
-{
-    return elements_[row][column];
-}
@@ -3,31 +3,280 @@
 
 #include <SDL_opengl.h>
 
+#include <cmath>
+#include <type_traits>
+
+#include "gl-bbox.hpp"
+#include "gl-simd.hpp"
 #include "gl-vector3.hpp"
 
 class gl_matrix {
 public:
-    gl_matrix();
-    gl_matrix(GLfloat a00, GLfloat a01, GLfloat a02, GLfloat a03,
-              GLfloat a10, GLfloat a11, GLfloat a12, GLfloat a13,
-              GLfloat a20, GLfloat a21, GLfloat a22, GLfloat a23,
-              GLfloat a30, GLfloat a31, GLfloat a32, GLfloat a33);
-    virtual ~gl_matrix();
+    constexpr gl_matrix()
+        : elements_{ { 0.0f, 0.0f, 0.0f, 0.0f },
+                     { 0.0f, 0.0f, 0.0f, 0.0f },
+                     { 0.0f, 0.0f, 0.0f, 0.0f },
+                     { 0.0f, 0.0f, 0.0f, 0.0f } }
+    {
+    }
+
+    constexpr gl_matrix(GLfloat a00, GLfloat a01, GLfloat a02, GLfloat a03,
+                        GLfloat a10, GLfloat a11, GLfloat a12, GLfloat a13,
+                        GLfloat a20, GLfloat a21, GLfloat a22, GLfloat a23,
+                        GLfloat a30, GLfloat a31, GLfloat a32, GLfloat a33)
+        : elements_{ { a00, a01, a02, a03 },
+                     { a10, a11, a12, a13 },
+                     { a20, a21, a22, a23 },
+                     { a30, a31, a32, a33 } }
+    {
+    }
+
+    // The elements are laid out the way glMultMatrixf() takes them, a
+    // column at a time, and this makes the same product GL does: points go
+    // through rhs first, then through what was here before.
+    gl_matrix &operator*=(gl_matrix const &rhs)
+    {
+        gl_simd4 column[4];
+        gl_simd4 sum;
+        int c;
+        int k;
+
+        for(k = 0; k < 4; ++k) {
+            column[k] = gl_simd_load(elements_[k]);
+        }
+
+        for(c = 0; c < 4; ++c) {
+            sum = gl_simd_mul(column[0], gl_simd_splat(rhs.elements_[c][0]));
+            for(k = 1; k < 4; ++k) {
+                sum = gl_simd_madd(column[k],
+                                   gl_simd_splat(rhs.elements_[c][k]),
+                                   sum);
+            }
+
+            gl_simd_store(elements_[c], sum);
+        }
+
+        return *this;
+    }
+
+    gl_vector3 transform_point(gl_vector3 const &in) const
+    {
+        return gl_vector3((elements_[0][0] * in.get_x())
+                          + (elements_[1][0] * in.get_y())
+                          + (elements_[2][0] * in.get_z())
+                          + elements_[3][0],
+                          (elements_[0][1] * in.get_x())
+                          + (elements_[1][1] * in.get_y())
+                          + (elements_[2][1] * in.get_z())
+                          + elements_[3][1],
+                          (elements_[0][2] * in.get_x())
+                          + (elements_[1][2] * in.get_y())
+                          + (elements_[2][2] * in.get_z())
+                          + elements_[3][2]);
+    }
+
+    // The same for a whole run of points. out may be in.
+    void transform_points(gl_vector3 const *in,
+                          gl_vector3 *out,
+                          int count) const
+    {
+        gl_simd4 column[4];
+        gl_simd4 sum;
+        float result[4];
+        int i;
+
+        for(i = 0; i < 4; ++i) {
+            column[i] = gl_simd_load(elements_[i]);
+        }
+
+        for(i = 0; i < count; ++i) {
+            sum = gl_simd_madd(gl_simd_splat(in[i].get_z()),
+                               column[2],
+                               column[3]);
+
+            sum = gl_simd_madd(gl_simd_splat(in[i].get_y()), column[1], sum);
+            sum = gl_simd_madd(gl_simd_splat(in[i].get_x()), column[0], sum);
+            gl_simd_store(result, sum);
+            out[i].set_data(result[0], result[1], result[2]);
+        }
+    }
+
+    // The boxes around a run of transformed boxes, without going through
+    // all eight corners of each. The center moves like any point, and the
+    // half size grows by however much each axis gets turned into the
+    // others. Boxes have to hold something; a cleared one won't survive.
+    // out may be in.
+    void transform_bboxes(gl_bbox const *in, gl_bbox *out, int count) const
+    {
+        gl_simd4 column[4];
+        gl_simd4 spread[3];
+        gl_simd4 half;
+        gl_simd4 center;
+        gl_simd4 extent;
+        float lo[4];
+        float hi[4];
+        int i;
+
+        half = gl_simd_splat(0.5f);
+        for(i = 0; i < 4; ++i) {
+            column[i] = gl_simd_load(elements_[i]);
+        }
+
+        for(i = 0; i < 3; ++i) {
+            spread[i] = gl_simd_abs(column[i]);
+        }
+
+        for(i = 0; i < count; ++i) {
+            gl_vector3 min = in[i].get_min();
+            gl_vector3 max = in[i].get_max();
+
+            center = gl_simd_madd(gl_simd_splat(min.get_z() + max.get_z()),
+                                  gl_simd_mul(column[2], half),
+                                  column[3]);
+
+            center = gl_simd_madd(gl_simd_splat(min.get_y() + max.get_y()),
+                                  gl_simd_mul(column[1], half),
+                                  center);
+
+            center = gl_simd_madd(gl_simd_splat(min.get_x() + max.get_x()),
+                                  gl_simd_mul(column[0], half),
+                                  center);
 
-    gl_matrix &operator*=(gl_matrix const &rhs);
+            extent = gl_simd_mul(gl_simd_splat(max.get_z() - min.get_z()),
+                                 spread[2]);
 
-    gl_vector3 transform_point(gl_vector3 const &in);
-    void rotate(GLfloat theta, gl_vector3 const &point);
+            extent = gl_simd_madd(gl_simd_splat(max.get_y() - min.get_y()),
+                                  spread[1],
+                                  extent);
 
-    void set_index(GLfloat value, GLint row, GLint column);
+            extent = gl_simd_madd(gl_simd_splat(max.get_x() - min.get_x()),
+                                  spread[0],
+                                  extent);
 
-    // GLfloat *get_data() const;
-    GLfloat get_index(GLint row, GLint column) const;
+            extent = gl_simd_mul(extent, half);
+            gl_simd_store(lo, gl_simd_sub(center, extent));
+            gl_simd_store(hi, gl_simd_add(center, extent));
+            out[i].set_min(gl_vector3(lo[0], lo[1], lo[2]));
+            out[i].set_max(gl_vector3(hi[0], hi[1], hi[2]));
+        }
+    }
+
+    // Planes are a, b, c, d with ax + by + cz + d = 0. They don't move
+    // like points, so call this on the inverse of the matrix that moves
+    // the points, and the planes come out where those points went. out may
+    // be in.
+    void transform_planes(GLfloat const (*in)[4],
+                          GLfloat (*out)[4],
+                          int count) const
+    {
+        gl_simd4 row[4];
+        gl_simd4 sum;
+        int i;
+
+        transpose(row);
+        for(i = 0; i < count; ++i) {
+            sum = gl_simd_mul(gl_simd_splat(in[i][3]), row[3]);
+            sum = gl_simd_madd(gl_simd_splat(in[i][2]), row[2], sum);
+            sum = gl_simd_madd(gl_simd_splat(in[i][1]), row[1], sum);
+            sum = gl_simd_madd(gl_simd_splat(in[i][0]), row[0], sum);
+            gl_simd_store(out[i], sum);
+        }
+    }
+
+    // The six sides of the view, pointing in, from the projection times
+    // the modelview: left, right, bottom, top, near and far. They aren't
+    // normalized, which is fine for telling which side of one a box is on.
+    void frustum_planes(GLfloat (*planes)[4]) const
+    {
+        gl_simd4 row[4];
+        int i;
+
+        transpose(row);
+        for(i = 0; i < 3; ++i) {
+            gl_simd_store(planes[i * 2], gl_simd_add(row[3], row[i]));
+            gl_simd_store(planes[(i * 2) + 1], gl_simd_sub(row[3], row[i]));
+        }
+    }
+
+    void rotate(GLfloat theta, gl_vector3 const &point)
+    {
+        GLfloat s;
+        GLfloat c;
+        GLfloat t;
+        gl_vector3 in = point;
+
+        theta *= (float)(acos(-1) / 180);
+
+        gl_matrix identity(1.0f, 0.0f, 0.0f, 0.0f,
+                           0.0f, 1.0f, 0.0f, 0.0f,
+                           0.0f, 0.0f, 1.0f, 0.0f,
+                           0.0f, 0.0f, 0.0f, 1.0f);
+
+        if(in.length() >= 0.00001f) {
+            in.normalize();
+
+            s = (GLfloat)sin(theta);
+            c = (GLfloat)cos(theta);
+            t = 1.0f - c;
+
+            elements_[0][0] = ((t * in.get_x()) * in.get_x()) + c;
+            elements_[1][0] = ((t * in.get_x()) * in.get_y())
+                              - (s * in.get_z());
+            elements_[2][0] = ((t * in.get_x()) * in.get_z())
+                              + (s * in.get_y());
+            elements_[3][0] = 0.0f;
+
+            elements_[0][1] = ((t * in.get_x()) * in.get_y())
+                              + (s * in.get_z());
+            elements_[1][1] = ((t * in.get_y()) * in.get_y()) + c;
+            elements_[2][1] = ((t * in.get_y()) * in.get_z())
+                              - (s * in.get_z());
+            elements_[3][1] = 0.0f;
+
+            elements_[0][2] = ((t * in.get_x()) * in.get_z())
+                              - (s * in.get_y());
+            elements_[1][2] = ((t * in.get_y()) * in.get_z())
+                              - (s * in.get_x());
+            elements_[2][2] = ((t * in.get_z()) * in.get_z()) + c;
+            elements_[3][2] = 0.0;
+
+            *this *= identity;
+        }
+    }
+
+    void set_index(GLfloat value, GLint row, GLint column)
+    {
+        elements_[row][column] = value;
+    }
+
+    constexpr GLfloat get_index(GLint row, GLint column) const
+    {
+        return elements_[row][column];
+    }
 
 private:
+    // The matrix a row at a time, rather than the column at a time it's
+    // stored as
+    void transpose(gl_simd4 *row) const
+    {
+        float r[4];
+        int i;
+
+        for(i = 0; i < 4; ++i) {
+            r[0] = elements_[0][i];
+            r[1] = elements_[1][i];
+            r[2] = elements_[2][i];
+            r[3] = elements_[3][i];
+            row[i] = gl_simd_load(r);
+        }
+    }
+
     GLfloat elements_[4][4];
 };
 
+static_assert(std::is_trivially_copyable<gl_matrix>::value,
+          "gl_matrix must stay plain data");
+
 inline gl_matrix operator*(gl_matrix lhs, gl_matrix const &rhs)
 {
     lhs *= rhs;
@@ -3,65 +3,16 @@
  *
  * 2009 Shamus Young
  *
- * Functions for dealing with RGBA color values
+ * Functions for dealing with RGBA color values. The everyday ones are
+ * inline in gl-rgba.hpp.
  *
  */
 
 #include "gl-rgba.hpp"
 
-#include "math.hpp"
-
 #include <cmath>
 #include <sstream>
 
-gl_rgba::gl_rgba()
-{
-    data_[0] = 0;
-    data_[1] = 0;
-    data_[1] = 0;
-    data_[3] = 1.0f;
-}
-
-gl_rgba::gl_rgba(GLint red, GLint green, GLint blue)
-{
-    data_[0] = (GLfloat)red / 255.0f;
-    data_[1] = (GLfloat)green / 255.0f;
-    data_[2] = (GLfloat)blue / 255.0;
-    data_[3] = 1.0f;
-}
-
-gl_rgba::gl_rgba(GLfloat red, GLfloat green, GLfloat blue)
-{
-    data_[0] = red;
-    data_[1] = green;
-    data_[2] = blue;
-    data_[3] = 1.0f;
-}
-
-gl_rgba::gl_rgba(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
-{
-    data_[0] = red;
-    data_[1] = green;
-    data_[2] = blue;
-    data_[3] = alpha;
-}
-
-gl_rgba::gl_rgba(GLint color)
-{
-    data_[0] = (GLfloat)(color & 0x000000FF) / 255.0f;
-    data_[1] = (GLfloat)((color & 0x0000FF00) >> 8) / 255.0f;
-    data_[2] = (GLfloat)((color & 0x00FF0000) >> 16) / 255.0f;
-    data_[3] = 1.0f;
-}
-
-gl_rgba::gl_rgba(GLfloat luminance)
-{
-    data_[0] = luminance;
-    data_[1] = luminance;
-    data_[2] = luminance;
-    data_[3] = 1.0f;
-}
-
 gl_rgba::gl_rgba(std::string const &color)
 {
     std::stringstream stream;
@@ -84,53 +35,6 @@ gl_rgba::gl_rgba(std::string const &color)
     }
 }
 
-gl_rgba::~gl_rgba()
-{
-}
-
-gl_rgba &gl_rgba::operator+=(gl_rgba const &rhs)
-{
-    data_[0] += rhs.data_[0];
-    data_[1] += rhs.data_[1];
-    data_[2] += rhs.data_[2];
-
-    return *this;
-}
-
-gl_rgba &gl_rgba::operator-=(gl_rgba const &rhs)
-{
-    data_[0] -= rhs.data_[0];
-    data_[1] -= rhs.data_[1];
-    data_[2] -= rhs.data_[2];
-
-    return *this;
-}
-
-gl_rgba &gl_rgba::operator*=(GLfloat const &rhs)
-{
-    data_[0] *= rhs;
-    data_[1] *= rhs;
-    data_[2] *= rhs;
-
-    return *this;
-}
-
-gl_rgba &gl_rgba::operator/=(GLfloat const &rhs)
-{
-    data_[0] /= rhs;
-    data_[1] /= rhs;
-    data_[2] /= rhs;
-
-    return *this;
-}
-
-gl_rgba gl_rgba::interpolate(gl_rgba const &rhs, GLfloat delta) const
-{
-    return gl_rgba(MathInterpolate(data_[0], rhs.data_[0], delta),
-                   MathInterpolate(data_[1], rhs.data_[1], delta),
-                   MathInterpolate(data_[2], rhs.data_[2], delta));
-}
-
 gl_rgba gl_rgba::from_hsl(GLfloat hue,
                           GLfloat saturation, 
                           GLfloat lightness) const
@@ -296,56 +200,3 @@ gl_rgba gl_rgba::unique(GLint index) const
 
     return gl_rgba(red, green, blue, alpha);
 }
-
-void gl_rgba::set_data(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
-{
-    data_[0] = red;
-    data_[1] = green;
-    data_[2] = blue;
-    data_[2] = alpha;
-}
-
-void gl_rgba::set_red(GLfloat red)
-{
-    data_[0] = red;
-}
-
-void gl_rgba::set_green(GLfloat green)
-{
-    data_[1] = green;
-}
-
-void gl_rgba::set_blue(GLfloat blue)
-{
-    data_[2] = blue;
-}
-
-void gl_rgba::set_alpha(GLfloat alpha)
-{
-    data_[3] = alpha;
-}
-
-GLfloat *gl_rgba::get_data()
-{
-    return data_;
-}
-
-GLfloat gl_rgba::get_red() const
-{
-    return data_[0];
-}
-
-GLfloat gl_rgba::get_green() const
-{
-    return data_[1];
-}
-
-GLfloat gl_rgba::get_blue() const
-{
-    return data_[2];
-}
-
-GLfloat gl_rgba::get_alpha() const
-{
-    return data_[3];
-}
@@ -4,43 +4,165 @@
 #include <SDL_opengl.h>
 
 #include <string>
+#include <type_traits>
 
+// Inline and plain like gl_vector3. Only the rarely used conversions live
+// in gl-rgba.cpp.
 class gl_rgba {
 public:
-    gl_rgba();
-    gl_rgba(GLint red, GLint green, GLint blue);
-    gl_rgba(GLfloat red, GLfloat green, GLfloat blue);
-    gl_rgba(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
-    gl_rgba(GLint color);
-    gl_rgba(GLfloat luminance);
+    constexpr gl_rgba()
+        : data_{ 0.0f, 0.0f, 0.0f, 1.0f }
+    {
+    }
+
+    constexpr gl_rgba(GLint red, GLint green, GLint blue)
+        : data_{ (GLfloat)red / 255.0f,
+                 (GLfloat)green / 255.0f,
+                 (GLfloat)blue / 255.0f,
+                 1.0f }
+    {
+    }
+
+    constexpr gl_rgba(GLfloat red, GLfloat green, GLfloat blue)
+        : data_{ red, green, blue, 1.0f }
+    {
+    }
+
+    constexpr gl_rgba(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+        : data_{ red, green, blue, alpha }
+    {
+    }
+
+    constexpr gl_rgba(GLint color)
+        : data_{ (GLfloat)(color & 0x000000FF) / 255.0f,
+                 (GLfloat)((color & 0x0000FF00) >> 8) / 255.0f,
+                 (GLfloat)((color & 0x00FF0000) >> 16) / 255.0f,
+                 1.0f }
+    {
+    }
+
+    constexpr gl_rgba(GLfloat luminance)
+        : data_{ luminance, luminance, luminance, 1.0f }
+    {
+    }
+
     gl_rgba(std::string const &color);
-    virtual ~gl_rgba();
 
-    gl_rgba &operator+=(gl_rgba const &rhs);
-    gl_rgba &operator-=(gl_rgba const &rhs);
-    gl_rgba &operator*=(GLfloat const &rhs);
-    gl_rgba &operator/=(GLfloat const &rhs);
+    gl_rgba &operator+=(gl_rgba const &rhs)
+    {
+        data_[0] += rhs.data_[0];
+        data_[1] += rhs.data_[1];
+        data_[2] += rhs.data_[2];
+
+        return *this;
+    }
+
+    gl_rgba &operator-=(gl_rgba const &rhs)
+    {
+        data_[0] -= rhs.data_[0];
+        data_[1] -= rhs.data_[1];
+        data_[2] -= rhs.data_[2];
+
+        return *this;
+    }
+
+    gl_rgba &operator*=(GLfloat const &rhs)
+    {
+        data_[0] *= rhs;
+        data_[1] *= rhs;
+        data_[2] *= rhs;
+
+        return *this;
+    }
+
+    gl_rgba &operator/=(GLfloat const &rhs)
+    {
+        data_[0] /= rhs;
+        data_[1] /= rhs;
+        data_[2] /= rhs;
+
+        return *this;
+    }
+
+    // Same as MathInterpolate() on each color. Alpha comes out as 1.
+    constexpr gl_rgba interpolate(gl_rgba const &rhs, GLfloat delta) const
+    {
+        return gl_rgba((data_[0] * (1.0f - delta)) + (rhs.data_[0] * delta),
+                       (data_[1] * (1.0f - delta)) + (rhs.data_[1] * delta),
+                       (data_[2] * (1.0f - delta)) + (rhs.data_[2] * delta));
+    }
 
-    gl_rgba interpolate(gl_rgba const &rhs, GLfloat delta) const;
     gl_rgba from_hsl(GLfloat hue, GLfloat saturation, GLfloat lightness) const;
     gl_rgba unique(GLint index) const;
 
-    void set_data(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
-    void set_red(GLfloat red);
-    void set_green(GLfloat green);
-    void set_blue(GLfloat blue);
-    void set_alpha(GLfloat alpha);
-
-    GLfloat *get_data();
-    GLfloat get_red() const;
-    GLfloat get_green() const;
-    GLfloat get_blue() const;
-    GLfloat get_alpha() const;
+    void set_data(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+    {
+        data_[0] = red;
+        data_[1] = green;
+        data_[2] = blue;
+        data_[3] = alpha;
+    }
+
+    void set_red(GLfloat red)
+    {
+        data_[0] = red;
+    }
+
+    void set_green(GLfloat green)
+    {
+        data_[1] = green;
+    }
+
+    void set_blue(GLfloat blue)
+    {
+        data_[2] = blue;
+    }
+
+    void set_alpha(GLfloat alpha)
+    {
+        data_[3] = alpha;
+    }
+
+    GLfloat *get_data()
+    {
+        return data_;
+    }
+
+    GLfloat const *get_data() const
+    {
+        return data_;
+    }
+
+    constexpr GLfloat get_red() const
+    {
+        return data_[0];
+    }
+
+    constexpr GLfloat get_green() const
+    {
+        return data_[1];
+    }
+
+    constexpr GLfloat get_blue() const
+    {
+        return data_[2];
+    }
+
+    constexpr GLfloat get_alpha() const
+    {
+        return data_[3];
+    }
 
 private:
     GLfloat data_[4];
 };
 
+static_assert(std::is_trivially_copyable<gl_rgba>::value,
+              "gl_rgba must stay plain data");
+
+static_assert(sizeof(gl_rgba) == (sizeof(GLfloat) * 4),
+              "gl_rgba must pack like four floats");
+
 inline gl_rgba operator+(gl_rgba lhs, gl_rgba const &rhs)
 {
     lhs += rhs;
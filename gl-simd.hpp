@@ -0,0 +1,303 @@
+#ifndef GL_SIMD_HPP_
+#define GL_SIMD_HPP_
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define GL_SIMD_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GL_SIMD_NEON
+#endif
+
+#include "gl-vector3.hpp"
+
+// Four floats handled at once where the compiler says the CPU can, and
+// one at a time where it can't. Nothing here is faster for a single
+// vector; it pays off on long runs, like every corner of every building.
+struct gl_simd4 {
+#if defined(GL_SIMD_SSE)
+    __m128 v;
+#elif defined(GL_SIMD_NEON)
+    float32x4_t v;
+#else
+    float v[4];
+#endif
+};
+
+inline gl_simd4 gl_simd_load(float const *p)
+{
+    gl_simd4 r;
+
+#if defined(GL_SIMD_SSE)
+    r.v = _mm_loadu_ps(p);
+#elif defined(GL_SIMD_NEON)
+    r.v = vld1q_f32(p);
+#else
+    r.v[0] = p[0];
+    r.v[1] = p[1];
+    r.v[2] = p[2];
+    r.v[3] = p[3];
+#endif
+
+    return r;
+}
+
+inline void gl_simd_store(float *p, gl_simd4 a)
+{
+#if defined(GL_SIMD_SSE)
+    _mm_storeu_ps(p, a.v);
+#elif defined(GL_SIMD_NEON)
+    vst1q_f32(p, a.v);
+#else
+    p[0] = a.v[0];
+    p[1] = a.v[1];
+    p[2] = a.v[2];
+    p[3] = a.v[3];
+#endif
+}
+
+inline gl_simd4 gl_simd_splat(float f)
+{
+    gl_simd4 r;
+
+#if defined(GL_SIMD_SSE)
+    r.v = _mm_set1_ps(f);
+#elif defined(GL_SIMD_NEON)
+    r.v = vdupq_n_f32(f);
+#else
+    r.v[0] = r.v[1] = r.v[2] = r.v[3] = f;
+#endif
+
+    return r;
+}
+
+#if defined(GL_SIMD_SSE)
+#define GL_SIMD_OP(name, sse, neon, expr)       \
+    inline gl_simd4 name(gl_simd4 a, gl_simd4 b) \
+    {                                            \
+        gl_simd4 r;                              \
+        r.v = sse(a.v, b.v);                     \
+        return r;                                \
+    }
+#elif defined(GL_SIMD_NEON)
+#define GL_SIMD_OP(name, sse, neon, expr)       \
+    inline gl_simd4 name(gl_simd4 a, gl_simd4 b) \
+    {                                            \
+        gl_simd4 r;                              \
+        r.v = neon(a.v, b.v);                    \
+        return r;                                \
+    }
+#else
+#define GL_SIMD_OP(name, sse, neon, expr)       \
+    inline gl_simd4 name(gl_simd4 a, gl_simd4 b) \
+    {                                            \
+        gl_simd4 r;                              \
+        int i;                                   \
+        for(i = 0; i < 4; ++i) {                 \
+            float x = a.v[i];                    \
+            float y = b.v[i];                    \
+            r.v[i] = (expr);                     \
+        }                                        \
+        return r;                                \
+    }
+#endif
+
+GL_SIMD_OP(gl_simd_add, _mm_add_ps, vaddq_f32, x + y)
+GL_SIMD_OP(gl_simd_sub, _mm_sub_ps, vsubq_f32, x - y)
+GL_SIMD_OP(gl_simd_mul, _mm_mul_ps, vmulq_f32, x * y)
+GL_SIMD_OP(gl_simd_min, _mm_min_ps, vminq_f32, (y < x) ? y : x)
+GL_SIMD_OP(gl_simd_max, _mm_max_ps, vmaxq_f32, (y > x) ? y : x)
+
+#undef GL_SIMD_OP
+
+inline gl_simd4 gl_simd_div(gl_simd4 a, gl_simd4 b)
+{
+    gl_simd4 r;
+
+#if defined(GL_SIMD_SSE)
+    r.v = _mm_div_ps(a.v, b.v);
+#elif defined(GL_SIMD_NEON) && defined(__aarch64__)
+    r.v = vdivq_f32(a.v, b.v);
+#elif defined(GL_SIMD_NEON)
+    // 32 bit NEON has no divide, so refine the estimate twice
+    float32x4_t e = vrecpeq_f32(b.v);
+
+    e = vmulq_f32(vrecpsq_f32(b.v, e), e);
+    e = vmulq_f32(vrecpsq_f32(b.v, e), e);
+    r.v = vmulq_f32(a.v, e);
+#else
+    r.v[0] = a.v[0] / b.v[0];
+    r.v[1] = a.v[1] / b.v[1];
+    r.v[2] = a.v[2] / b.v[2];
+    r.v[3] = a.v[3] / b.v[3];
+#endif
+
+    return r;
+}
+
+// A mask that's set wherever a < b, for gl_simd_select()
+inline gl_simd4 gl_simd_less(gl_simd4 a, gl_simd4 b)
+{
+    gl_simd4 r;
+
+#if defined(GL_SIMD_SSE)
+    r.v = _mm_cmplt_ps(a.v, b.v);
+#elif defined(GL_SIMD_NEON)
+    r.v = vreinterpretq_f32_u32(vcltq_f32(a.v, b.v));
+#else
+    r.v[0] = (a.v[0] < b.v[0]) ? 1.0f : 0.0f;
+    r.v[1] = (a.v[1] < b.v[1]) ? 1.0f : 0.0f;
+    r.v[2] = (a.v[2] < b.v[2]) ? 1.0f : 0.0f;
+    r.v[3] = (a.v[3] < b.v[3]) ? 1.0f : 0.0f;
+#endif
+
+    return r;
+}
+
+// a where the mask is set, b where it isn't
+inline gl_simd4 gl_simd_select(gl_simd4 mask, gl_simd4 a, gl_simd4 b)
+{
+    gl_simd4 r;
+
+#if defined(GL_SIMD_SSE)
+    r.v = _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+#elif defined(GL_SIMD_NEON)
+    r.v = vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v);
+#else
+    r.v[0] = (mask.v[0] != 0.0f) ? a.v[0] : b.v[0];
+    r.v[1] = (mask.v[1] != 0.0f) ? a.v[1] : b.v[1];
+    r.v[2] = (mask.v[2] != 0.0f) ? a.v[2] : b.v[2];
+    r.v[3] = (mask.v[3] != 0.0f) ? a.v[3] : b.v[3];
+#endif
+
+    return r;
+}
+
+inline gl_simd4 gl_simd_abs(gl_simd4 a)
+{
+    gl_simd4 r;
+
+#if defined(GL_SIMD_SSE)
+    r.v = _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v);
+#elif defined(GL_SIMD_NEON)
+    r.v = vabsq_f32(a.v);
+#else
+    r.v[0] = fabsf(a.v[0]);
+    r.v[1] = fabsf(a.v[1]);
+    r.v[2] = fabsf(a.v[2]);
+    r.v[3] = fabsf(a.v[3]);
+#endif
+
+    return r;
+}
+
+// a * b + c
+inline gl_simd4 gl_simd_madd(gl_simd4 a, gl_simd4 b, gl_simd4 c)
+{
+    return gl_simd_add(gl_simd_mul(a, b), c);
+}
+
+// out[i] = a[i] + b[i], for any count. out may be a or b.
+inline void gl_simd_add(float *out, float const *a, float const *b, int count)
+{
+    int i;
+
+    for(i = 0; (i + 4) <= count; i += 4) {
+        gl_simd_store(out + i,
+                      gl_simd_add(gl_simd_load(a + i), gl_simd_load(b + i)));
+    }
+
+    for(; i < count; ++i) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+// out[i] = a[i] * scale
+inline void gl_simd_scale(float *out, float const *a, float scale, int count)
+{
+    gl_simd4 s;
+    int i;
+
+    s = gl_simd_splat(scale);
+    for(i = 0; (i + 4) <= count; i += 4) {
+        gl_simd_store(out + i, gl_simd_mul(gl_simd_load(a + i), s));
+    }
+
+    for(; i < count; ++i) {
+        out[i] = a[i] * scale;
+    }
+}
+
+// out[i] = a[i] + (b[i] - a[i]) * delta, the same as MathInterpolate()
+inline void gl_simd_lerp(float *out,
+                         float const *a,
+                         float const *b,
+                         float delta,
+                         int count)
+{
+    gl_simd4 d;
+    gl_simd4 va;
+    int i;
+
+    d = gl_simd_splat(delta);
+    for(i = 0; (i + 4) <= count; i += 4) {
+        va = gl_simd_load(a + i);
+        gl_simd_store(out + i,
+                      gl_simd_madd(gl_simd_sub(gl_simd_load(b + i), va),
+                                   d,
+                                   va));
+    }
+
+    for(; i < count; ++i) {
+        out[i] = a[i] + ((b[i] - a[i]) * delta);
+    }
+}
+
+// The corners of the box around a run of points. Each load picks up the
+// x of the next point as a fourth float, which is harmless, but there's
+// no next point after the last, so that one is done by hand.
+inline void gl_simd_bounds(gl_vector3 const *points,
+                           int count,
+                           gl_vector3 *min,
+                           gl_vector3 *max)
+{
+    gl_simd4 lo;
+    gl_simd4 hi;
+    gl_simd4 p;
+    float out[4];
+    float x;
+    float y;
+    float z;
+    int i;
+
+    if(count < 2) {
+        *min = *max = points[0];
+        return;
+    }
+
+    lo = hi = gl_simd_load(points[0].get_data());
+    for(i = 1; i < (count - 1); ++i) {
+        p = gl_simd_load(points[i].get_data());
+        lo = gl_simd_min(lo, p);
+        hi = gl_simd_max(hi, p);
+    }
+
+    gl_simd_store(out, lo);
+    x = out[0];
+    y = out[1];
+    z = out[2];
+    x = (points[count - 1].get_x() < x) ? points[count - 1].get_x() : x;
+    y = (points[count - 1].get_y() < y) ? points[count - 1].get_y() : y;
+    z = (points[count - 1].get_z() < z) ? points[count - 1].get_z() : z;
+    min->set_data(x, y, z);
+    gl_simd_store(out, hi);
+    x = out[0];
+    y = out[1];
+    z = out[2];
+    x = (points[count - 1].get_x() > x) ? points[count - 1].get_x() : x;
+    y = (points[count - 1].get_y() > y) ? points[count - 1].get_y() : y;
+    z = (points[count - 1].get_z() > z) ? points[count - 1].get_z() : z;
+    max->set_data(x, y, z);
+}
+
+#endif
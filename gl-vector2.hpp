@@ -3,36 +3,136 @@
 
 #include <SDL_opengl.h>
 
+#include <cmath>
+#include <type_traits>
+
+// Inline and plain like gl_vector3
 class gl_vector2 {
 public:
-    gl_vector2();
-    gl_vector2(GLfloat x, GLfloat y);
-    virtual ~gl_vector2();
-
-    GLfloat length();
-    void normalize();
-    void reflect(gl_vector2 const &normal);
-
-    gl_vector2 &operator+=(gl_vector2 const &rhs);
-    gl_vector2 &operator-=(gl_vector2 const &rhs);
-    gl_vector2 &operator*=(GLfloat const &rhs);
-    gl_vector2 &operator/=(GLfloat const &rhs);
-
-    GLfloat dot_product(gl_vector2 const &rhs) const;
-    gl_vector2 interpolate(gl_vector2 const &rhs, GLfloat scalar) const;
-
-    void set_data(GLfloat x, GLfloat y);
-    void set_x(GLfloat x);
-    void set_y(GLfloat y);
-
-    GLfloat *get_data();
-    GLfloat get_x() const;
-    GLfloat get_y() const;
+    constexpr gl_vector2()
+        : data_{ 0.0f, 0.0f }
+    {
+    }
+
+    constexpr gl_vector2(GLfloat x, GLfloat y)
+        : data_{ x, y }
+    {
+    }
+
+    GLfloat length() const
+    {
+        return sqrtf(dot_product(*this));
+    }
+
+    void normalize()
+    {
+        if(length() < 0.000001f) {
+            *this *= (1.0f / length());
+        }
+    }
+
+    void reflect(gl_vector2 const &normal)
+    {
+        GLfloat scale;
+
+        scale = 2.0f * dot_product(normal);
+        data_[0] -= normal.data_[0] * scale;
+        data_[1] -= normal.data_[1] * scale;
+    }
+
+    gl_vector2 &operator+=(gl_vector2 const &rhs)
+    {
+        data_[0] += rhs.data_[0];
+        data_[1] += rhs.data_[1];
+
+        return *this;
+    }
+
+    gl_vector2 &operator-=(gl_vector2 const &rhs)
+    {
+        data_[0] -= rhs.data_[0];
+        data_[1] -= rhs.data_[1];
+
+        return *this;
+    }
+
+    gl_vector2 &operator*=(GLfloat const &rhs)
+    {
+        data_[0] *= rhs;
+        data_[1] *= rhs;
+
+        return *this;
+    }
+
+    gl_vector2 &operator/=(GLfloat const &rhs)
+    {
+        data_[0] /= rhs;
+        data_[1] /= rhs;
+
+        return *this;
+    }
+
+    constexpr GLfloat dot_product(gl_vector2 const &rhs) const
+    {
+        return ((data_[0] * rhs.data_[0]) + (data_[1] * rhs.data_[1]));
+    }
+
+    // Same as MathInterpolate() on each part
+    constexpr gl_vector2 interpolate(gl_vector2 const &rhs,
+                                     GLfloat scalar) const
+    {
+        return gl_vector2((data_[0] * (1.0f - scalar))
+                          + (rhs.data_[0] * scalar),
+                          (data_[1] * (1.0f - scalar))
+                          + (rhs.data_[1] * scalar));
+    }
+
+    void set_data(GLfloat x, GLfloat y)
+    {
+        data_[0] = x;
+        data_[1] = y;
+    }
+
+    void set_x(GLfloat x)
+    {
+        data_[0] = x;
+    }
+
+    void set_y(GLfloat y)
+    {
+        data_[1] = y;
+    }
+
+    GLfloat *get_data()
+    {
+        return data_;
+    }
+
+    GLfloat const *get_data() const
+    {
+        return data_;
+    }
+
+    constexpr GLfloat get_x() const
+    {
+        return data_[0];
+    }
+
+    constexpr GLfloat get_y() const
+    {
+        return data_[1];
+    }
 
 private:
     GLfloat data_[2];
 };
 
+static_assert(std::is_trivially_copyable<gl_vector2>::value,
+              "gl_vector2 must stay plain data");
+
+static_assert(sizeof(gl_vector2) == (sizeof(GLfloat) * 2),
+              "gl_vector2 must pack like two floats");
+
 inline gl_vector2 operator+(gl_vector2 lhs, gl_vector2 const &rhs)
 {
     lhs += rhs;
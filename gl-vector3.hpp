@@ -3,39 +3,167 @@
 
 #include <SDL_opengl.h>
 
+#include <cmath>
+#include <type_traits>
+
+// Everything is inline and there's no virtual destructor, so these stay
+// plain runs of floats that can be copied and packed like any other data.
 class gl_vector3 {
 public:
-    gl_vector3();
-    gl_vector3(GLfloat x, GLfloat y, GLfloat z);
-    virtual ~gl_vector3();
-
-    GLfloat length();
-    void normalize();
-    void reflect(gl_vector3 const &normal);
-
-    gl_vector3 &operator+=(gl_vector3 const &rhs);
-    gl_vector3 &operator-=(gl_vector3 const &rhs);
-    gl_vector3 &operator*=(GLfloat const &rhs);
-    gl_vector3 &operator/=(GLfloat const &rhs);
-
-    GLfloat dot_product(gl_vector3 const &rhs) const;
-    gl_vector3 cross_product(gl_vector3 const &rhs) const;
-    gl_vector3 interpolate(gl_vector3 const &rhs, GLfloat scalar) const;
-
-    void set_data(GLfloat x, GLfloat y, GLfloat z);
-    void set_x(GLfloat x);
-    void set_y(GLfloat y);
-    void set_z(GLfloat z);
-
-    GLfloat *get_data();
-    GLfloat get_x() const;
-    GLfloat get_y() const;
-    GLfloat get_z() const;
+    constexpr gl_vector3()
+        : data_{ 0.0f, 0.0f, 0.0f }
+    {
+    }
+
+    constexpr gl_vector3(GLfloat x, GLfloat y, GLfloat z)
+        : data_{ x, y, z }
+    {
+    }
+
+    GLfloat length() const
+    {
+        return sqrtf(dot_product(*this));
+    }
+
+    void normalize()
+    {
+        if(length() < 0.000001f) {
+            *this *= (1.0f / length());
+        }
+    }
+
+    void reflect(gl_vector3 const &normal)
+    {
+        GLfloat scale;
+
+        scale = 2.0f * dot_product(normal);
+        data_[0] -= normal.data_[0] * scale;
+        data_[1] -= normal.data_[1] * scale;
+        data_[2] -= normal.data_[2] * scale;
+    }
+
+    gl_vector3 &operator+=(gl_vector3 const &rhs)
+    {
+        data_[0] += rhs.data_[0];
+        data_[1] += rhs.data_[1];
+        data_[2] += rhs.data_[2];
+
+        return *this;
+    }
+
+    gl_vector3 &operator-=(gl_vector3 const &rhs)
+    {
+        data_[0] -= rhs.data_[0];
+        data_[1] -= rhs.data_[1];
+        data_[2] -= rhs.data_[2];
+
+        return *this;
+    }
+
+    gl_vector3 &operator*=(GLfloat const &rhs)
+    {
+        data_[0] *= rhs;
+        data_[1] *= rhs;
+        data_[2] *= rhs;
+
+        return *this;
+    }
+
+    gl_vector3 &operator/=(GLfloat const &rhs)
+    {
+        data_[0] /= rhs;
+        data_[1] /= rhs;
+        data_[2] /= rhs;
+
+        return *this;
+    }
+
+    constexpr GLfloat dot_product(gl_vector3 const &rhs) const
+    {
+        return ((data_[0] * rhs.data_[0])
+                + (data_[1] * rhs.data_[1])
+                + (data_[2] * rhs.data_[2]));
+    }
+
+    constexpr gl_vector3 cross_product(gl_vector3 const &rhs) const
+    {
+        return gl_vector3((data_[1] * rhs.data_[2])
+                          - (rhs.data_[1] * data_[2]),
+                          (data_[2] * rhs.data_[0])
+                          - (rhs.data_[2] * data_[0]),
+                          (data_[0] * rhs.data_[1])
+                          - (rhs.data_[0] * data_[1]));
+    }
+
+    // Same as MathInterpolate() on each part
+    constexpr gl_vector3 interpolate(gl_vector3 const &rhs,
+                                     GLfloat scalar) const
+    {
+        return gl_vector3((data_[0] * (1.0f - scalar))
+                          + (rhs.data_[0] * scalar),
+                          (data_[1] * (1.0f - scalar))
+                          + (rhs.data_[1] * scalar),
+                          (data_[2] * (1.0f - scalar))
+                          + (rhs.data_[2] * scalar));
+    }
+
+    void set_data(GLfloat x, GLfloat y, GLfloat z)
+    {
+        data_[0] = x;
+        data_[1] = y;
+        data_[2] = z;
+    }
+
+    void set_x(GLfloat x)
+    {
+        data_[0] = x;
+    }
+
+    void set_y(GLfloat y)
+    {
+        data_[1] = y;
+    }
+
+    void set_z(GLfloat z)
+    {
+        data_[2] = z;
+    }
+
+    GLfloat *get_data()
+    {
+        return data_;
+    }
+
+    GLfloat const *get_data() const
+    {
+        return data_;
+    }
+
+    constexpr GLfloat get_x() const
+    {
+        return data_[0];
+    }
+
+    constexpr GLfloat get_y() const
+    {
+        return data_[1];
+    }
+
+    constexpr GLfloat get_z() const
+    {
+        return data_[2];
+    }
 
 private:
     GLfloat data_[3];
 };
 
+static_assert(std::is_trivially_copyable<gl_vector3>::value,
+              "gl_vector3 must stay plain data");
+
+static_assert(sizeof(gl_vector3) == (sizeof(GLfloat) * 3),
+              "gl_vector3 must pack like three floats");
+
 inline gl_vector3 operator+(gl_vector3 lhs, gl_vector3 const &rhs)
 {
     lhs += rhs;
@@ -64,6 +192,25 @@ inline gl_vector3 operator/(gl_vector3 lhs, GLfloat const &rhs)
     return lhs;
 }
 
+// A smooth curve through p1 and p2, bending to meet the points either
+// side (Catmull-Rom). t runs from 0 at p1 to 1 at p2.
+inline gl_vector3 spline(gl_vector3 const &p0,
+                         gl_vector3 const &p1,
+                         gl_vector3 const &p2,
+                         gl_vector3 const &p3,
+                         GLfloat t)
+{
+    gl_vector3 a;
+    gl_vector3 b;
+    gl_vector3 c;
+
+    a = (p2 - p0) * 0.5f;
+    b = (p0 * 2.0f) - (p1 * 5.0f) + (p2 * 4.0f) - p3;
+    c = (p1 * 3.0f) - p0 - (p2 * 3.0f) + p3;
+
+    return p1 + (a * t) + (b * (0.5f * t * t)) + (c * (0.5f * t * t * t));
+}
+
 inline GLfloat dot_product(gl_vector3 const &lhs, gl_vector3 const &rhs)
 {
     return lhs.dot_product(rhs);
@@ -1,22 +1,47 @@
 #ifndef GL_VERTEX_HPP_
 #define GL_VERTEX_HPP_
 
+#include <type_traits>
+
 #include "gl-rgba.hpp"
 #include "gl-vector2.hpp"
 #include "gl-vector3.hpp"
 
 class gl_vertex {
 public:
-    gl_vertex();
-    virtual ~gl_vertex();
+    constexpr gl_vertex()
+    {
+    }
+
+    void set_position(gl_vector3 const &position)
+    {
+        position_ = position;
+    }
+
+    void set_uv(gl_vector2 const &uv)
+    {
+        uv_ = uv;
+    }
 
-    void set_position(gl_vector3 const &position);
-    void set_uv(gl_vector2 const &uv);
-    void set_color(gl_rgba const &color);
+    void set_color(gl_rgba const &color)
+    {
+        color_ = color;
+    }
 
-    gl_vector3 get_position() const;
-    gl_vector2 get_uv() const;
-    gl_rgba get_color() const;
+    constexpr gl_vector3 get_position() const
+    {
+        return position_;
+    }
+
+    constexpr gl_vector2 get_uv() const
+    {
+        return uv_;
+    }
+
+    constexpr gl_rgba get_color() const
+    {
+        return color_;
+    }
 
 private:
     gl_vector3 position_;
@@ -24,4 +49,7 @@ private:
     gl_rgba color_;
 };
 
+static_assert(std::is_trivially_copyable<gl_vertex>::value,
+              "gl_vertex must stay plain data");
+
 #endif
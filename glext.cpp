@@ -0,0 +1,280 @@
+/*
+ * glext.cpp
+ *
+ * Looks up the OpenGL entry points we use beyond 1.1, and keeps track of
+ * which optional features the driver can actually do. Everything that uses
+ * these has a plain fixed-function fallback.
+ *
+ */
+
+#include "glext.hpp"
+
+#include <SDL.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#define LOAD(type, name) ((type)SDL_GL_GetProcAddress(name))
+
+PFNGLCREATESHADERPROC pglCreateShader;
+PFNGLSHADERSOURCEPROC pglShaderSource;
+PFNGLCOMPILESHADERPROC pglCompileShader;
+PFNGLGETSHADERIVPROC pglGetShaderiv;
+PFNGLDELETESHADERPROC pglDeleteShader;
+PFNGLCREATEPROGRAMPROC pglCreateProgram;
+PFNGLATTACHSHADERPROC pglAttachShader;
+PFNGLLINKPROGRAMPROC pglLinkProgram;
+PFNGLGETPROGRAMIVPROC pglGetProgramiv;
+PFNGLDELETEPROGRAMPROC pglDeleteProgram;
+PFNGLUSEPROGRAMPROC pglUseProgram;
+PFNGLGETUNIFORMLOCATIONPROC pglGetUniformLocation;
+PFNGLUNIFORM1IPROC pglUniform1i;
+PFNGLUNIFORM1FPROC pglUniform1f;
+PFNGLMULTITEXCOORD1FARBPROC pglMultiTexCoord1f;
+PFNGLTEXIMAGE3DPROC pglTexImage3D;
+PFNGLTEXSUBIMAGE3DPROC pglTexSubImage3D;
+PFNGLCOMPRESSEDTEXIMAGE2DPROC pglCompressedTexImage2D;
+PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC pglCompressedTexSubImage3D;
+PFNGLUNIFORM2FPROC pglUniform2f;
+PFNGLGENFRAMEBUFFERSPROC pglGenFramebuffers;
+PFNGLDELETEFRAMEBUFFERSPROC pglDeleteFramebuffers;
+PFNGLBINDFRAMEBUFFERPROC pglBindFramebuffer;
+PFNGLFRAMEBUFFERTEXTURE2DPROC pglFramebufferTexture2D;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC pglCheckFramebufferStatus;
+PFNGLGENRENDERBUFFERSPROC pglGenRenderbuffers;
+PFNGLDELETERENDERBUFFERSPROC pglDeleteRenderbuffers;
+PFNGLBINDRENDERBUFFERPROC pglBindRenderbuffer;
+PFNGLRENDERBUFFERSTORAGEPROC pglRenderbufferStorage;
+PFNGLFRAMEBUFFERRENDERBUFFERPROC pglFramebufferRenderbuffer;
+PFNGLBLITFRAMEBUFFERPROC pglBlitFramebuffer;
+PFNGLGENERATEMIPMAPPROC pglGenerateMipmap;
+PFNGLGENQUERIESPROC pglGenQueries;
+PFNGLDELETEQUERIESPROC pglDeleteQueries;
+PFNGLBEGINQUERYPROC pglBeginQuery;
+PFNGLENDQUERYPROC pglEndQuery;
+PFNGLGETQUERYOBJECTIVPROC pglGetQueryObjectiv;
+PFNGLGETQUERYOBJECTUI64VPROC pglGetQueryObjectui64v;
+
+static bool shaders;
+static bool texture_array;
+static bool compression;
+static bool framebuffers;
+static bool timers;
+
+static bool has_extension(char const *name)
+{
+    char const *list;
+    char const *found;
+    size_t length;
+
+    list = (char const *)glGetString(GL_EXTENSIONS);
+    if(!list) {
+        return false;
+    }
+
+    // Make sure we matched a whole name and not the front of a longer one
+    length = strlen(name);
+    for(found = strstr(list, name); found; found = strstr(found + 1, name)) {
+        if(((found == list) || (found[-1] == ' '))
+           && ((found[length] == ' ') || (found[length] == '\0'))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static GLuint compile(GLenum type, char const *source)
+{
+    GLuint shader;
+    GLint ok;
+
+    shader = pglCreateShader(type);
+    pglShaderSource(shader, 1, &source, NULL);
+    pglCompileShader(shader);
+    pglGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if(!ok) {
+        pglDeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+void GlextInit(void)
+{
+    char const *version;
+
+    pglCreateShader = LOAD(PFNGLCREATESHADERPROC, "glCreateShader");
+    pglShaderSource = LOAD(PFNGLSHADERSOURCEPROC, "glShaderSource");
+    pglCompileShader = LOAD(PFNGLCOMPILESHADERPROC, "glCompileShader");
+    pglGetShaderiv = LOAD(PFNGLGETSHADERIVPROC, "glGetShaderiv");
+    pglDeleteShader = LOAD(PFNGLDELETESHADERPROC, "glDeleteShader");
+    pglCreateProgram = LOAD(PFNGLCREATEPROGRAMPROC, "glCreateProgram");
+    pglAttachShader = LOAD(PFNGLATTACHSHADERPROC, "glAttachShader");
+    pglLinkProgram = LOAD(PFNGLLINKPROGRAMPROC, "glLinkProgram");
+    pglGetProgramiv = LOAD(PFNGLGETPROGRAMIVPROC, "glGetProgramiv");
+    pglDeleteProgram = LOAD(PFNGLDELETEPROGRAMPROC, "glDeleteProgram");
+    pglUseProgram = LOAD(PFNGLUSEPROGRAMPROC, "glUseProgram");
+    pglGetUniformLocation = LOAD(PFNGLGETUNIFORMLOCATIONPROC,
+                                 "glGetUniformLocation");
+
+    pglUniform1i = LOAD(PFNGLUNIFORM1IPROC, "glUniform1i");
+    pglUniform1f = LOAD(PFNGLUNIFORM1FPROC, "glUniform1f");
+    pglUniform2f = LOAD(PFNGLUNIFORM2FPROC, "glUniform2f");
+    pglMultiTexCoord1f = LOAD(PFNGLMULTITEXCOORD1FARBPROC, "glMultiTexCoord1f");
+    pglTexImage3D = LOAD(PFNGLTEXIMAGE3DPROC, "glTexImage3D");
+    pglTexSubImage3D = LOAD(PFNGLTEXSUBIMAGE3DPROC, "glTexSubImage3D");
+    pglCompressedTexImage2D = LOAD(PFNGLCOMPRESSEDTEXIMAGE2DPROC,
+                                   "glCompressedTexImage2D");
+
+    pglCompressedTexSubImage3D = LOAD(PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC,
+                                      "glCompressedTexSubImage3D");
+
+    pglGenFramebuffers = LOAD(PFNGLGENFRAMEBUFFERSPROC, "glGenFramebuffers");
+    pglDeleteFramebuffers = LOAD(PFNGLDELETEFRAMEBUFFERSPROC,
+                                 "glDeleteFramebuffers");
+
+    pglBindFramebuffer = LOAD(PFNGLBINDFRAMEBUFFERPROC, "glBindFramebuffer");
+    pglFramebufferTexture2D = LOAD(PFNGLFRAMEBUFFERTEXTURE2DPROC,
+                                   "glFramebufferTexture2D");
+
+    pglCheckFramebufferStatus = LOAD(PFNGLCHECKFRAMEBUFFERSTATUSPROC,
+                                     "glCheckFramebufferStatus");
+
+    pglGenRenderbuffers = LOAD(PFNGLGENRENDERBUFFERSPROC,
+                               "glGenRenderbuffers");
+
+    pglDeleteRenderbuffers = LOAD(PFNGLDELETERENDERBUFFERSPROC,
+                                  "glDeleteRenderbuffers");
+
+    pglBindRenderbuffer = LOAD(PFNGLBINDRENDERBUFFERPROC,
+                               "glBindRenderbuffer");
+
+    pglRenderbufferStorage = LOAD(PFNGLRENDERBUFFERSTORAGEPROC,
+                                  "glRenderbufferStorage");
+
+    pglFramebufferRenderbuffer = LOAD(PFNGLFRAMEBUFFERRENDERBUFFERPROC,
+                                      "glFramebufferRenderbuffer");
+
+    pglBlitFramebuffer = LOAD(PFNGLBLITFRAMEBUFFERPROC, "glBlitFramebuffer");
+    pglGenerateMipmap = LOAD(PFNGLGENERATEMIPMAPPROC, "glGenerateMipmap");
+    pglGenQueries = LOAD(PFNGLGENQUERIESPROC, "glGenQueries");
+    pglDeleteQueries = LOAD(PFNGLDELETEQUERIESPROC, "glDeleteQueries");
+    pglBeginQuery = LOAD(PFNGLBEGINQUERYPROC, "glBeginQuery");
+    pglEndQuery = LOAD(PFNGLENDQUERYPROC, "glEndQuery");
+    pglGetQueryObjectiv = LOAD(PFNGLGETQUERYOBJECTIVPROC,
+                               "glGetQueryObjectiv");
+
+    pglGetQueryObjectui64v = LOAD(PFNGLGETQUERYOBJECTUI64VPROC,
+                                  "glGetQueryObjectui64v");
+
+    // The GLSL we use is 1.10, which came with OpenGL 2.0
+    version = (char const *)glGetString(GL_VERSION);
+    shaders = version && (atoi(version) >= 2)
+        && pglCreateShader && pglShaderSource && pglCompileShader
+        && pglGetShaderiv && pglDeleteShader && pglCreateProgram
+        && pglAttachShader && pglLinkProgram && pglGetProgramiv
+        && pglDeleteProgram && pglUseProgram && pglGetUniformLocation
+        && pglUniform1i && pglUniform1f && pglUniform2f
+        && pglMultiTexCoord1f;
+
+    texture_array = shaders
+        && has_extension("GL_EXT_texture_array")
+        && pglTexImage3D
+        && pglTexSubImage3D;
+
+    // The unsuffixed framebuffer calls came with OpenGL 3.0, or with the
+    // ARB extension on older drivers.
+    framebuffers = version
+        && ((atoi(version) >= 3)
+            || has_extension("GL_ARB_framebuffer_object"))
+        && pglGenFramebuffers && pglDeleteFramebuffers && pglBindFramebuffer
+        && pglFramebufferTexture2D && pglCheckFramebufferStatus
+        && pglGenRenderbuffers && pglDeleteRenderbuffers
+        && pglBindRenderbuffer && pglRenderbufferStorage
+        && pglFramebufferRenderbuffer && pglBlitFramebuffer
+        && pglGenerateMipmap;
+
+    // Timing the card came with OpenGL 3.3, or the ARB extension
+    timers = version
+        && ((atof(version) >= 3.3)
+            || has_extension("GL_ARB_timer_query"))
+        && pglGenQueries && pglDeleteQueries && pglBeginQuery
+        && pglEndQuery && pglGetQueryObjectiv && pglGetQueryObjectui64v;
+
+    // Compressed layers of a texture array need the 3D upload as well
+    compression = has_extension("GL_EXT_texture_compression_s3tc")
+        && pglCompressedTexImage2D
+        && (!texture_array || pglCompressedTexSubImage3D);
+}
+
+bool GlextShaders(void)
+{
+    return shaders;
+}
+
+bool GlextTextureArray(void)
+{
+    return texture_array;
+}
+
+bool GlextCompression(void)
+{
+    return compression;
+}
+
+bool GlextFramebuffers(void)
+{
+    return framebuffers;
+}
+
+bool GlextTimers(void)
+{
+    return timers;
+}
+
+// Compile and link a program from the two sources. Zero if anything about
+// it didn't work, in which case the caller should fall back to the old way.
+GLuint GlextProgram(char const *vertex, char const *fragment)
+{
+    GLuint program;
+    GLuint vs;
+    GLuint fs;
+    GLint ok;
+
+    if(!shaders) {
+        return 0;
+    }
+
+    vs = compile(GL_VERTEX_SHADER, vertex);
+    fs = compile(GL_FRAGMENT_SHADER, fragment);
+    if(!vs || !fs) {
+        if(vs) {
+            pglDeleteShader(vs);
+        }
+
+        if(fs) {
+            pglDeleteShader(fs);
+        }
+
+        return 0;
+    }
+
+    program = pglCreateProgram();
+    pglAttachShader(program, vs);
+    pglAttachShader(program, fs);
+    pglLinkProgram(program);
+
+    // The program keeps them alive for as long as it needs them
+    pglDeleteShader(vs);
+    pglDeleteShader(fs);
+
+    pglGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if(!ok) {
+        pglDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
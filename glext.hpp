@@ -0,0 +1,55 @@
+#ifndef GLEXT_HPP_
+#define GLEXT_HPP_
+
+#include <SDL_opengl.h>
+
+// Entry points past OpenGL 1.1 have to be looked up at run time. Anything
+// here may be NULL, so check GlextShaders() and friends before using them.
+extern PFNGLCREATESHADERPROC pglCreateShader;
+extern PFNGLSHADERSOURCEPROC pglShaderSource;
+extern PFNGLCOMPILESHADERPROC pglCompileShader;
+extern PFNGLGETSHADERIVPROC pglGetShaderiv;
+extern PFNGLDELETESHADERPROC pglDeleteShader;
+extern PFNGLCREATEPROGRAMPROC pglCreateProgram;
+extern PFNGLATTACHSHADERPROC pglAttachShader;
+extern PFNGLLINKPROGRAMPROC pglLinkProgram;
+extern PFNGLGETPROGRAMIVPROC pglGetProgramiv;
+extern PFNGLDELETEPROGRAMPROC pglDeleteProgram;
+extern PFNGLUSEPROGRAMPROC pglUseProgram;
+extern PFNGLGETUNIFORMLOCATIONPROC pglGetUniformLocation;
+extern PFNGLUNIFORM1IPROC pglUniform1i;
+extern PFNGLUNIFORM1FPROC pglUniform1f;
+extern PFNGLMULTITEXCOORD1FARBPROC pglMultiTexCoord1f;
+extern PFNGLTEXIMAGE3DPROC pglTexImage3D;
+extern PFNGLTEXSUBIMAGE3DPROC pglTexSubImage3D;
+extern PFNGLCOMPRESSEDTEXIMAGE2DPROC pglCompressedTexImage2D;
+extern PFNGLCOMPRESSEDTEXSUBIMAGE3DPROC pglCompressedTexSubImage3D;
+extern PFNGLUNIFORM2FPROC pglUniform2f;
+extern PFNGLGENFRAMEBUFFERSPROC pglGenFramebuffers;
+extern PFNGLDELETEFRAMEBUFFERSPROC pglDeleteFramebuffers;
+extern PFNGLBINDFRAMEBUFFERPROC pglBindFramebuffer;
+extern PFNGLFRAMEBUFFERTEXTURE2DPROC pglFramebufferTexture2D;
+extern PFNGLCHECKFRAMEBUFFERSTATUSPROC pglCheckFramebufferStatus;
+extern PFNGLGENRENDERBUFFERSPROC pglGenRenderbuffers;
+extern PFNGLDELETERENDERBUFFERSPROC pglDeleteRenderbuffers;
+extern PFNGLBINDRENDERBUFFERPROC pglBindRenderbuffer;
+extern PFNGLRENDERBUFFERSTORAGEPROC pglRenderbufferStorage;
+extern PFNGLFRAMEBUFFERRENDERBUFFERPROC pglFramebufferRenderbuffer;
+extern PFNGLBLITFRAMEBUFFERPROC pglBlitFramebuffer;
+extern PFNGLGENERATEMIPMAPPROC pglGenerateMipmap;
+extern PFNGLGENQUERIESPROC pglGenQueries;
+extern PFNGLDELETEQUERIESPROC pglDeleteQueries;
+extern PFNGLBEGINQUERYPROC pglBeginQuery;
+extern PFNGLENDQUERYPROC pglEndQuery;
+extern PFNGLGETQUERYOBJECTIVPROC pglGetQueryObjectiv;
+extern PFNGLGETQUERYOBJECTUI64VPROC pglGetQueryObjectui64v;
+
+void GlextInit(void);
+bool GlextShaders(void);
+bool GlextTextureArray(void);
+bool GlextCompression(void);
+bool GlextFramebuffers(void);
+bool GlextTimers(void);
+GLuint GlextProgram(char const *vertex, char const *fragment);
+
+#endif /* GLEXT_HPP_ */
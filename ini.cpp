@@ -1,30 +1,316 @@
 /*
  * ini.cpp
- * 
+ *
  * 2009 Shamus Young
  *
  * This takes various types of data and dumps them into a predefined ini file.
  *
+ * The file is read once at startup, and each value is turned into an int, a
+ * float and a vector right then, so asking for one later is just a lookup.
+ * Anything given on the command line as --Name=value sits on top of the
+ * file for this run only and is never written back. If someone edits the
+ * file while we're running, it gets read again and IniSerial() goes up, so
+ * whoever cares can pick up the new values.
+ *
+ * Saving writes a whole new file next to the old one and renames it over
+ * the top, so a crash halfway through can't leave half a file behind.
+ * Comments in a hand-edited file don't survive a save.
+ *
  */
 
 #include "ini.hpp"
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 #include "win.hpp"
 
 #define FORMAT_VECTOR "%f %f %f"
 #define MAX_RESULT 256
+#define MAX_LINE 512
 #define FORMAT_FLOAT "%1.2f"
-#define INI_FILE ".\\" APP ".ini"
+#define INI_FILE APP ".ini"
+#define INI_TEMP INI_FILE ".tmp"
 #define SECTION "Settings"
 
+struct ini_entry {
+    std::string text;
+    int number;
+    float real;
+    gl_vector3 vector;
+};
+
+// std::less<> lets us look up with a plain char * without building a
+// std::string every time
+typedef std::map<std::string, ini_entry, std::less<> > ini_map;
+
 static char result[MAX_RESULT];
+static ini_map file_entries;
+static ini_map arg_entries;
+static ini_map changed;
+static ini_map last_read;
+static unsigned int serial;
+static int watch = -1;
+
+static ini_entry parse(char const *text)
+{
+    ini_entry e;
+    GLfloat x = 0.0f;
+    GLfloat y = 0.0f;
+    GLfloat z = 0.0f;
+
+    e.text = text;
+    e.number = atoi(text);
+    e.real = (float)atof(text);
+    sscanf(text, FORMAT_VECTOR, &x, &y, &z);
+    e.vector = gl_vector3(x, y, z);
+
+    return e;
+}
+
+static ini_entry const *find(char const *entry)
+{
+    ini_map::const_iterator i;
+
+    i = arg_entries.find(entry);
+    if(i != arg_entries.end()) {
+        return &i->second;
+    }
+
+    i = file_entries.find(entry);
+    if(i != file_entries.end()) {
+        return &i->second;
+    }
+
+    return NULL;
+}
+
+// Setting something from inside the program means the user asked for it,
+// so it beats whatever the command line said
+static void set(char const *entry, char const *text)
+{
+    ini_map::iterator i;
+
+    arg_entries.erase(entry);
+    i = file_entries.find(entry);
+    if((i != file_entries.end()) && (i->second.text == text)) {
+        return;
+    }
+
+    file_entries[entry] = changed[entry] = parse(text);
+}
+
+static char *trim(char *s)
+{
+    char *end;
+
+    while((*s == ' ') || (*s == '\t')) {
+        s++;
+    }
+
+    end = s + strlen(s);
+    while((end > s) && strchr(" \t\r\n", end[-1])) {
+        end--;
+    }
+
+    *end = 0;
+
+    return s;
+}
+
+// Only the one section is ours. Lines before any section heading count
+// too, so a file written by hand doesn't need one. Anything we've changed
+// and not saved yet stays the way we left it, unless someone edited that
+// very line since we last read the file. Then they're newer than we are,
+// and the file wins. Edits to other lines leave our changes alone.
+static void load(void)
+{
+    FILE *f;
+    char line[MAX_LINE];
+    char *s;
+    char *equals;
+    ini_map::iterator i;
+    ini_map::const_iterator in_file;
+    ini_map::const_iterator before;
+    bool ours;
+
+    f = fopen(INI_FILE, "r");
+    if(!f) {
+        return;
+    }
+
+    file_entries.clear();
+    ours = true;
+    while(fgets(line, MAX_LINE, f)) {
+        s = trim(line);
+        if(!s[0] || (s[0] == ';') || (s[0] == '#')) {
+            continue;
+        }
+
+        if(s[0] == '[') {
+            ours = !strncmp(s + 1, SECTION "]", strlen(SECTION) + 1);
+            continue;
+        }
+
+        equals = strchr(s, '=');
+        if(!ours || !equals) {
+            continue;
+        }
+
+        *equals = 0;
+        file_entries[trim(s)] = parse(trim(equals + 1));
+    }
+
+    fclose(f);
+    for(i = changed.begin(); i != changed.end();) {
+        in_file = file_entries.find(i->first);
+        before = last_read.find(i->first);
+        if((in_file != file_entries.end())
+           && ((before == last_read.end())
+               || (before->second.text != in_file->second.text))) {
+            i = changed.erase(i);
+        }
+        else {
+            ++i;
+        }
+    }
+
+    last_read = file_entries;
+    for(i = changed.begin(); i != changed.end(); ++i) {
+        file_entries[i->first] = i->second;
+    }
+}
+
+static void save(void)
+{
+    FILE *f;
+    ini_map::const_iterator i;
+    bool ok;
+
+    f = fopen(INI_TEMP, "w");
+    if(!f) {
+        return;
+    }
+
+    fprintf(f, "[" SECTION "]\n");
+    for(i = file_entries.begin(); i != file_entries.end(); ++i) {
+        fprintf(f, "%s=%s\n", i->first.c_str(), i->second.text.c_str());
+    }
+
+    ok = (fflush(f) == 0);
+#if defined(__linux__)
+    ok = ok && (fsync(fileno(f)) == 0);
+#endif
+    ok = (fclose(f) == 0) && ok;
+    if(!ok || rename(INI_TEMP, INI_FILE)) {
+        remove(INI_TEMP);
+        return;
+    }
+
+    changed.clear();
+}
+
+void IniInit(void)
+{
+    load();
+
+#if defined(__linux__)
+    // Watch the directory rather than the file, since an editor (or our
+    // own save) may replace the file instead of writing into it
+    watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if((watch >= 0)
+       && (inotify_add_watch(watch, ".", IN_CLOSE_WRITE | IN_MOVED_TO) < 0)) {
+        close(watch);
+        watch = -1;
+    }
+#endif
+}
+
+// Take --Name=value settings off the command line. Anything else is left
+// for someone else to deal with.
+void IniArgs(int argc, char *argv[])
+{
+    char *equals;
+    int i;
+
+    for(i = 1; i < argc; ++i) {
+        equals = strchr(argv[i], '=');
+        if(strncmp(argv[i], "--", 2) || !equals || (equals == argv[i] + 2)) {
+            continue;
+        }
+
+        arg_entries[std::string(argv[i] + 2, equals)] = parse(equals + 1);
+    }
+}
+
+// See if the file changed on disk. Cheap enough to call every frame.
+void IniUpdate(void)
+{
+#if defined(__linux__)
+    char buf[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct inotify_event const *event;
+    ssize_t len;
+    ssize_t i;
+    bool modified;
+
+    if(watch < 0) {
+        return;
+    }
+
+    modified = false;
+    while((len = read(watch, buf, sizeof(buf))) > 0) {
+        for(i = 0; i < len; i += sizeof(*event) + event->len) {
+            event = (struct inotify_event const *)(buf + i);
+            if(event->len && !strcmp(event->name, INI_FILE)) {
+                modified = true;
+            }
+        }
+    }
+
+    if(modified) {
+        load();
+        serial++;
+    }
+#endif
+}
+
+// Goes up every time the file is read again
+unsigned int IniSerial(void)
+{
+    return serial;
+}
+
+void IniTerm(void)
+{
+    if(!changed.empty()) {
+        save();
+    }
+
+#if defined(__linux__)
+    if(watch >= 0) {
+        close(watch);
+        watch = -1;
+    }
+#endif
+}
 
 int IniInt(char const *entry)
 {
-    return 0;
+    ini_entry const *e;
+
+    e = find(entry);
+
+    return e ? e->number : 0;
 }
 
 void IniIntSet(char const *entry, int val)
@@ -32,14 +318,16 @@ void IniIntSet(char const *entry, int val)
     char buf[20];
 
     sprintf(buf, "%d", val);
+    set(entry, buf);
 }
 
 float IniFloat(char const *entry)
 {
-    float f;
+    ini_entry const *e;
+
+    e = find(entry);
 
-    f = (float)atof(result);
-    return f;
+    return e ? e->real : 0.0f;
 }
 
 void IniFloatSet(char const *entry, float val)
@@ -47,29 +335,40 @@ void IniFloatSet(char const *entry, float val)
     char buf[20];
 
     sprintf(buf, FORMAT_FLOAT, val);
+    set(entry, buf);
 }
 
 char *IniString(char const *entry)
 {
+    ini_entry const *e;
+
+    e = find(entry);
+    result[0] = 0;
+    if(e) {
+        snprintf(result, MAX_RESULT, "%s", e->text.c_str());
+    }
+
     return result;
 }
 
 void IniStringSet(char const *entry, char *val)
 {
+    set(entry, val);
 }
 
 void IniVectorSet(char const *entry, gl_vector3 v)
 {
-    sprintf(result, FORMAT_VECTOR, v.get_x(), v.get_y(), v.get_z());
+    char buf[MAX_RESULT];
+
+    snprintf(buf, MAX_RESULT, FORMAT_VECTOR, v.get_x(), v.get_y(), v.get_z());
+    set(entry, buf);
 }
 
 gl_vector3 IniVector(char const *entry)
 {
-    GLfloat x = 0.0f;
-    GLfloat y = 0.0f;
-    GLfloat z = 0.0f;
-    
-    sscanf(result, FORMAT_VECTOR, &x, &y, &z);
+    ini_entry const *e;
+
+    e = find(entry);
 
-    return gl_vector3(x, y, z);
+    return e ? e->vector : gl_vector3();
 }
@@ -3,6 +3,11 @@
 
 #include "gl-vector3.hpp"
 
+void IniInit(void);
+void IniArgs(int argc, char *argv[]);
+void IniUpdate(void);
+unsigned int IniSerial(void);
+void IniTerm(void);
 int IniInt(char const *entry);
 void IniIntSet(char const *entry, int val);
 float IniFloat(char const *entry);
@@ -15,12 +15,14 @@
 
 #include <SDL.h>
 #include <cmath>
+#include <vector>
 
 #include "camera.hpp"
 #include "entity.hpp"
 #include "gl-vector2.hpp"
 #include "macro.hpp"
 #include "math.hpp"
+#include "pass.hpp"
 #include "random.hpp"
 #include "render.hpp"
 #include "texture.hpp"
@@ -29,22 +31,43 @@
 
 #define MAX_SIZE 5
 
-static gl_vector2 angles[5][360];
 static Light *head;
-static bool angles_done;
+static Light *pending;
 static int count;
+static int pending_count;
+static gl_vector2 facing;
+static std::vector<pass_vertex> vertices;
 
+static unsigned char to_byte(float c)
+{
+    return (unsigned char)(CLAMP(c, 0.0f, 1.0f) * 255.0f);
+}
+
+// Throw away the lights of the city being built. New lights always go
+// there, and only show up once LightSwap() puts them on screen.
 void LightClear()
 {
     Light *l;
 
-    while(head) {
-        l = head;
-        head = l->next_;
+    while(pending) {
+        l = pending;
+        pending = l->next_;
         delete l;
     }
 
-    count = 0;
+    pending_count = 0;
+}
+
+void LightSwap()
+{
+    Light *l;
+
+    l = head;
+    head = pending;
+    pending = l;
+
+    count = pending_count;
+    LightClear();
 }
 
 int LightCount()
@@ -52,53 +75,58 @@ int LightCount()
     return count;
 }
 
-void LightRender()
+Light *LightPendingFirst()
+{
+    return pending;
+}
+
+// Work out which lights show and where their corners go. There's no GL
+// in here, so it runs on a worker while the buildings are drawn.
+void LightPrepare()
 {
     Light *l;
+    pass_vertex quad[4];
+    float angle;
 
-    if(!EntityReady()) {
-        return;
+    // Every light turns to face the camera the same way
+    angle = camera_angle().get_y();
+    facing.set_data(MathCos(angle), MathSin(angle));
+    vertices.clear();
+    for(l = head; l; l = l->next_) {
+        if(l->Fill(quad)) {
+            vertices.insert(vertices.end(), quad, quad + 4);
+        }
     }
+}
 
-    if(!angles_done) {
-        for(int size = 0; size < MAX_SIZE; ++size) {
-            for(int i = 0; i < 360; ++i) {
-                float radians = (float)i * DEGREES_TO_RADIANS;
-                angles[size][i].set_x(cosf(radians) * ((float)size + 0.5f));
-                angles[size][i].set_y(sinf(radians) * ((float)size + 0.5f));
-            }
-        }
+// Draw what LightPrepare() came up with
+void LightRender()
+{
+    if(!EntityReady() || vertices.empty()) {
+        return;
     }
 
-    glDepthMask(false);
-    glEnable(GL_BLEND);
-    glDisable(GL_CULL_FACE);
-    glBlendFunc(GL_ONE, GL_ONE);
     glBindTexture(GL_TEXTURE_2D, TextureId(TEXTURE_LIGHT));
-    glDisable(GL_CULL_FACE);
-    glBegin(GL_QUADS);
-
-    for(l = head; l; l = l->next_) {
-        l->Render();
-    }
-    
-    glEnd();
-    glDepthMask(true);
+    PassQuads(&vertices[0], vertices.size());
 }
 
 Light::Light(gl_vector3 pos, gl_rgba color, int size)
 {
     position_ = pos;
     color_ = color;
+    rgba_[0] = to_byte(color.get_red());
+    rgba_[1] = to_byte(color.get_green());
+    rgba_[2] = to_byte(color.get_blue());
+    rgba_[3] = to_byte(color.get_alpha());
     size_ = CLAMP(size, 0, (MAX_SIZE - 1));
     vert_size_ = (float)size_ + 0.5f;
     flat_size_ = vert_size_ + 0.5f;
     blink_ = false;
     cell_x_ = WORLD_TO_GRID(pos.get_x());
     cell_z_ = WORLD_TO_GRID(pos.get_z());
-    next_ = head;
-    head = this;
-    count++;
+    next_ = pending;
+    pending = this;
+    pending_count++;
 }
 
 void Light::Blink()
@@ -110,53 +138,89 @@ void Light::Blink()
     blink_interval_ = 1500 + RandomVal(500);
 }
 
-void Light::Render()
+void Light::Blink(unsigned interval)
+{
+    blink_ = true;
+    blink_interval_ = interval;
+}
+
+gl_vector3 Light::position()
+{
+    return position_;
+}
+
+gl_rgba Light::color()
+{
+    return color_;
+}
+
+int Light::size()
+{
+    return size_;
+}
+
+// Zero if the light doesn't blink
+unsigned Light::blink_interval()
+{
+    return blink_ ? blink_interval_ : 0;
+}
+
+// Put the corners of this light into quad, unless it can't be seen
+bool Light::Fill(pass_vertex *quad)
 {
-    int angle;
     gl_vector3 pos;
-    gl_vector3 camera;
     gl_vector3 camera_pos;
     gl_vector2 offset;
 
     if(!Visible(cell_x_, cell_z_)) {
-        return;
+        return false;
     }
 
-    camera = camera_angle();
     camera_pos = camera_position();
     
     if(fabs(camera_pos.get_x() - position_.get_x()) > RenderFogDistance()) {
-        return;
+        return false;
     }
     if(fabs(camera_pos.get_x() - position_.get_z()) > RenderFogDistance()) {
-        return;
+        return false;
     }
     if(blink_ && ((SDL_GetTicks() % blink_interval_) > 200)) {
-        return;
+        return false;
     }
 
-    angle = (int)MathAngle(camera.get_y());
-    offset = angles[size_][angle];
+    offset = facing * vert_size_;
     pos = position_;
-    glColor4fv(color_.get_data());
-    
-    glTexCoord2f(0, 0);
-    glVertex3f(pos.get_x() + offset.get_x(),
+    PassVertex(&quad[0],
+               0,
+               0,
+               rgba_,
+               pos.get_x() + offset.get_x(),
                pos.get_y() - vert_size_,
                pos.get_z() + offset.get_y());
-    
-    glTexCoord2f(0, 1);
-    glVertex3f(pos.get_x() - offset.get_x(), 
+
+    PassVertex(&quad[1],
+               0,
+               1,
+               rgba_,
+               pos.get_x() - offset.get_x(),
                pos.get_y() - vert_size_,
                pos.get_z() - offset.get_y());
-    
-    glTexCoord2f(1, 1);
-    glVertex3f(pos.get_x() - offset.get_x(),
+
+    PassVertex(&quad[2],
+               1,
+               1,
+               rgba_,
+               pos.get_x() - offset.get_x(),
                pos.get_y() + vert_size_,
                pos.get_z() - offset.get_y());
 
-    glTexCoord2f(1, 0);
-    glVertex3f(pos.get_x() + offset.get_x(), 
-               pos.get_y() + vert_size_, 
+    PassVertex(&quad[3],
+               1,
+               0,
+               rgba_,
+               pos.get_x() + offset.get_x(),
+               pos.get_y() + vert_size_,
                pos.get_z() + offset.get_y());
+
+    return true;
 }
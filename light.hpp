@@ -3,17 +3,24 @@
 
 #include "gl-rgba.hpp"
 #include "gl-vector3.hpp"
+#include "pass.hpp"
 
 class Light {
 public:
     Light(gl_vector3 pos, gl_rgba color, int size);
     Light *next_;
-    void Render();
+    bool Fill(pass_vertex *quad);
     void Blink();
+    void Blink(unsigned interval);
+    gl_vector3 position();
+    gl_rgba color();
+    int size();
+    unsigned blink_interval();
 
 private:
     gl_vector3 position_;
     gl_rgba color_;
+    unsigned char rgba_[4];
     int size_;
     float vert_size_;
     float flat_size_;
@@ -23,8 +30,11 @@ private:
     int cell_z_;
 };
 
+void LightPrepare();
 void LightRender();
 void LightClear();
+void LightSwap();
+Light *LightPendingFirst();
 int LightCount();
 
 #endif /* LIGHT_HPP_ */
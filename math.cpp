@@ -9,59 +9,171 @@
 
 #include "math.hpp"
 
+#include <cfloat>
 #include <cmath>
+#include <cstdio>
+#include <ctime>
 
+#include "gl-simd.hpp"
 #include "macro.hpp"
 
+// A power of two, so wrapping around is a mask
+#define SINE_STEPS 1024
+#define BENCH_COUNT 1000000
+#define HALF_PI 1.57079633f
+#define ONE_PI 3.14159265f
+#define TWO_PI 6.28318531f
+
+// From Abramowitz and Stegun, 4.4.49. Good to 0.00001 radians over 0..1.
+#define ATAN_1 0.9998660f
+#define ATAN_3 -0.3302995f
+#define ATAN_5 0.1801410f
+#define ATAN_7 -0.0851330f
+#define ATAN_9 0.0208351f
+
+// One whole turn, plus the start again so there's always a next one to
+// blend toward
+static float sines[SINE_STEPS + 1];
+
+// Arc tangent of a ratio between 0 and 1, in radians
+static inline float atan_unit(float a)
+{
+    float s;
+    float sum;
+
+    s = a * a;
+    sum = ATAN_7 + (s * ATAN_9);
+    sum = ATAN_5 + (s * sum);
+    sum = ATAN_3 + (s * sum);
+    sum = ATAN_1 + (s * sum);
+
+    return a * sum;
+}
+
+static inline gl_simd4 atan_unit(gl_simd4 a)
+{
+    gl_simd4 s;
+    gl_simd4 sum;
+
+    s = gl_simd_mul(a, a);
+    sum = gl_simd_madd(s, gl_simd_splat(ATAN_9), gl_simd_splat(ATAN_7));
+    sum = gl_simd_madd(s, sum, gl_simd_splat(ATAN_5));
+    sum = gl_simd_madd(s, sum, gl_simd_splat(ATAN_3));
+    sum = gl_simd_madd(s, sum, gl_simd_splat(ATAN_1));
+
+    return gl_simd_mul(a, sum);
+}
+
+// The tables have to be filled before any worker can reach them
+void MathInit(void)
+{
+    int i;
+
+    for(i = 0; i <= SINE_STEPS; ++i) {
+        sines[i] = (float)sin((i * 2.0 * PI) / SINE_STEPS);
+    }
+}
+
 // Keep an angle between 0 and 360
 float MathAngle(float angle)
 {
-    if(angle < 0.0f) {
-        angle = 360.0f - (float)fmod(fabs(angle), 360.0f);
-    }
-    else {
-        angle = (float)fmod(angle, 360.0f);
-    }
+    angle -= 360.0f * floorf(angle / 360.0f);
 
-    return angle;
+    // A tiny negative angle can round up to a whole turn
+    return (angle < 360.0f) ? angle : 0.0f;
 }
 
-// Get an angle between two given points on a grid
+// Get an angle between two given points on a grid. Straight down the z
+// axis is 0 and it goes around toward x. This used to branch around
+// atan() for each octant; now every case goes through the same few
+// multiplies and the picks between them compile to selects.
 float MathAngle(float x1, float y1, float x2, float y2)
 {
     float x_delta;
     float z_delta;
+    float ax;
+    float az;
     float angle;
 
     z_delta = y1 - y2;
     x_delta = x1 - x2;
-    if(x_delta == 0) {
-        if(z_delta > 0) {
-            return 0.0f;
-        }
-        else {
-            return 180.0f;
-        }
-    }
+    ax = fabsf(x_delta);
+    az = fabsf(z_delta);
+    angle = atan_unit(MIN(ax, az) / MAX(MAX(ax, az), FLT_MIN));
+    angle = (ax > az) ? (HALF_PI - angle) : angle;
+    angle = (z_delta > 0.0f) ? angle : (ONE_PI - angle);
+    angle = (x_delta < 0.0f) ? (TWO_PI - angle) : angle;
 
-    if(fabs(x_delta) < fabs(z_delta)) {
-        angle = 90 - ((float)atan(z_delta / x_delta) * RADIANS_TO_DEGREES);
-        if(x_delta < 0) {
-            angle -= 180.0f;
-        }
-    }
-    else {
-        angle = (float)atan(x_delta / z_delta) * RADIANS_TO_DEGREES;
-        if(z_delta < 0.0f) {
-            angle += 180.0f;
-        }
+    return angle * RADIANS_TO_DEGREES;
+}
+
+// MathAngle() from each of a run of points to the same place, four at a
+// time
+void MathAngles(float const *x,
+                float const *y,
+                float to_x,
+                float to_y,
+                float *out,
+                int count)
+{
+    gl_simd4 zero;
+    gl_simd4 x_delta;
+    gl_simd4 z_delta;
+    gl_simd4 ax;
+    gl_simd4 az;
+    gl_simd4 angle;
+    int i;
+
+    zero = gl_simd_splat(0.0f);
+    for(i = 0; (i + 4) <= count; i += 4) {
+        x_delta = gl_simd_sub(gl_simd_load(x + i), gl_simd_splat(to_x));
+        z_delta = gl_simd_sub(gl_simd_load(y + i), gl_simd_splat(to_y));
+        ax = gl_simd_max(x_delta, gl_simd_sub(zero, x_delta));
+        az = gl_simd_max(z_delta, gl_simd_sub(zero, z_delta));
+        angle = atan_unit(gl_simd_div(gl_simd_min(ax, az),
+                                      gl_simd_max(gl_simd_max(ax, az),
+                                                  gl_simd_splat(FLT_MIN))));
+
+        angle = gl_simd_select(gl_simd_less(az, ax),
+                               gl_simd_sub(gl_simd_splat(HALF_PI), angle),
+                               angle);
+
+        angle = gl_simd_select(gl_simd_less(zero, z_delta),
+                               angle,
+                               gl_simd_sub(gl_simd_splat(ONE_PI), angle));
+
+        angle = gl_simd_select(gl_simd_less(x_delta, zero),
+                               gl_simd_sub(gl_simd_splat(TWO_PI), angle),
+                               angle);
+
+        gl_simd_store(out + i,
+                      gl_simd_mul(angle,
+                                  gl_simd_splat(RADIANS_TO_DEGREES)));
     }
 
-    if(angle < 0.0f) {
-        angle += 360.0f;
+    for(; i < count; ++i) {
+        out[i] = MathAngle(x[i], y[i], to_x, to_y);
     }
+}
+
+// Sine of an angle in degrees, from a table. It's off by no more than
+// about 0.000005, well under what a pixel can show.
+float MathSin(float angle)
+{
+    float step;
+    int i;
 
-    return angle;
+    step = angle * (SINE_STEPS / 360.0f);
+    i = (int)floorf(step);
+    step -= (float)i;
+    i &= (SINE_STEPS - 1);
+
+    return sines[i] + ((sines[i + 1] - sines[i]) * step);
+}
+
+float MathCos(float angle)
+{
+    return MathSin(angle + 90.0f);
 }
 
 // Get distance (squared) between 2 points on a plane
@@ -89,21 +201,14 @@ float MathDistance(float x1, float y1, float x2, float y2)
     return (float)sqrt((dx * dx) + (dy * dy));
 }
 
-// Difference between two angles
+// Difference between two angles, from -180 up to 180
 float MathAngleDifference(float a1, float a2)
 {
     float result;
 
-    result = (float)fmod(a1 - a2, 360.0f);
-    if(result > 180.0) {
-        return (result - 360.0f);
-    }
-    
-    if(result < -180.0) {
-        return (result + 360.0f);
-    }
+    result = a1 - a2;
 
-    return result;
+    return result - (360.0f * floorf((result + 180.0f) / 360.0f));
 }
 
 // Interpolate between two values
@@ -158,3 +263,91 @@ float MathScalarCurve(float val)
 
     return val;
 }
+
+static double seconds_since(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+// How far off the fast angles are, and how much faster, against the
+// library calls they stand in for. Run with --math-benchmark.
+void MathBenchmark(void)
+{
+    static float x[BENCH_COUNT];
+    static float y[BENCH_COUNT];
+    static float out[BENCH_COUNT];
+    float error;
+    float worst_angle;
+    float worst_sine;
+    float reference;
+    float sum;
+    clock_t start;
+    double slow;
+    double fast;
+    double batch;
+    int i;
+
+    MathInit();
+    for(i = 0; i < BENCH_COUNT; ++i) {
+        x[i] = (float)sin(i * 0.37) * (float)(i % 1000);
+        y[i] = (float)cos(i * 0.21) * (float)(i % 777);
+    }
+
+    worst_angle = worst_sine = 0.0f;
+    for(i = 0; i < BENCH_COUNT; ++i) {
+        // Straight on top has no angle, and this calls it 180
+        if((x[i] != 0.0f) || (y[i] != 0.0f)) {
+            reference = (float)atan2(x[i], y[i]) * RADIANS_TO_DEGREES;
+            error = fabsf(MathAngleDifference(MathAngle(x[i], y[i], 0, 0),
+                                              reference));
+
+            worst_angle = MAX(worst_angle, error);
+        }
+
+        reference = (float)sin(((i % 36000) / 100.0) * DEGREES_TO_RADIANS);
+        error = fabsf(MathSin((i % 36000) / 100.0f) - reference);
+        worst_sine = MAX(worst_sine, error);
+    }
+
+    sum = 0.0f;
+    start = clock();
+    for(i = 0; i < BENCH_COUNT; ++i) {
+        sum += atan2f(x[i], y[i]);
+    }
+
+    slow = seconds_since(start);
+    start = clock();
+    for(i = 0; i < BENCH_COUNT; ++i) {
+        sum += MathAngle(x[i], y[i], 0, 0);
+    }
+
+    fast = seconds_since(start);
+    start = clock();
+    MathAngles(x, y, 0, 0, out, BENCH_COUNT);
+    batch = seconds_since(start);
+    sum += out[BENCH_COUNT - 1];
+
+    printf("angle: worst error %g degrees\n", worst_angle);
+    printf("sine: worst error %g\n", worst_sine);
+    printf("atan2f: %.1f ns each\n", (slow * 1e9) / BENCH_COUNT);
+    printf("MathAngle: %.1f ns each\n", (fast * 1e9) / BENCH_COUNT);
+    printf("MathAngles: %.1f ns each\n", (batch * 1e9) / BENCH_COUNT);
+
+    start = clock();
+    for(i = 0; i < BENCH_COUNT; ++i) {
+        sum += sinf(x[i]);
+    }
+
+    slow = seconds_since(start);
+    start = clock();
+    for(i = 0; i < BENCH_COUNT; ++i) {
+        sum += MathSin(x[i]);
+    }
+
+    fast = seconds_since(start);
+    printf("sinf: %.1f ns each\n", (slow * 1e9) / BENCH_COUNT);
+    printf("MathSin: %.1f ns each\n", (fast * 1e9) / BENCH_COUNT);
+
+    // So none of the timed loops can be thrown away
+    printf("(%g)\n", sum);
+}
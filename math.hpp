@@ -1,8 +1,18 @@
 #ifndef MATH_HPP_
 #define MATH_HPP_
 
+void MathInit(void);
 float MathAngle(float angle);
 float MathAngle(float x1, float y1, float x2, float y2);
+void MathAngles(float const *x,
+                float const *y,
+                float to_x,
+                float to_y,
+                float *out,
+                int count);
+
+float MathSin(float angle);
+float MathCos(float angle);
 float MathAngleDifference(float a1, float a2);
 float MathAverage(float n1, float n2);
 float MathInterpolate(float n1, float n2, float delta);
@@ -17,5 +27,6 @@ float MathDistance(float x1, float y1, float x2, float y2);
 float MathDistance2(float x1, float y1, float x2, float y2);
 float MathSmoothStep(float val, float a, float b);
 float MathScalarCurve(float val);
+void MathBenchmark(void);
 
 #endif /* MATH_HPP_ */
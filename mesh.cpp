@@ -11,6 +11,10 @@
  * for ALL meshes in a common list, which could then be unloaded onto the
  * good ol' GPU
  *
+ * Meshes don't own any GL objects. They're built on the generator thread
+ * and only ever drawn while a cell's render list is being compiled, which
+ * captures the geometry anyway.
+ *
  */
 
 #include "mesh.hpp"
@@ -19,14 +23,12 @@
 
 Mesh::Mesh()
 {
-    list_ = glGenLists(1);
     compiled_ = false;
     polycount_ = 0;
 }
 
 Mesh::~Mesh()
 {
-    glDeleteLists(list_, 1);
     vertex_.clear();
     fan_.clear();
     quad_strip_.clear();
@@ -48,6 +50,16 @@ int Mesh::PolyCount()
     return polycount_;
 }
 
+// Grow box to take in every vertex
+void Mesh::Bounds(gl_bbox *box)
+{
+    std::vector<gl_vertex>::iterator v;
+
+    for(v = vertex_.begin(); v != vertex_.end(); ++v) {
+        box->contain_point(v->get_position());
+    }
+}
+
 void Mesh::CubeAdd(const cube &c)
 {
     cube_.push_back(c);
@@ -73,11 +85,6 @@ void Mesh::Render()
     std::vector<fan>::iterator fi;
     std::vector<int>::iterator n;
 
-    if(compiled_) {
-        glCallList(list_);
-        return;
-    }
-
     for(qsi = quad_strip_.begin(); qsi < quad_strip_.end(); ++qsi) {
         glBegin(GL_QUAD_STRIP);
         
@@ -128,10 +135,95 @@ void Mesh::Render()
     }
 }
 
+// Mark the mesh as finished. Nothing is sent to GL here, since this is
+// called from the generator thread.
 void Mesh::Compile()
 {
-    glNewList(list_, GL_COMPILE);
-    Render();
-    glEndList();
     compiled_ = true;
 }
+
+static void pack_vertex(std::vector<mesh_vertex> &vertices,
+                        gl_vertex const &v,
+                        gl_vector2 uv)
+{
+    mesh_vertex packed;
+    gl_vector3 position;
+
+    position = v.get_position();
+    packed.uv[0] = uv.get_x();
+    packed.uv[1] = uv.get_y();
+    packed.position[0] = position.get_x();
+    packed.position[1] = position.get_y();
+    packed.position[2] = position.get_z();
+    vertices.push_back(packed);
+}
+
+static void pack_batch(std::vector<mesh_batch> &batches,
+                       GLenum mode,
+                       GLint first,
+                       GLsizei count)
+{
+    mesh_batch b;
+
+    b.mode = mode;
+    b.first = first;
+    b.count = count;
+    batches.push_back(b);
+}
+
+// Flatten the mesh into the given arrays, producing exactly the same
+// primitives Render() would. The cube caps only set a texture coordinate on
+// their first vertex, so the rest of the cap inherits it here too.
+void Mesh::Pack(std::vector<mesh_vertex> &vertices,
+                std::vector<mesh_batch> &batches)
+{
+    std::vector<quad_strip>::iterator qsi;
+    std::vector<cube>::iterator ci;
+    std::vector<fan>::iterator fi;
+    std::vector<int>::iterator n;
+    gl_vector2 uv;
+    GLint first;
+    int i;
+    static int const cap_top[] = { 7, 5, 3, 1 };
+    static int const cap_bottom[] = { 0, 2, 4, 6 };
+
+    for(qsi = quad_strip_.begin(); qsi < quad_strip_.end(); ++qsi) {
+        first = vertices.size();
+        for(n = qsi->index_list.begin(); n < qsi->index_list.end(); ++n) {
+            pack_vertex(vertices, vertex_[*n], vertex_[*n].get_uv());
+        }
+
+        pack_batch(batches, GL_QUAD_STRIP, first, vertices.size() - first);
+    }
+
+    for(ci = cube_.begin(); ci < cube_.end(); ++ci) {
+        first = vertices.size();
+        for(n = ci->index_list.begin(); n < ci->index_list.end(); ++n) {
+            pack_vertex(vertices, vertex_[*n], vertex_[*n].get_uv());
+        }
+
+        pack_batch(batches, GL_QUAD_STRIP, first, vertices.size() - first);
+
+        first = vertices.size();
+        uv = vertex_[ci->index_list[7]].get_uv();
+        for(i = 0; i < 4; ++i) {
+            pack_vertex(vertices, vertex_[ci->index_list[cap_top[i]]], uv);
+        }
+
+        uv = vertex_[ci->index_list[6]].get_uv();
+        for(i = 0; i < 4; ++i) {
+            pack_vertex(vertices, vertex_[ci->index_list[cap_bottom[i]]], uv);
+        }
+
+        pack_batch(batches, GL_QUADS, first, vertices.size() - first);
+    }
+
+    for(fi = fan_.begin(); fi < fan_.end(); ++fi) {
+        first = vertices.size();
+        for(n = fi->index_list.begin(); n < fi->index_list.end(); ++n) {
+            pack_vertex(vertices, vertex_[*n], vertex_[*n].get_uv());
+        }
+
+        pack_batch(batches, GL_TRIANGLE_FAN, first, vertices.size() - first);
+    }
+}
@@ -1,6 +1,7 @@
 #ifndef MESH_HPP_
 #define MESH_HPP_
 
+#include "gl-bbox.hpp"
 #include "gl-vertex.hpp"
 
 #include <vector>
@@ -17,6 +18,19 @@ struct fan {
     std::vector<int> index_list;
 };
 
+// A mesh flattened into plain arrays, laid out to match GL_T2F_V3F so it
+// can be handed straight to glInterleavedArrays().
+struct mesh_vertex {
+    GLfloat uv[2];
+    GLfloat position[3];
+};
+
+struct mesh_batch {
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+};
+
 class Mesh {
 public:
     Mesh();
@@ -25,13 +39,15 @@ public:
     void VertexAdd(const gl_vertex &v);
     int VertexCount();
     int PolyCount();
+    void Bounds(gl_bbox *box);
     void CubeAdd(const cube &c);
     void QuadStripAdd(const quad_strip &qs);
     void FanAdd(const fan &f);
     void Render();
     void Compile();
+    void Pack(std::vector<mesh_vertex> &vertices,
+              std::vector<mesh_batch> &batches);
 
-    unsigned int list_;
     int polycount_;
     std::vector<gl_vertex> vertex_;
     std::vector<cube> cube_;
@@ -0,0 +1,319 @@
+/*
+ * mipmap.cpp
+ *
+ * Builds the mipmap chain for our square, power-of-two RGBA8 textures
+ * without a trip through gluBuild2DMipmaps(), which has to handle every
+ * size and format and is slow because of it. Each level is a plain 2x2 box
+ * filter of the one above. Colors can optionally be averaged as light
+ * (sRGB decoded, averaged, encoded again) so lit windows don't go dull in
+ * the distance.
+ *
+ */
+
+#include "mipmap.hpp"
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+#include <cmath>
+#include <cstddef>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "glext.hpp"
+
+#define LINEAR_STEPS 4096
+
+static float to_linear[256];
+static unsigned char to_srgb[LINEAR_STEPS];
+
+// The tables are read by every worker building textures, so they're filled
+// in once on the main thread before any of that starts
+void MipmapInit(void)
+{
+    int i;
+    float f;
+
+    for(i = 0; i < 256; ++i) {
+        f = (float)i / 255.0f;
+        if(f <= 0.04045f) {
+            to_linear[i] = f / 12.92f;
+        }
+        else {
+            to_linear[i] = powf((f + 0.055f) / 1.055f, 2.4f);
+        }
+    }
+
+    for(i = 0; i < LINEAR_STEPS; ++i) {
+        f = (float)i / (float)(LINEAR_STEPS - 1);
+        if(f <= 0.0031308f) {
+            f *= 12.92f;
+        }
+        else {
+            f = (1.055f * powf(f, 1.0f / 2.4f)) - 0.055f;
+        }
+
+        to_srgb[i] = (unsigned char)((f * 255.0f) + 0.5f);
+    }
+}
+
+// Average the colors as light. Alpha is coverage, so it stays linear.
+static void halve_srgb(unsigned char const *src, unsigned char *dst, int size)
+{
+    int x;
+    int y;
+    int i;
+    int half;
+    float sum;
+    unsigned char const *row0;
+    unsigned char const *row1;
+
+    half = size / 2;
+    for(y = 0; y < half; ++y) {
+        row0 = src + ((y * 2) * size * 4);
+        row1 = row0 + (size * 4);
+        for(x = 0; x < half; ++x) {
+            for(i = 0; i < 3; ++i) {
+                sum = to_linear[row0[i]] + to_linear[row0[i + 4]]
+                    + to_linear[row1[i]] + to_linear[row1[i + 4]];
+
+                sum *= 0.25f * (float)(LINEAR_STEPS - 1);
+                dst[i] = to_srgb[(int)(sum + 0.5f)];
+            }
+
+            dst[3] = (row0[3] + row0[7] + row1[3] + row1[7] + 2) >> 2;
+            row0 += 8;
+            row1 += 8;
+            dst += 4;
+        }
+    }
+}
+
+static void halve(unsigned char const *src, unsigned char *dst, int size)
+{
+    int x;
+    int y;
+    int i;
+    int half;
+    unsigned char const *row0;
+    unsigned char const *row1;
+
+    half = size / 2;
+    for(y = 0; y < half; ++y) {
+        row0 = src + ((y * 2) * size * 4);
+        row1 = row0 + (size * 4);
+        x = 0;
+
+#ifdef __AVX2__
+        // Eight output pixels at a time. The unpacks and packs work within
+        // each 128 bit lane, so the result needs its quarters put back in
+        // order at the end.
+        __m256i zero8 = _mm256_setzero_si256();
+        __m256i two8 = _mm256_set1_epi16(2);
+
+        for(/* empty */; (x + 8) <= half; x += 8) {
+            __m256i a0 = _mm256_loadu_si256((__m256i const *)row0);
+            __m256i a1 = _mm256_loadu_si256((__m256i const *)(row0 + 32));
+            __m256i b0 = _mm256_loadu_si256((__m256i const *)row1);
+            __m256i b1 = _mm256_loadu_si256((__m256i const *)(row1 + 32));
+            __m256i lo0 = _mm256_add_epi16(_mm256_unpacklo_epi8(a0, zero8),
+                                           _mm256_unpacklo_epi8(b0, zero8));
+            __m256i hi0 = _mm256_add_epi16(_mm256_unpackhi_epi8(a0, zero8),
+                                           _mm256_unpackhi_epi8(b0, zero8));
+            __m256i lo1 = _mm256_add_epi16(_mm256_unpacklo_epi8(a1, zero8),
+                                           _mm256_unpacklo_epi8(b1, zero8));
+            __m256i hi1 = _mm256_add_epi16(_mm256_unpackhi_epi8(a1, zero8),
+                                           _mm256_unpackhi_epi8(b1, zero8));
+
+            lo0 = _mm256_add_epi16(lo0, _mm256_srli_si256(lo0, 8));
+            hi0 = _mm256_add_epi16(hi0, _mm256_srli_si256(hi0, 8));
+            lo1 = _mm256_add_epi16(lo1, _mm256_srli_si256(lo1, 8));
+            hi1 = _mm256_add_epi16(hi1, _mm256_srli_si256(hi1, 8));
+            lo0 = _mm256_unpacklo_epi64(lo0, hi0);
+            lo1 = _mm256_unpacklo_epi64(lo1, hi1);
+            lo0 = _mm256_srli_epi16(_mm256_add_epi16(lo0, two8), 2);
+            lo1 = _mm256_srli_epi16(_mm256_add_epi16(lo1, two8), 2);
+            lo0 = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo0, lo1),
+                                           _MM_SHUFFLE(3, 1, 2, 0));
+
+            _mm256_storeu_si256((__m256i *)dst, lo0);
+            row0 += 64;
+            row1 += 64;
+            dst += 32;
+        }
+#endif
+
+#ifdef __SSE2__
+        // Four output pixels at a time. Add the two rows, then fold each
+        // pair of neighbors together.
+        __m128i zero = _mm_setzero_si128();
+        __m128i two = _mm_set1_epi16(2);
+
+        for(/* empty */; (x + 4) <= half; x += 4) {
+            __m128i a0 = _mm_loadu_si128((__m128i const *)row0);
+            __m128i a1 = _mm_loadu_si128((__m128i const *)(row0 + 16));
+            __m128i b0 = _mm_loadu_si128((__m128i const *)row1);
+            __m128i b1 = _mm_loadu_si128((__m128i const *)(row1 + 16));
+            __m128i lo0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                                        _mm_unpacklo_epi8(b0, zero));
+            __m128i hi0 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                                        _mm_unpackhi_epi8(b0, zero));
+            __m128i lo1 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                                        _mm_unpacklo_epi8(b1, zero));
+            __m128i hi1 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                                        _mm_unpackhi_epi8(b1, zero));
+
+            lo0 = _mm_add_epi16(lo0, _mm_srli_si128(lo0, 8));
+            hi0 = _mm_add_epi16(hi0, _mm_srli_si128(hi0, 8));
+            lo1 = _mm_add_epi16(lo1, _mm_srli_si128(lo1, 8));
+            hi1 = _mm_add_epi16(hi1, _mm_srli_si128(hi1, 8));
+            lo0 = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo0, hi0),
+                                               two),
+                                 2);
+
+            lo1 = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo1, hi1),
+                                               two),
+                                 2);
+
+            _mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(lo0, lo1));
+            row0 += 32;
+            row1 += 32;
+            dst += 16;
+        }
+#endif
+
+        for(/* empty */; x < half; ++x) {
+            for(i = 0; i < 4; ++i) {
+                dst[i] = (row0[i] + row0[i + 4]
+                          + row1[i] + row1[i + 4] + 2) >> 2;
+            }
+
+            row0 += 8;
+            row1 += 8;
+            dst += 4;
+        }
+    }
+}
+
+// Shrink a size x size image to half that in each direction
+void MipmapHalve(unsigned char const *src,
+                 unsigned char *dst,
+                 int size,
+                 bool srgb)
+{
+    if(srgb) {
+        halve_srgb(src, dst, size);
+    }
+    else {
+        halve(src, dst, size);
+    }
+}
+
+// A layer of -1 means a plain 2D texture, otherwise it's a slice of the
+// bound texture array, which must already have room for every level.
+static void upload_level(unsigned char const *bits,
+                         int size,
+                         int level,
+                         int layer)
+{
+    if(layer < 0) {
+        glTexImage2D(GL_TEXTURE_2D,
+                     level,
+                     GL_RGBA,
+                     size,
+                     size,
+                     0,
+                     GL_RGBA,
+                     GL_UNSIGNED_BYTE,
+                     bits);
+    }
+    else {
+        pglTexSubImage3D(GL_TEXTURE_2D_ARRAY_EXT,
+                         level,
+                         0,
+                         0,
+                         layer,
+                         size,
+                         size,
+                         1,
+                         GL_RGBA,
+                         GL_UNSIGNED_BYTE,
+                         bits);
+    }
+}
+
+// How many levels a full chain for this size has, down to 1x1
+int MipmapLevels(int size)
+{
+    int levels;
+
+    for(levels = 1; size > 1; ++levels) {
+        size /= 2;
+    }
+
+    return levels;
+}
+
+// Bytes taken by an image and the first few of its smaller versions, all
+// packed one after another.
+size_t MipmapChainSize(int size, int levels)
+{
+    size_t bytes;
+
+    bytes = 0;
+    while(levels-- > 0) {
+        bytes += (size_t)size * size * 4;
+        size /= 2;
+    }
+
+    return bytes;
+}
+
+// The chain starts out holding just the full size image. Fill in the rest
+// of the levels behind it.
+void MipmapBuild(unsigned char *chain, int size, int levels, bool srgb)
+{
+    unsigned char *dst;
+
+    while(--levels > 0) {
+        dst = chain + ((size_t)size * size * 4);
+        MipmapHalve(chain, dst, size, srgb);
+        chain = dst;
+        size /= 2;
+    }
+}
+
+static void upload_chain(unsigned char const *chain,
+                         int size,
+                         int levels,
+                         int layer)
+{
+    int level;
+
+    for(level = 0; level < levels; ++level) {
+        upload_level(chain, size, level, layer);
+        chain += (size_t)size * size * 4;
+        size /= 2;
+    }
+}
+
+// Send a finished chain to the bound texture
+void MipmapUpload(unsigned char const *chain, int size, int levels)
+{
+    upload_chain(chain, size, levels, -1);
+}
+
+// The same, into one layer of the bound texture array
+void MipmapUploadLayer(unsigned char const *chain,
+                       int size,
+                       int levels,
+                       int layer)
+{
+    upload_chain(chain, size, levels, layer);
+}
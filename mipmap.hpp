@@ -0,0 +1,21 @@
+#ifndef MIPMAP_HPP_
+#define MIPMAP_HPP_
+
+#include <cstddef>
+
+void MipmapInit(void);
+void MipmapHalve(unsigned char const *src,
+                 unsigned char *dst,
+                 int size,
+                 bool srgb);
+
+int MipmapLevels(int size);
+size_t MipmapChainSize(int size, int levels);
+void MipmapBuild(unsigned char *chain, int size, int levels, bool srgb);
+void MipmapUpload(unsigned char const *chain, int size, int levels);
+void MipmapUploadLayer(unsigned char const *chain,
+                       int size,
+                       int levels,
+                       int layer);
+
+#endif /* MIPMAP_HPP_ */
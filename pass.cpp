@@ -0,0 +1,244 @@
+/*
+ * pass.cpp
+ *
+ * The city is drawn as a list of passes, each of which says up front how
+ * it wants depth, culling, blending and texturing set. Those go through a
+ * cache here, so when a pass wants what the last one left behind, nothing
+ * gets sent to the card. We count how often that happens, which is how
+ * many calls the old way of every subsystem setting and resetting its own
+ * state was wasting.
+ *
+ * Work a pass can do without GL, like deciding which lights to draw and
+ * where, is handed to the worker threads at the start of the frame and
+ * picked up just before the pass draws.
+ *
+ */
+
+#include "pass.hpp"
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+#define CAPS 4
+#define UNKNOWN -1
+
+// Anything solid, hiding what's behind it
+pass_state const PASS_SOLID = {
+    true,
+    true,
+    true,
+    false,
+    GL_SRC_ALPHA,
+    GL_ONE_MINUS_SRC_ALPHA,
+    true
+};
+
+// Bright bits added over what's already there, without hiding anything
+pass_state const PASS_GLOW = {
+    true,
+    false,
+    false,
+    true,
+    GL_ONE,
+    GL_ONE,
+    true
+};
+
+static GLenum const caps[CAPS] = {
+    GL_DEPTH_TEST,
+    GL_CULL_FACE,
+    GL_BLEND,
+    GL_TEXTURE_2D,
+};
+
+static int enabled[CAPS];
+static int depth_mask;
+static bool blend_known;
+static GLenum blend_src;
+static GLenum blend_dst;
+static int changes;
+static int redundant;
+static int last_changes;
+static int last_redundant;
+
+static void run_prepare(void *data)
+{
+    ((render_pass *)data)->prepare();
+}
+
+static bool active(render_pass const *pass)
+{
+    return !pass->active || pass->active();
+}
+
+// Anything could have changed since the cache was last right. Call this
+// after drawing that doesn't go through here.
+void PassForget(void)
+{
+    int i;
+
+    for(i = 0; i < CAPS; ++i) {
+        enabled[i] = UNKNOWN;
+    }
+
+    depth_mask = UNKNOWN;
+    blend_known = false;
+}
+
+// Start counting for a new frame
+void PassFrame(void)
+{
+    last_changes = changes;
+    last_redundant = redundant;
+    changes = redundant = 0;
+    PassForget();
+}
+
+// State changes sent last frame, and ones that were skipped because
+// nothing would have changed
+int PassChanges(void)
+{
+    return last_changes;
+}
+
+int PassRedundant(void)
+{
+    return last_redundant;
+}
+
+void PassEnable(GLenum cap, bool on)
+{
+    int i;
+
+    for(i = 0; (i < CAPS) && (caps[i] != cap); ++i) {
+        /* empty */
+    }
+
+    if((i < CAPS) && (enabled[i] == (on ? 1 : 0))) {
+        redundant++;
+        return;
+    }
+
+    if(i < CAPS) {
+        enabled[i] = on ? 1 : 0;
+    }
+
+    if(on) {
+        glEnable(cap);
+    }
+    else {
+        glDisable(cap);
+    }
+
+    changes++;
+}
+
+void PassDepthMask(bool on)
+{
+    if(depth_mask == (on ? 1 : 0)) {
+        redundant++;
+        return;
+    }
+
+    depth_mask = on ? 1 : 0;
+    glDepthMask(on);
+    changes++;
+}
+
+void PassBlendFunc(GLenum src, GLenum dst)
+{
+    if(blend_known && (src == blend_src) && (dst == blend_dst)) {
+        redundant++;
+        return;
+    }
+
+    blend_known = true;
+    blend_src = src;
+    blend_dst = dst;
+    glBlendFunc(src, dst);
+    changes++;
+}
+
+// The blend function is set even with blending off, since the pass may
+// turn blending on for part of what it draws.
+void PassApply(pass_state const *state)
+{
+    PassEnable(GL_DEPTH_TEST, state->depth_test);
+    PassDepthMask(state->depth_mask);
+    PassEnable(GL_CULL_FACE, state->cull);
+    PassEnable(GL_BLEND, state->blend);
+    PassBlendFunc(state->blend_src, state->blend_dst);
+    PassEnable(GL_TEXTURE_2D, state->texture);
+}
+
+// Hand the GL-free part of every active pass to the workers
+void PassPrepare(render_pass *passes, int count)
+{
+    int i;
+
+    for(i = 0; i < count; ++i) {
+        if(!passes[i].prepare) {
+            continue;
+        }
+
+        // Last frame's may still be out if the pass went inactive
+        WorkerFinish(&passes[i].job);
+        if(active(&passes[i])) {
+            WorkerSubmit(&passes[i].job, run_prepare, &passes[i]);
+        }
+    }
+}
+
+// Draw the active passes in order. This can be called more than once a
+// frame, such as once per view, and they all share one prepare.
+void PassDraw(render_pass *passes, int count)
+{
+    int i;
+
+    PassForget();
+    for(i = 0; i < count; ++i) {
+        if(!active(&passes[i])) {
+            continue;
+        }
+
+        if(passes[i].prepare) {
+            WorkerFinish(&passes[i].job);
+        }
+
+        PassApply(passes[i].state);
+        passes[i].draw();
+    }
+}
+
+void PassVertex(pass_vertex *v,
+                float s,
+                float t,
+                unsigned char const *color,
+                float x,
+                float y,
+                float z)
+{
+    v->s = s;
+    v->t = t;
+    v->color[0] = color[0];
+    v->color[1] = color[1];
+    v->color[2] = color[2];
+    v->color[3] = color[3];
+    v->x = x;
+    v->y = y;
+    v->z = z;
+}
+
+// Draw a buffer filled during a prepare step
+void PassQuads(pass_vertex const *vertices, int count)
+{
+    if(!count) {
+        return;
+    }
+
+    glInterleavedArrays(GL_T2F_C4UB_V3F, 0, vertices);
+    glDrawArrays(GL_QUADS, 0, count);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
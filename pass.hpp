@@ -0,0 +1,64 @@
+#ifndef PASS_HPP_
+#define PASS_HPP_
+
+#include <SDL_opengl.h>
+
+#include "worker.hpp"
+
+// What a pass needs switched on or off before it draws
+struct pass_state {
+    bool depth_test;
+    bool depth_mask;
+    bool cull;
+    bool blend;
+    GLenum blend_src;
+    GLenum blend_dst;
+    bool texture;
+};
+
+// One step of drawing the frame. Passes that aren't active are skipped.
+// The prepare step mustn't touch GL, since it runs on a worker thread.
+// Either of those may be NULL.
+struct render_pass {
+    char const *name;
+    pass_state const *state;
+    bool (*active)(void);
+    void (*prepare)(void);
+    void (*draw)(void);
+    worker_job job;
+};
+
+// Laid out for glInterleavedArrays(GL_T2F_C4UB_V3F)
+struct pass_vertex {
+    float s;
+    float t;
+    unsigned char color[4];
+    float x;
+    float y;
+    float z;
+};
+
+extern pass_state const PASS_SOLID;
+extern pass_state const PASS_GLOW;
+
+void PassFrame(void);
+void PassForget(void);
+void PassEnable(GLenum cap, bool on);
+void PassDepthMask(bool on);
+void PassBlendFunc(GLenum src, GLenum dst);
+void PassApply(pass_state const *state);
+void PassPrepare(render_pass *passes, int count);
+void PassDraw(render_pass *passes, int count);
+void PassVertex(pass_vertex *v,
+                float s,
+                float t,
+                unsigned char const *color,
+                float x,
+                float y,
+                float z);
+
+void PassQuads(pass_vertex const *vertices, int count);
+int PassChanges(void);
+int PassRedundant(void);
+
+#endif /* PASS_HPP_ */
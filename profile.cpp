@@ -0,0 +1,211 @@
+/*
+ * profile.cpp
+ *
+ * Always-on timing for the big pieces of a frame. Every thread that runs a
+ * PROFILE() zone gets a ring of the last few thousand it finished, which
+ * only that thread ever writes, so there are no locks anywhere near the
+ * zones. Old entries just get written over.
+ *
+ * Send the program SIGUSR1 and the rings get written out on the next
+ * frame as a Chrome trace, which chrome://tracing or Perfetto will open.
+ * Set ProfileTrace to a file name to get one at exit as well. Profile=0
+ * turns the whole thing off, leaving each zone a single test of a flag.
+ *
+ */
+
+#include "profile.hpp"
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <vector>
+#include <unistd.h>
+
+#include "ini.hpp"
+#include "win.hpp"
+
+// Has to be a power of two
+#define PROFILE_EVENTS 8192
+#define MAX_PATH 256
+
+struct profile_event {
+    char const *name;
+    uint64_t start;
+    uint64_t end;
+};
+
+struct profile_thread {
+    profile_event events[PROFILE_EVENTS];
+    std::atomic<unsigned int> head;
+    char const *name;
+    int id;
+    profile_thread *next;
+};
+
+bool profile_active;
+
+static std::atomic<profile_thread *> threads;
+static std::atomic<int> thread_count;
+static thread_local profile_thread *local;
+static thread_local char const *local_name;
+static volatile sig_atomic_t dump_requested;
+static uint64_t base;
+static int dumps;
+
+static void on_signal(int unused)
+{
+    dump_requested = 1;
+}
+
+// A thread's ring is made the first time it finishes a zone, and kept
+// until we exit, since there are only ever a handful of threads
+static profile_thread *get_thread(void)
+{
+    profile_thread *t;
+
+    if(local) {
+        return local;
+    }
+
+    t = new profile_thread();
+    t->name = local_name ? local_name : "thread";
+    t->id = ++thread_count;
+    t->next = threads.load();
+    while(!threads.compare_exchange_weak(t->next, t)) {
+        /* empty */
+    }
+
+    local = t;
+
+    return t;
+}
+
+void ProfileRecord(char const *name, uint64_t start)
+{
+    profile_thread *t;
+    profile_event *e;
+    unsigned int head;
+
+    t = get_thread();
+    head = t->head.load(std::memory_order_relaxed);
+    e = &t->events[head & (PROFILE_EVENTS - 1)];
+    e->name = name;
+    e->start = start;
+    e->end = ProfileNow();
+    t->head.store(head + 1, std::memory_order_release);
+}
+
+// What to call this thread in the trace
+void ProfileThread(char const *name)
+{
+    local_name = name;
+    if(local) {
+        local->name = name;
+    }
+}
+
+// Write out everything still in the rings. Other threads keep going while
+// this runs, so anything they might have written over while we copied it
+// gets left out.
+bool ProfileDump(char const *file)
+{
+    std::vector<profile_event> events;
+    profile_thread *t;
+    FILE *f;
+    unsigned int head;
+    unsigned int first;
+    unsigned int last;
+    unsigned int i;
+    bool comma;
+
+    f = fopen(file, "w");
+    if(!f) {
+        return false;
+    }
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    comma = false;
+    for(t = threads.load(); t; t = t->next) {
+        last = t->head.load(std::memory_order_acquire);
+        first = (last > PROFILE_EVENTS) ? (last - PROFILE_EVENTS) : 0;
+        events.assign(t->events, t->events + PROFILE_EVENTS);
+        head = t->head.load(std::memory_order_acquire);
+        if((head - first) >= PROFILE_EVENTS) {
+            first = head - PROFILE_EVENTS + 1;
+        }
+
+        fprintf(f,
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+                comma ? ",\n" : "",
+                t->id,
+                t->name,
+                t->id);
+        comma = true;
+
+        for(i = first; (int)(last - i) > 0; ++i) {
+            profile_event const &e = events[i & (PROFILE_EVENTS - 1)];
+
+            if(!e.name || (e.start < base) || (e.end < e.start)) {
+                continue;
+            }
+
+            fprintf(f,
+                    ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                    "\"ts\":%.3f,\"dur\":%.3f}",
+                    e.name,
+                    t->id,
+                    (double)(e.start - base) / 1000.0,
+                    (double)(e.end - e.start) / 1000.0);
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+
+    return fclose(f) == 0;
+}
+
+// Profile is on unless the ini file says otherwise
+void ProfileInit(void)
+{
+    profile_active = !IniString("Profile")[0] || (IniInt("Profile") != 0);
+    base = ProfileNow();
+    ProfileThread("main");
+
+#if defined(SIGUSR1)
+    if(profile_active) {
+        signal(SIGUSR1, on_signal);
+    }
+#endif
+}
+
+// Once a frame, on the main thread, so the dump never happens inside the
+// signal handler
+void ProfileUpdate(void)
+{
+    char path[MAX_PATH];
+
+    if(!dump_requested) {
+        return;
+    }
+
+    dump_requested = 0;
+    snprintf(path, MAX_PATH, "%s-%d-%d.json", APP, (int)getpid(), dumps++);
+    if(ProfileDump(path)) {
+        printf("Profile written to %s\n", path);
+    }
+}
+
+void ProfileTerm(void)
+{
+    char *file;
+
+    if(!profile_active) {
+        return;
+    }
+
+    file = IniString("ProfileTrace");
+    if(file[0]) {
+        ProfileDump(file);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef PROFILE_HPP_
+#define PROFILE_HPP_
+
+#include <chrono>
+#include <cstdint>
+
+// Time a block of code: PROFILE("name") at the top of it. The name has to
+// be a string that lives forever, since only the pointer is kept.
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE(name) profile_zone PROFILE_JOIN(profile_zone_, __LINE__)(name)
+
+// Read straight from the zones so that with profiling off, a zone costs a
+// load and a branch and nothing else
+extern bool profile_active;
+
+inline uint64_t ProfileNow(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ProfileRecord(char const *name, uint64_t start);
+
+class profile_zone {
+public:
+    explicit profile_zone(char const *name)
+        : name_(profile_active ? name : NULL),
+          start_(profile_active ? ProfileNow() : 0)
+    {
+    }
+
+    ~profile_zone()
+    {
+        if(name_) {
+            ProfileRecord(name_, start_);
+        }
+    }
+
+    profile_zone(profile_zone const &) = delete;
+    profile_zone &operator=(profile_zone const &) = delete;
+
+private:
+    char const *name_;
+    uint64_t start_;
+};
+
+void ProfileInit(void);
+void ProfileThread(char const *name);
+void ProfileUpdate(void);
+bool ProfileDump(char const *file);
+void ProfileTerm(void);
+
+#endif /* PROFILE_HPP_ */
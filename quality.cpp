@@ -0,0 +1,206 @@
+/*
+ * quality.cpp
+ *
+ * The knobs that decide how much city there is to draw: how many cars, how
+ * far out we draw, how wide the sparse band around the edge is, how many
+ * skyscrapers go in the middle, and how long a run of sidewalk has to be
+ * to get streetlights. These come in presets, picked with Quality=low,
+ * medium, high or ultra in the ini file. High is how the city has always
+ * looked. Any knob can be set on its own as well (Cars, DrawDistance,
+ * WorldEdge, Skyscrapers, SkyscraperAttempts, LightStripMin), which wins
+ * over the preset.
+ *
+ * The benchmark flies each preset in turn and reports frame times next to
+ * how much was on screen, so it's easy to see where a machine falls over.
+ *
+ */
+
+#include "quality.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+#include <vector>
+
+#include "camera.hpp"
+#include "car.hpp"
+#include "entity.hpp"
+#include "ini.hpp"
+#include "light.hpp"
+#include "macro.hpp"
+#include "win.hpp"
+#include "world.hpp"
+
+// Past this the edge band swallows the streets that mark out the middle
+#define MAX_WORLD_EDGE ((WORLD_HALF / 2) - 16)
+#define BENCHMARK_WARMUP 120 // frames
+#define BENCHMARK_FRAMES 600
+
+static quality const presets[QUALITY_COUNT] = {
+    { "low", 100, 256.0f, 240, 15, 100, 30 },
+    { "medium", 250, 384.0f, 220, 30, 200, 20 },
+    { "high", 500, WORLD_HALF, 200, 50, 350, 10 },
+    { "ultra", 1000, 768.0f, 120, 80, 600, 6 },
+};
+
+static quality current;
+static int preset = QUALITY_HIGH;
+static unsigned int serial;
+static unsigned int ini_serial;
+
+// A knob set in the ini file beats the preset. Zero means not set.
+static void knob(int *value, char const *entry)
+{
+    int i;
+
+    i = IniInt(entry);
+    if(i > 0) {
+        *value = i;
+    }
+}
+
+static void knob(float *value, char const *entry)
+{
+    float f;
+
+    f = IniFloat(entry);
+    if(f > 0.0f) {
+        *value = f;
+    }
+}
+
+static void apply(void)
+{
+    quality old;
+
+    old = current;
+    current = presets[preset];
+    knob(&current.cars, "Cars");
+    knob(&current.draw_distance, "DrawDistance");
+    knob(&current.world_edge, "WorldEdge");
+    knob(&current.skyscrapers, "Skyscrapers");
+    knob(&current.skyscraper_attempts, "SkyscraperAttempts");
+    knob(&current.light_strip_min, "LightStripMin");
+    current.world_edge = MIN(current.world_edge, MAX_WORLD_EDGE);
+    ini_serial = IniSerial();
+
+    CarPopulate(current.cars);
+    if(memcmp(&old, &current, sizeof(current))) {
+        serial++;
+    }
+}
+
+static void load(void)
+{
+    char *name;
+    int i;
+
+    name = IniString("Quality");
+    preset = QUALITY_HIGH;
+    for(i = 0; i < QUALITY_COUNT; ++i) {
+        if(!strcasecmp(name, presets[i].name)) {
+            preset = i;
+        }
+    }
+
+    apply();
+}
+
+void QualityInit(void)
+{
+    load();
+}
+
+// Pick up changes to the ini file
+void QualityUpdate(void)
+{
+    if(ini_serial != IniSerial()) {
+        load();
+    }
+}
+
+// Switch presets for this run only. The ini file is left alone.
+void QualitySet(int p)
+{
+    preset = CLAMP(p, 0, QUALITY_COUNT - 1);
+    apply();
+}
+
+quality const *QualityGet(void)
+{
+    return &current;
+}
+
+// Goes up whenever any of the knobs change
+unsigned int QualitySerial(void)
+{
+    return serial;
+}
+
+// Build a city at each preset, let it settle, then time a run of frames.
+// The camera keeps flying the whole time, so set CameraReplay to fly the
+// same track for every preset: it starts over from the top once the city
+// has settled, and a track that runs out just holds its last view rather
+// than ending the run. Frames are timed on the wall clock around the
+// whole update, so with vsync on nothing will come in under a refresh.
+void QualityBenchmark(void)
+{
+    std::vector<float> times;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::duration<float, std::milli> elapsed;
+    float total;
+    int p;
+    int i;
+
+    printf("%-8s %6s %8s %7s %9s %8s %8s %8s\n",
+           "quality",
+           "cars",
+           "entities",
+           "lights",
+           "polys",
+           "mean ms",
+           "p95 ms",
+           "worst ms");
+
+    camera_replay_rewind(true);
+    for(p = 0; p < QUALITY_COUNT; ++p) {
+        QualitySet(p);
+        WorldReset();
+        do {
+            AppUpdate();
+        } while(!WorldSettled());
+
+        camera_replay_rewind(true);
+
+        for(i = 0; i < BENCHMARK_WARMUP; ++i) {
+            AppUpdate();
+        }
+
+        times.clear();
+        total = 0.0f;
+        for(i = 0; i < BENCHMARK_FRAMES; ++i) {
+            start = std::chrono::steady_clock::now();
+            AppUpdate();
+            elapsed = std::chrono::steady_clock::now() - start;
+            times.push_back(elapsed.count());
+            total += elapsed.count();
+        }
+
+        std::sort(times.begin(), times.end());
+        printf("%-8s %6d %8d %7d %9d %8.2f %8.2f %8.2f\n",
+               presets[p].name,
+               CarCount(),
+               EntityCount(),
+               LightCount(),
+               EntityPolyCount() + LightCount() + CarCount(),
+               total / BENCHMARK_FRAMES,
+               times[(BENCHMARK_FRAMES * 95) / 100],
+               times.back());
+        fflush(stdout);
+    }
+
+    camera_replay_rewind(false);
+    load();
+}
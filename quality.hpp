@@ -0,0 +1,31 @@
+#ifndef QUALITY_HPP_
+#define QUALITY_HPP_
+
+enum {
+    QUALITY_LOW,
+    QUALITY_MEDIUM,
+    QUALITY_HIGH,
+    QUALITY_ULTRA,
+    QUALITY_COUNT
+};
+
+// How busy the city is. Cars and draw distance change right away; the rest
+// shape the city, so they wait for the next one to be built.
+struct quality {
+    char const *name;
+    int cars;
+    float draw_distance;
+    int world_edge;
+    int skyscrapers;
+    int skyscraper_attempts;
+    int light_strip_min;
+};
+
+void QualityInit(void);
+void QualityUpdate(void);
+void QualitySet(int preset);
+quality const *QualityGet(void);
+unsigned int QualitySerial(void);
+void QualityBenchmark(void);
+
+#endif /* QUALITY_HPP_ */
@@ -5,11 +5,17 @@
  * digits; the 32-bit random numbers exhibit best possible equidistribution
  * properties in dimensions up to 623; and it's fast, very fast.
  *
+ * The state is regenerated a whole block at a time, and the loops below are
+ * written without branches or carried dependencies so the compiler can turn
+ * them into SIMD code. The bulk functions hand out runs of the tempered block
+ * directly instead of paying for a function call per number.
+ *
  */
 
 #include "random.hpp"
 
-#include <memory>
+#include <stdint.h>
+#include <cstring>
 
 #define LOWER_MASK 0x7FFFFFFF
 #define M 397
@@ -22,38 +28,78 @@
 #define TEMPERING_SHIFT_T(y) ((y) << 15)
 #define TEMPERING_SHIFT_U(y) ((y) >> 11)
 #define UPPER_MASK 0x80000000
+#define TWIST(u, v, m) \
+    ((m) ^ ((((u) & UPPER_MASK) | ((v) & LOWER_MASK)) >> 1) \
+     ^ ((0U - ((v) & 0x1)) & MATRIX_A))
+#define FLOAT_SCALE (1.0f / 16777216.0f)
 
-static int k = 1;
-static unsigned long mag01[2] = { 0x0, MATRIX_A };
-static unsigned long ptgfsr[N];
+// Each thread gets its own generator, so the city being built in the
+// background doesn't disturb (or get disturbed by) the one on screen.
+static thread_local int k = 1;
+static thread_local uint32_t ptgfsr[N];
 
-unsigned long RandomVal(void)
+// Rebuild the whole state block. Each of the three loops only reads words
+// that are at least M ahead of (or already finished behind) the one being
+// written, so there is no dependency between iterations.
+static void regenerate(void)
 {
     int kk;
-    unsigned long y;
 
-    if(k == N) {
-        for(kk = 0; kk < (N - M); ++kk) {
-            y = (ptgfsr[kk] & UPPER_MASK) | (ptgfsr[kk + 1] & LOWER_MASK);
-            ptgfsr[kk] = (ptgfsr[kk + M] ^ (y >> 1)) ^ mag01[y & 0x1];
-        }
+    for(kk = 0; kk < (N - M); ++kk) {
+        ptgfsr[kk] = TWIST(ptgfsr[kk], ptgfsr[kk + 1], ptgfsr[kk + M]);
+    }
 
-        for(/* empty */; kk < (N - 1); ++k) {
-            y = (ptgfsr[kk] & UPPER_MASK) | (ptgfsr[kk + 1] & LOWER_MASK);
-            ptgfsr[kk] = (ptgfsr[kk + (M - N)] ^ (y >> 1)) ^ mag01[y & 0x1];
-        }
-        
-        y = (ptgfsr[N - 1] & UPPER_MASK) | (ptgfsr[0] & LOWER_MASK);
-        ptgfsr[N - 1] = (ptgfsr[M - 1] ^ (y >> 1)) ^ mag01[y & 0x1];
-        k = 0;
+    for(/* empty */; kk < (N - 1); ++kk) {
+        ptgfsr[kk] = TWIST(ptgfsr[kk], ptgfsr[kk + 1], ptgfsr[kk + (M - N)]);
     }
 
-    y = ptgfsr[k++];
+    ptgfsr[N - 1] = TWIST(ptgfsr[N - 1], ptgfsr[0], ptgfsr[M - 1]);
+    k = 0;
+}
+
+static inline uint32_t temper(uint32_t y)
+{
     y ^= (TEMPERING_SHIFT_U(y));
     y ^= (TEMPERING_SHIFT_S(y) & TEMPERING_MASK_B);
     y ^= (TEMPERING_SHIFT_T(y) & TEMPERING_MASK_C);
-    
-    return (y ^= TEMPERING_SHIFT_L(y));
+
+    return (y ^ TEMPERING_SHIFT_L(y));
+}
+
+// Hand out up to count tempered words from the current block. Returns how
+// many were written, which is never zero.
+static int take(uint32_t *values, int count)
+{
+    int i;
+    int run;
+    uint32_t const *src;
+
+    if(k == N) {
+        regenerate();
+    }
+
+    run = N - k;
+    if(run > count) {
+        run = count;
+    }
+
+    src = ptgfsr + k;
+    for(i = 0; i < run; ++i) {
+        values[i] = temper(src[i]);
+    }
+
+    k += run;
+
+    return run;
+}
+
+unsigned long RandomVal(void)
+{
+    if(k == N) {
+        regenerate();
+    }
+
+    return temper(ptgfsr[k++]);
 }
 
 unsigned long RandomVal(int range)
@@ -61,14 +107,64 @@ unsigned long RandomVal(int range)
     return (range ? (RandomVal() % range) : 0);
 }
 
-void RandomInit(unsigned long seed)
+// Fill an array with raw 32-bit values. The sequence is identical to calling
+// RandomVal() count times.
+void RandomFill(unsigned int *values, int count)
 {
-    // int k;
+    int done;
 
-    // meset(ptgfsr, 0, sizeof(ptgfsr));
-    // mag01[0] = 0x0;
-    // mag01[1] = MATRIX_A;
-    ptgfsr[0] = seed;
+    while(count > 0) {
+        done = take((uint32_t *)values, count);
+        values += done;
+        count -= done;
+    }
+}
+
+// Fill an array with values in [0, range). The sequence is identical to
+// calling RandomVal(range) count times.
+void RandomFill(int *values, int count, int range)
+{
+    int i;
+    unsigned int *raw;
+
+    raw = (unsigned int *)values;
+    RandomFill(raw, count);
+
+    if(!range) {
+        for(i = 0; i < count; ++i) {
+            values[i] = 0;
+        }
+
+        return;
+    }
+
+    for(i = 0; i < count; ++i) {
+        values[i] = (int)(raw[i] % (unsigned int)range);
+    }
+}
+
+// Fill an array with floats in [0, 1). Only the top 24 bits are used, since
+// that's all a float can hold.
+void RandomFill(float *values, int count)
+{
+    int i;
+    int done;
+    uint32_t raw[N];
+
+    while(count > 0) {
+        done = take(raw, count);
+        for(i = 0; i < done; ++i) {
+            values[i] = (float)(raw[i] >> 8) * FLOAT_SCALE;
+        }
+
+        values += done;
+        count -= done;
+    }
+}
+
+void RandomInit(unsigned long seed)
+{
+    ptgfsr[0] = (uint32_t)seed;
 
     for(k = 1; k < N; ++k) {
         ptgfsr[k] = 69069 * ptgfsr[k - 1];
@@ -76,3 +172,23 @@ void RandomInit(unsigned long seed)
 
     k = 1;
 }
+
+// The generator state can be saved and restored so that a city loaded from
+// disk leaves the sequence exactly where generating it would have.
+int RandomStateSize(void)
+{
+    return sizeof(ptgfsr) + sizeof(int);
+}
+
+void RandomStateGet(void *state)
+{
+    memcpy(state, ptgfsr, sizeof(ptgfsr));
+    memcpy((char *)state + sizeof(ptgfsr), &k, sizeof(int));
+}
+
+void RandomStateSet(void const *state)
+{
+    memcpy(ptgfsr, state, sizeof(ptgfsr));
+    memcpy(&k, (char const *)state + sizeof(ptgfsr), sizeof(int));
+    k = (k < 0 || k > N) ? N : k;
+}
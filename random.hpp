@@ -5,6 +5,12 @@
 
 unsigned long RandomVal(int range);
 unsigned long RandomVal(void);
+void RandomFill(unsigned int *values, int count);
+void RandomFill(int *values, int count, int range);
+void RandomFill(float *values, int count);
 void RandomInit(unsigned long seed);
+int RandomStateSize(void);
+void RandomStateGet(void *state);
+void RandomStateSet(void const *state);
 
 #endif /* RANDOM_HPP_ */
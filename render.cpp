@@ -18,19 +18,27 @@
 #include <cstdlib>
 #include <ctime>
 
+#include "bloom.hpp"
+#include "frame.hpp"
+#include "pass.hpp"
 #include "camera.hpp"
 #include "car.hpp"
 #include "entity.hpp"
+#include "font.hpp"
+#include "glext.hpp"
 #include "ini.hpp"
 #include "light.hpp"
 #include "macro.hpp"
 #include "math.hpp"
+#include "profile.hpp"
+#include "quality.hpp"
 #include "sky.hpp"
 #include "texture.hpp"
 #include "win.hpp"
 #include "world.hpp"
 
 #define RENDER_DISTANCE 1280
+#define NEAR_CLIP 0.1f
 #define MAX_TEXT 256
 #define YOUFAIL(message) {WinPopup(message); \
         return; }
@@ -39,6 +47,7 @@
 #define COLOR_CYCLE_TIME 10000 // Milliseconds
 #define COLOR_CYCLE (COLOR_CYCLE_TIME / 4)
 #define FONT_SIZE (LOGO_PIXELS - (LOGO_PIXELS / 8))
+#define TEXT_SIZE 16
 #define BLOOM_SCALING 0.07f
 
 static char help[] = "ESC - Exit!\n"
@@ -51,11 +60,6 @@ static char help[] = "ESC - Exit!\n"
     "T   - Toggle Textures\n"
     "G   - Toggle Fog\n";
 
-struct glFont {
-    char *name;
-    unsigned int base_char;
-};
-
 enum {
     EFFECT_NONE,
     EFFECT_BLOOM,
@@ -68,7 +72,6 @@ enum {
 };
 
 static float render_aspect;
-static float fog_distance;
 static int render_width;
 static int render_height;
 static bool letterbox;
@@ -81,6 +84,14 @@ static bool flat;
 static bool show_fps;
 static bool show_fog;
 static bool show_help;
+static bool bloom_from_frame;
+static float frustum_right;
+static float frustum_top;
+static int view_columns;
+static int view_rows;
+static int view_bezel;
+static bool frame_bloom;
+static unsigned int settings_serial;
 
 // Draw a clock-ish progress...widget...thing. It's cute.
 static void do_progress(float center_x,
@@ -289,6 +300,25 @@ static void do_effects(int type)
 
         break;
     case EFFECT_BLOOM:
+        // The glow was already blurred offscreen, so it goes on in one pass
+        if(BloomActive()) {
+            glEnable(GL_BLEND);
+            glBindTexture(GL_TEXTURE_2D, BloomTexture());
+            glBegin(GL_QUADS);
+            color = WorldBloomColor();
+            glColor3fv(color.get_data());
+            glTexCoord2f(0, 0);
+            glVertex2i(0, render_height);
+            glTexCoord2f(0, 1);
+            glVertex2i(0, 0);
+            glTexCoord2f(1, 1);
+            glVertex2i(render_width, 0);
+            glTexCoord2f(1, 0);
+            glVertex2i(render_width, render_height);
+            glEnd();
+            break;
+        }
+
         // Simple bloom effect
         glBegin(GL_QUADS);
 
@@ -414,38 +444,7 @@ void RenderPrint(int x, int y, int font, gl_rgba color, const char *fmt, ...)
     vsprintf(text, fmt, ap);
     va_end(ap);
 
-    char curier_new[] = { 'C', 'o', 'u', 'r', 'i', 'e', 'r', ' ', 'N', 'e', 'w', '\0' };
-    char arial[] = { 'A', 'r', 'i', 'a', 'l', '\0' };
-    char times_new_roman[] = 
-        { 'T', 'i', 'm', 'e', 's', ' ', 'N', 'e', 'w', ' ', 'R', 'o', 'm', 'a', 'n', '\0' };
-
-    char arial_black[] = { 'A', 'r', 'i', 'a', 'l', ' ', 'B', 'l', 'a', 'c', 'k', '\0' };
-    char impact[] = { 'I', 'm', 'p', 'a', 'c', 't' };
-    char agency_fb[] = { 'A', 'g', 'e', 'n', 'c', 'y', ' ', 'F', 'B', '\0' };
-    char book_antiqua[] = { 'B', 'o', 'o', 'k', ' ', 'A', 'n', 't', 'i', 'q', 'u', 'a', '\0' };
-
-    glFont fonts[] = {
-        {curier_new, 0},
-        {arial, 0},
-        {times_new_roman, 0},
-        {arial_black, 0},
-        {impact, 0},
-        {agency_fb, 0},
-        {book_antiqua, 0},
-    };
-
-    glPushAttrib(GL_LIST_BIT);
-    glListBase(fonts[font % (sizeof(fonts) / sizeof(struct glFont))].base_char - 32);
-    glColor3fv(color.get_data());
-    glRasterPos2i(x, y);
-    glCallLists(strlen(text), GL_UNSIGNED_BYTE, text);
-    glPopAttrib();
-
-    /* FIXME */
-    // char *ptr = text;
-    // while(*ptr) {
-    //     glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *ptr++);
-    // }
+    FontPrint(x, y, TEXT_SIZE, font, color, text);
 }
 
 void RenderPrint(int line, const char *fmt, ...)
@@ -463,27 +462,10 @@ void RenderPrint(int line, const char *fmt, ...)
     vsprintf(text, fmt, ap);
     va_end(ap);
 
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    glOrtho(0, render_width, render_height, 0, 0.1f, 2048);
-    glDisable(GL_DEPTH_TEST);
-    glDepthMask(false);
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-    glTranslatef(0, 0, -1.0f);
-    glDisable(GL_BLEND);
-    glDisable(GL_FOG);
-    glDisable(GL_TEXTURE_2D);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    RenderPrint(0, (line * FONT_SIZE) - 2, 0, gl_rgba(0.0f), text);
-    RenderPrint(4, (line * FONT_SIZE) + 2, 0, gl_rgba(0.0f), text);
-    RenderPrint(2, line * FONT_SIZE, 0, gl_rgba(1.0f), text);
-    glPopMatrix();
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
+    // A drop shadow on either side keeps it readable over anything
+    FontPrint(0, (line * FONT_SIZE) - 2, TEXT_SIZE, 0, gl_rgba(0.0f), text);
+    FontPrint(4, (line * FONT_SIZE) + 2, TEXT_SIZE, 0, gl_rgba(0.0f), text);
+    FontPrint(2, line * FONT_SIZE, TEXT_SIZE, 0, gl_rgba(1.0f), text);
 }
 
 void static do_help(void)
@@ -509,6 +491,49 @@ void do_fps()
     frames = 0;
 }
 
+// Load the part of the camera's frustum between the given fractions of
+// the way across and up the screen
+static void do_projection(float left, float bottom, float right, float top)
+{
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glFrustum(frustum_right * ((left * 2.0f) - 1.0f),
+              frustum_right * ((right * 2.0f) - 1.0f),
+              frustum_top * ((bottom * 2.0f) - 1.0f),
+              frustum_top * ((top * 2.0f) - 1.0f),
+              NEAR_CLIP,
+              RENDER_DISTANCE);
+
+    glMatrixMode(GL_MODELVIEW);
+}
+
+// Each panel of a video wall gets its own slice of the one camera. The
+// bezels between them hide a strip of the city like a window frame would,
+// so the buildings still line up from one panel to the next.
+static void do_view(int column, int row, float scale)
+{
+    int x;
+    int y;
+    int width;
+    int height;
+
+    width = (render_width - (view_bezel * (view_columns - 1))) / view_columns;
+    height = (render_height - (view_bezel * (view_rows - 1))) / view_rows;
+    width = MAX(width, 1);
+    height = MAX(height, 1);
+    x = column * (width + view_bezel);
+    y = row * (height + view_bezel);
+    glViewport((int)(x * scale),
+               (int)((letterbox_offset + y) * scale),
+               (int)(width * scale),
+               (int)(height * scale));
+
+    do_projection((float)x / render_width,
+                  (float)y / render_height,
+                  (float)(x + width) / render_width,
+                  (float)(y + height) / render_height);
+}
+
 void RenderResize(void)
 {
     float fovy = 60.0f;
@@ -528,34 +553,56 @@ void RenderResize(void)
         fovy /= render_aspect;
     }
 
+    // The same frustum gluPerspective() would give
+    frustum_top = NEAR_CLIP * tanf(fovy * 0.5f * DEGREES_TO_RADIANS);
+    frustum_right = frustum_top * render_aspect;
     glViewport(0, letterbox_offset, render_width, render_height);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(fovy, render_aspect, 0.1f, RENDER_DISTANCE);
-    glMatrixMode(GL_MODELVIEW);
+    do_projection(0.0f, 0.0f, 1.0f, 1.0f);
+}
+
+// Read again whenever the ini file changes, so these can be tuned while
+// the city is up
+static void load_settings(void)
+{
+    letterbox = (IniInt("Letterbox") != 0);
+    show_wireframe = (IniInt("Wireframe") != 0);
+    show_fps = (IniInt("ShowFPS") != 0);
+    show_fog = (IniInt("ShowFog") != 0);
+    effect = IniInt("Effect");
+    flat = (IniInt("Flat") != 0);
+    bloom_from_frame = (IniInt("BloomFromFrame") != 0);
+    view_columns = MAX(IniInt("ViewColumns"), 1);
+    view_rows = MAX(IniInt("ViewRows"), 1);
+    view_bezel = MAX(IniInt("ViewBezel"), 0);
+
+    settings_serial = IniSerial();
 }
 
 void RenderTerm(void)
 {
+    FrameTerm();
+    BloomTerm();
+    FontTerm();
 }
 
 void RenderInit(void)
 {
+    GlextInit();
+    FontInit();
+    BloomInit();
+
     // If the program is running for the first time, set the defaults.
     if(!IniInt("SetDefaults")) {
         IniIntSet("SetDefaults", 1);
         IniIntSet("Effect", EFFECT_BLOOM);
         IniIntSet("ShowFog", 1);
+        IniIntSet("CompressTextures", 1);
+        IniIntSet("BloomFromFrame", 1);
+        IniIntSet("DynamicResolution", 1);
     }
 
-    // Load in our settings
-    letterbox = (IniInt("Letterbox") != 0);
-    show_wireframe = (IniInt("Wireframe") != 0);
-    show_fps = (IniInt("ShowFPS") != 0);
-    show_fog = (IniInt("ShowFog") != 0);
-    effect = IniInt("Effect");
-    flat = (IniInt("Flat") != 0);
-    fog_distance = WORLD_HALF;
+    FrameInit();
+    load_settings();
 
     // Clear the viewport so the user isn't looking at trash
     // while the program starts
@@ -610,6 +657,12 @@ void RenderEffectCycle()
 
 bool RenderBloom()
 {
+    // The plain glow can come from the frame itself, so the city doesn't
+    // need drawing a second time for it.
+    if((effect == EFFECT_BLOOM) && frame_bloom) {
+        return false;
+    }
+
     return ((effect == EFFECT_BLOOM)
             || (effect == EFFECT_BLOOM_RADIAL)
             || (effect == EFFECT_DEBUG_OVERBLOOM)
@@ -632,9 +685,11 @@ void RenderHelpToggle()
     show_help = !show_help;
 }
 
+// How far out anything gets drawn. Cars and lights past it are skipped,
+// and the fog closes in to hide the edge.
 float RenderFogDistance()
 {
-    return fog_distance;
+    return QualityGet()->draw_distance;
 }
 
 // This is used to set a gradient fog that goes from camera to some portion
@@ -648,49 +703,155 @@ void RenderFogFX(float scalar)
     }
 
     glFogf(GL_FOG_START, 0.0f);
-    glFogf(GL_FOG_END, (fog_distance * 2.0f) * scalar);
+    glFogf(GL_FOG_END, (RenderFogDistance() * 2.0f) * scalar);
     glEnable(GL_FOG);
 }
 
-void RenderUpdate(void)
+static bool solid_city(void)
 {
-    gl_vector3 pos;
-    gl_vector3 angle;
-    gl_rgba color;
-    int elapsed;
+    return (effect != EFFECT_GLASS_CITY);
+}
 
-    frames++;
-    do_fps();
-    
-    glViewport(0, 0, WinWidth(), WinHeight());
-    glDepthMask(true);
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+static bool glass_city(void)
+{
+    return (effect == EFFECT_GLASS_CITY);
+}
 
-    if(letterbox) {
-        glViewport(0, letterbox_offset, render_width, render_height);
+// The wireframe fading out as the city is revealed, when there's no
+// loading screen to hide the building
+static bool fading(void)
+{
+    int elapsed;
+
+    if(LOADING_SCREEN) {
+        return false;
     }
 
-    if(LOADING_SCREEN && TextureReady() && !EntityReady()) {
-        do_effects(EFFECT_NONE);
-        SDL_GL_SwapBuffers();
+    elapsed = 3000 - WorldSceneElapsed();
 
-        return;
+    return ((elapsed >= 0) && (elapsed <= 3000));
+}
+
+static void draw_sky(void)
+{
+    glDisable(GL_FOG);
+    SkyRender();
+}
+
+static void draw_world(void)
+{
+    gl_rgba color;
+
+    if(show_fog) {
+        glEnable(GL_FOG);
+        glFogf(GL_FOG_START, RenderFogDistance() - 100);
+        glFogf(GL_FOG_END, RenderFogDistance());
+        color = gl_rgba(0.0f);
+        glFogfv(GL_FOG_COLOR, color.get_data());
     }
 
+    WorldRender();
+}
+
+static void draw_glass(void)
+{
+    gl_vector3 pos;
+
+    pos = camera_position();
+    glMatrixMode(GL_TEXTURE);
+    glTranslatef((pos.get_x() + pos.get_z()) / SEGMENTS_PER_TEXTURE, 0, 0);
+    glMatrixMode(GL_MODELVIEW);
+    EntityRender();
+}
+
+static void draw_fade(void)
+{
+    RenderFogFX((float)(3000 - WorldSceneElapsed()) / 3000.0f);
+    EntityRender();
+}
+
+static void draw_wireframe(void)
+{
+    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    EntityRender();
+}
+
+static pass_state const sky_state = {
+    true,
+    false,
+    false,
+    true,
+    GL_SRC_ALPHA,
+    GL_ONE_MINUS_SRC_ALPHA,
+    true
+};
+
+static pass_state const ground_state = {
+    true,
+    false,
+    false,
+    false,
+    GL_SRC_ALPHA,
+    GL_ONE_MINUS_SRC_ALPHA,
+    true
+};
+
+static pass_state const glass_state = {
+    false,
+    true,
+    false,
+    true,
+    GL_ONE,
+    GL_ONE,
+    true
+};
+
+static pass_state const fade_state = {
+    true,
+    true,
+    true,
+    true,
+    GL_ONE,
+    GL_ONE,
+    false
+};
+
+static pass_state const wireframe_state = {
+    true,
+    true,
+    false,
+    true,
+    GL_ONE,
+    GL_ONE,
+    false
+};
+
+// Everything in the whole entire world, in the order it gets drawn
+static render_pass scene_passes[] = {
+    { "sky", &sky_state, NULL, NULL, draw_sky },
+    { "ground", &ground_state, NULL, NULL, draw_world },
+    { "buildings", &PASS_SOLID, solid_city, NULL, EntityRender },
+    { "glass", &glass_state, glass_city, NULL, draw_glass },
+    { "fade", &fade_state, fading, NULL, draw_fade },
+    { "lights", &PASS_GLOW, EntityReady, LightPrepare, LightRender },
+    { "cars", &PASS_GLOW, NULL, CarPrepare, CarRender },
+    { "wireframe", &wireframe_state, RenderWireframe, NULL, draw_wireframe },
+};
+
+// Draw the whole city from the camera, into whatever the viewport is
+static void do_scene(void)
+{
+    gl_vector3 pos;
+    gl_vector3 angle;
+
     glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
     glShadeModel(GL_SMOOTH);
     glFogi(GL_FOG_MODE, GL_LINEAR);
     glDepthFunc(GL_LEQUAL);
-    glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glMatrixMode(GL_TEXTURE);
     glLoadIdentity();
     glMatrixMode(GL_MODELVIEW);
-    glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
     glLoadIdentity();
     glLineWidth(1.0f);
     pos = camera_position();
@@ -699,61 +860,84 @@ void RenderUpdate(void)
     glRotatef(angle.get_y(), 0.0f, 1.0f, 0.0f);
     glRotatef(angle.get_z(), 0.0f, 0.0f, 1.0f);
     glTranslatef(-pos.get_x(), -pos.get_y(), -pos.get_z());
-    glEnable(GL_TEXTURE_2D);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    PassDraw(scene_passes, sizeof(scene_passes) / sizeof(render_pass));
+}
 
-    // Render all the stuff in the whole entire world.
-    glDisable(GL_FOG);
-    SkyRender();
-    if(show_fog) {
-        glEnable(GL_FOG);
-        glFogf(GL_FOG_START, fog_distance - 100);
-        glFogf(GL_FOG_END, fog_distance);
-        color = gl_rgba(0.0f);
-        glFogfv(GL_FOG_COLOR, color.get_data());
+void RenderUpdate(void)
+{
+    PROFILE("RenderUpdate");
+    bool offscreen;
+    float scale;
+    int row;
+    int column;
+
+    frames++;
+    do_fps();
+    PassFrame();
+    if(settings_serial != IniSerial()) {
+        load_settings();
+        RenderResize();
     }
     
-    WorldRender();
-    
-    if(effect == EFFECT_GLASS_CITY) {
-        glDisable(GL_CULL_FACE);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_ONE, GL_ONE);
-        glDepthFunc(false);
-        glDisable(GL_DEPTH_TEST);
-        glMatrixMode(GL_TEXTURE);
-        glTranslatef((pos.get_x() + pos.get_z()) / SEGMENTS_PER_TEXTURE, 0, 0);
-        glMatrixMode(GL_MODELVIEW);
+    glViewport(0, 0, WinWidth(), WinHeight());
+    glDepthMask(true);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glEnable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if(letterbox) {
+        glViewport(0, letterbox_offset, render_width, render_height);
     }
-    else {
-        glEnable(GL_CULL_FACE);
-        glDisable(GL_BLEND);
+
+    if(LOADING_SCREEN && TextureReady() && !EntityReady()) {
+        do_effects(EFFECT_NONE);
+        FontFlush(render_width, render_height);
+        SDL_GL_SwapBuffers();
+
+        return;
     }
-    
-    EntityRender();
-    
-    if(!LOADING_SCREEN) {
-        elapsed = 3000 - WorldSceneElapsed();
 
-        if((elapsed >= 0) && (elapsed <= 3000)) {
-            RenderFogFX((float)elapsed / 3000.0f);
-            glDisable(GL_TEXTURE_2D);
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_ONE, GL_ONE);
-            EntityRender();
+    // The city goes offscreen if the glow is made from it, or if it might
+    // be drawn smaller than the screen.
+    frame_bloom = bloom_from_frame
+        && (effect == EFFECT_BLOOM)
+        && BloomActive();
+
+    offscreen = (frame_bloom || FrameScaling())
+        && FrameBegin(WinWidth(), WinHeight());
+
+    frame_bloom = frame_bloom && offscreen;
+    scale = 1.0f;
+    if(offscreen) {
+        scale = FrameScale();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // Work out what can be before the first view needs it
+    PassPrepare(scene_passes, sizeof(scene_passes) / sizeof(render_pass));
+    for(row = 0; row < view_rows; ++row) {
+        for(column = 0; column < view_columns; ++column) {
+            do_view(column, row, scale);
+            do_scene();
         }
     }
 
-    if(EntityReady()) {
-        LightRender();
+    do_projection(0.0f, 0.0f, 1.0f, 1.0f);
+
+    // Put the city on the screen, and the effects go over it full size
+    if(offscreen) {
+        FrameEnd();
     }
 
-    CarRender();
-    
-    if(show_wireframe) {
-        glDisable(GL_TEXTURE_2D);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        EntityRender();
+    glViewport(0, letterbox_offset, render_width, render_height);
+
+    if(frame_bloom) {
+        BloomFrame(FrameTexture(),
+                   0.0f,
+                   (letterbox_offset * scale) / WinHeight(),
+                   scale,
+                   ((letterbox_offset + render_height) * scale) / WinHeight());
     }
 
     do_effects(effect);
@@ -761,10 +945,17 @@ void RenderUpdate(void)
     // Framerate tracker
     if(show_fps) {
         RenderPrint(1,
-                    "FPS=%d : Entities=%d : polys=%d",
+                    "FPS=%d : Entities=%d : polys=%d : "
+                    "textures=%dK (%dK saved) : scale=%d%% : "
+                    "state=%d (%d redundant)",
                     current_fps,
                     EntityCount() + LightCount() + CarCount(),
-                    EntityPolyCount() + LightCount() + CarCount());
+                    EntityPolyCount() + LightCount() + CarCount(),
+                    TextureMemory(),
+                    TextureMemorySaved(),
+                    (int)(FrameScale() * 100.0f),
+                    PassChanges(),
+                    PassRedundant());
     }
 
     // Show the help overlay
@@ -772,6 +963,7 @@ void RenderUpdate(void)
         do_help();
     }
 
+    FontFlush(render_width, render_height);
     SDL_GL_SwapBuffers();
 }
         
@@ -52,10 +52,8 @@ void Sky::Render()
         return;
     }
 
-    glDepthMask(false);
     glPushAttrib(GL_POLYGON_BIT | GL_FOG_BIT);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glDisable(GL_CULL_FACE);
     glDisable(GL_FOG);
     glPushMatrix();
     glLoadIdentity();
@@ -65,12 +63,10 @@ void Sky::Render()
     glRotatef(angle.get_y(), 0.0f, 1.0f, 0.0f);
     glRotatef(angle.get_z(), 0.0f, 0.0f, 1.0f);
     glTranslatef(0.0f, -position.get_y() / 100.0f, 0.0f);
-    glEnable(GL_TEXTURE_2D);
     glBindTexture(GL_TEXTURE_2D, TextureId(TEXTURE_SKY));
     glCallList(list_);
     glPopMatrix();
     glPopAttrib();
-    glDepthMask(true);
     glEnable(GL_COLOR_MATERIAL);
 }
 
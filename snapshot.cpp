@@ -0,0 +1,466 @@
+/*
+ * snapshot.cpp
+ *
+ * This saves a freshly generated city to disk so the next launch with the
+ * same seed can skip generation entirely. The file is one flat block: a
+ * header, the claim map, then arrays of entities, lights, draw batches and
+ * vertices. Loading maps the file into memory and the entities render
+ * straight out of the mapping, so nothing gets rebuilt or even copied
+ * until the render lists are compiled.
+ *
+ */
+
+#include "snapshot.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "entity.hpp"
+#include "light.hpp"
+#include "mesh.hpp"
+#include "random.hpp"
+#include "texture.hpp"
+#include "win.hpp"
+
+#define SNAPSHOT_MAGIC "PXCITY"
+#define SNAPSHOT_FORMAT 2
+#define SNAPSHOT_FILE "%s-%lu.city"
+#define SNAPSHOT_VERSION \
+    ((VERSION_MAJOR << 24) | (VERSION_MINOR << 16) | VERSION_REVISION)
+#define MAX_PATH 256
+
+using namespace std;
+
+struct snapshot_header {
+    char magic[8];
+    unsigned int format;
+    unsigned int version;
+    unsigned int seed;
+    unsigned int world_size;
+    unsigned int entity_count;
+    unsigned int light_count;
+    unsigned int batch_count;
+    unsigned int vertex_count;
+    unsigned int random_size;
+    float hot_zone_min[3];
+    float hot_zone_max[3];
+    float bloom_color[4];
+};
+
+struct snapshot_entity {
+    float center[3];
+    float color[4];
+    int texture;
+    int alpha;
+    int poly_count;
+    unsigned int first_batch;
+    unsigned int batch_count;
+};
+
+struct snapshot_light {
+    float position[3];
+    float color[4];
+    int size;
+    unsigned int blink_interval;
+};
+
+// An entity that lives entirely inside the mapped file
+class CachedEntity : public Entity {
+public:
+    CachedEntity(snapshot_entity const *e,
+                 mesh_batch const *batches,
+                 mesh_vertex const *vertices);
+    void render();
+    void bounds(gl_bbox *box);
+    unsigned int texture();
+    bool alpha();
+    int poly_count();
+    gl_rgba color();
+
+private:
+    snapshot_entity const *entity_;
+    mesh_batch const *batches_;
+    mesh_vertex const *vertices_;
+};
+
+// One mapped file. The entities built from it point straight into the
+// mapping, so it has to outlive them.
+struct snapshot {
+    void *mapped;
+    size_t mapped_size;
+};
+
+CachedEntity::CachedEntity(snapshot_entity const *e,
+                           mesh_batch const *batches,
+                           mesh_vertex const *vertices)
+{
+    entity_ = e;
+    batches_ = batches + e->first_batch;
+    vertices_ = vertices;
+    center_ = gl_vector3(e->center[0], e->center[1], e->center[2]);
+}
+
+void CachedEntity::render()
+{
+    unsigned int i;
+
+    if(!entity_->batch_count) {
+        return;
+    }
+
+    glColor3fv(entity_->color);
+    glInterleavedArrays(GL_T2F_V3F, 0, vertices_);
+    for(i = 0; i < entity_->batch_count; ++i) {
+        glDrawArrays(batches_[i].mode, batches_[i].first, batches_[i].count);
+    }
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+// The box around every vertex this entity draws, the same as the mesh it
+// was saved from would have given
+void CachedEntity::bounds(gl_bbox *box)
+{
+    unsigned int i;
+    GLint v;
+    GLint end;
+
+    for(i = 0; i < entity_->batch_count; ++i) {
+        end = batches_[i].first + batches_[i].count;
+        for(v = batches_[i].first; v < end; ++v) {
+            box->contain_point(gl_vector3(vertices_[v].position[0],
+                                          vertices_[v].position[1],
+                                          vertices_[v].position[2]));
+        }
+    }
+}
+
+unsigned int CachedEntity::texture()
+{
+    if(entity_->texture < 0) {
+        return -1;
+    }
+
+    return TextureId(entity_->texture);
+}
+
+bool CachedEntity::alpha()
+{
+    return (entity_->alpha != 0);
+}
+
+int CachedEntity::poly_count()
+{
+    return entity_->poly_count;
+}
+
+gl_rgba CachedEntity::color()
+{
+    return gl_rgba(entity_->color[0],
+                   entity_->color[1],
+                   entity_->color[2],
+                   entity_->color[3]);
+}
+
+static void snapshot_path(char *path, unsigned long seed)
+{
+    snprintf(path, MAX_PATH, SNAPSHOT_FILE, APP, seed);
+}
+
+static size_t snapshot_size(snapshot_header const *h)
+{
+    return sizeof(snapshot_header)
+        + ((size_t)h->world_size * h->world_size)
+        + (h->entity_count * sizeof(snapshot_entity))
+        + (h->light_count * sizeof(snapshot_light))
+        + (h->batch_count * sizeof(mesh_batch))
+        + (h->vertex_count * sizeof(mesh_vertex))
+        + h->random_size;
+}
+
+// The size only says the counts add up. Make sure every entity's batches
+// and every batch's vertices are inside the file too, or a damaged cache
+// would have us drawing from past the end of the mapping.
+static bool snapshot_indexes(snapshot_header const *h,
+                             snapshot_entity const *entities,
+                             mesh_batch const *batches)
+{
+    unsigned int i;
+
+    for(i = 0; i < h->entity_count; ++i) {
+        if((entities[i].first_batch > h->batch_count)
+           || (entities[i].batch_count
+               > (h->batch_count - entities[i].first_batch))) {
+            return false;
+        }
+    }
+
+    for(i = 0; i < h->batch_count; ++i) {
+        if((batches[i].first < 0)
+           || (batches[i].count < 0)
+           || ((unsigned int)batches[i].first > h->vertex_count)
+           || ((unsigned int)batches[i].count
+               > (h->vertex_count - (unsigned int)batches[i].first))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void SnapshotRelease(snapshot *s)
+{
+    if(!s) {
+        return;
+    }
+
+    munmap(s->mapped, s->mapped_size);
+    delete s;
+}
+
+snapshot *SnapshotLoad(unsigned long seed,
+                  char *claim_map,
+                  gl_bbox *hot_zone,
+                  gl_rgba *bloom_color)
+{
+    char path[MAX_PATH];
+    int fd;
+    struct stat info;
+    unsigned int i;
+    char const *ptr;
+    char const *claim;
+    snapshot_header const *h;
+    snapshot_entity const *entities;
+    snapshot_light const *lights;
+    mesh_batch const *batches;
+    mesh_vertex const *vertices;
+    Light *l;
+    void *mapped;
+    size_t mapped_size;
+    snapshot *s;
+
+    snapshot_path(path, seed);
+    fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return NULL;
+    }
+
+    if((fstat(fd, &info) != 0) || (info.st_size < (off_t)sizeof(snapshot_header))) {
+        close(fd);
+        return NULL;
+    }
+
+    mapped_size = info.st_size;
+    mapped = mmap(NULL, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED) {
+        return NULL;
+    }
+
+    s = new snapshot;
+    s->mapped = mapped;
+    s->mapped_size = mapped_size;
+
+    // Anything stale or foreign gets ignored and the city is regenerated
+    h = (snapshot_header const *)mapped;
+    if(strncmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic))
+       || (h->format != SNAPSHOT_FORMAT)
+       || (h->version != SNAPSHOT_VERSION)
+       || (h->seed != (unsigned int)seed)
+       || (h->world_size != WORLD_SIZE)
+       || (h->random_size != (unsigned int)RandomStateSize())
+       || (snapshot_size(h) != mapped_size)) {
+        SnapshotRelease(s);
+        return NULL;
+    }
+
+    ptr = (char const *)(h + 1);
+    claim = ptr;
+    ptr += WORLD_SIZE * WORLD_SIZE;
+    entities = (snapshot_entity const *)ptr;
+    ptr += h->entity_count * sizeof(snapshot_entity);
+    lights = (snapshot_light const *)ptr;
+    ptr += h->light_count * sizeof(snapshot_light);
+    batches = (mesh_batch const *)ptr;
+    ptr += h->batch_count * sizeof(mesh_batch);
+    vertices = (mesh_vertex const *)ptr;
+    ptr += h->vertex_count * sizeof(mesh_vertex);
+
+    if(!snapshot_indexes(h, entities, batches)) {
+        SnapshotRelease(s);
+        return NULL;
+    }
+
+    memcpy(claim_map, claim, WORLD_SIZE * WORLD_SIZE);
+    hot_zone->set_min(gl_vector3(h->hot_zone_min[0],
+                                 h->hot_zone_min[1],
+                                 h->hot_zone_min[2]));
+
+    hot_zone->set_max(gl_vector3(h->hot_zone_max[0],
+                                 h->hot_zone_max[1],
+                                 h->hot_zone_max[2]));
+
+    *bloom_color = gl_rgba(h->bloom_color[0],
+                           h->bloom_color[1],
+                           h->bloom_color[2],
+                           h->bloom_color[3]);
+
+    for(i = 0; i < h->entity_count; ++i) {
+        new CachedEntity(&entities[i], batches, vertices);
+    }
+
+    // Lights are pushed onto the front of their list, so walk backwards to
+    // end up in the order they were saved.
+    for(i = h->light_count; i > 0; --i) {
+        snapshot_light const *sl = &lights[i - 1];
+        l = new Light(gl_vector3(sl->position[0], sl->position[1], sl->position[2]),
+                      gl_rgba(sl->color[0], sl->color[1], sl->color[2], sl->color[3]),
+                      sl->size);
+
+        if(sl->blink_interval) {
+            l->Blink(sl->blink_interval);
+        }
+    }
+
+    // Leave the generator where generating the city would have left it,
+    // so the textures built next come out the same.
+    RandomStateSet(ptr);
+
+    return s;
+}
+
+void SnapshotSave(unsigned long seed,
+                  char const *claim_map,
+                  gl_bbox const &hot_zone,
+                  gl_rgba bloom_color)
+{
+    char path[MAX_PATH];
+    char temp[MAX_PATH + 4];
+    int i;
+    FILE *f;
+    bool ok;
+    Entity *e;
+    Mesh *m;
+    Light *l;
+    gl_vector3 v;
+    gl_rgba c;
+    snapshot_header h;
+    snapshot_entity se;
+    snapshot_light sl;
+    vector<snapshot_entity> entities;
+    vector<snapshot_light> lights;
+    vector<mesh_batch> batches;
+    vector<mesh_vertex> vertices;
+    vector<char> random_state;
+
+    for(i = 0; i < EntityPendingCount(); ++i) {
+        e = EntityPendingAt(i);
+        v = e->center();
+        c = e->color();
+        se.center[0] = v.get_x();
+        se.center[1] = v.get_y();
+        se.center[2] = v.get_z();
+        se.color[0] = c.get_red();
+        se.color[1] = c.get_green();
+        se.color[2] = c.get_blue();
+        se.color[3] = c.get_alpha();
+        se.texture = TextureIndex(e->texture());
+        se.alpha = e->alpha() ? 1 : 0;
+        se.poly_count = e->poly_count();
+        se.first_batch = batches.size();
+
+        m = e->mesh();
+        if(m) {
+            m->Pack(vertices, batches);
+        }
+
+        se.batch_count = batches.size() - se.first_batch;
+        entities.push_back(se);
+    }
+
+    for(l = LightPendingFirst(); l; l = l->next_) {
+        v = l->position();
+        c = l->color();
+        sl.position[0] = v.get_x();
+        sl.position[1] = v.get_y();
+        sl.position[2] = v.get_z();
+        sl.color[0] = c.get_red();
+        sl.color[1] = c.get_green();
+        sl.color[2] = c.get_blue();
+        sl.color[3] = c.get_alpha();
+        sl.size = l->size();
+        sl.blink_interval = l->blink_interval();
+        lights.push_back(sl);
+    }
+
+    random_state.resize(RandomStateSize());
+    RandomStateGet(&random_state[0]);
+
+    memset(&h, 0, sizeof(h));
+    strncpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.format = SNAPSHOT_FORMAT;
+    h.version = SNAPSHOT_VERSION;
+    h.seed = (unsigned int)seed;
+    h.world_size = WORLD_SIZE;
+    h.entity_count = entities.size();
+    h.light_count = lights.size();
+    h.batch_count = batches.size();
+    h.vertex_count = vertices.size();
+    h.random_size = random_state.size();
+    h.hot_zone_min[0] = hot_zone.get_min().get_x();
+    h.hot_zone_min[1] = hot_zone.get_min().get_y();
+    h.hot_zone_min[2] = hot_zone.get_min().get_z();
+    h.hot_zone_max[0] = hot_zone.get_max().get_x();
+    h.hot_zone_max[1] = hot_zone.get_max().get_y();
+    h.hot_zone_max[2] = hot_zone.get_max().get_z();
+    h.bloom_color[0] = bloom_color.get_red();
+    h.bloom_color[1] = bloom_color.get_green();
+    h.bloom_color[2] = bloom_color.get_blue();
+    h.bloom_color[3] = bloom_color.get_alpha();
+
+    // Write to the side and rename, so a crash mid-write never leaves a
+    // half-finished city lying around for the next launch to trip over.
+    snapshot_path(path, seed);
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    f = fopen(temp, "wb");
+    if(!f) {
+        return;
+    }
+
+    ok = (fwrite(&h, sizeof(h), 1, f) == 1);
+    ok = ok && (fwrite(claim_map, WORLD_SIZE * WORLD_SIZE, 1, f) == 1);
+
+    if(ok && !entities.empty()) {
+        ok = (fwrite(&entities[0], sizeof(snapshot_entity), entities.size(), f)
+              == entities.size());
+    }
+
+    if(ok && !lights.empty()) {
+        ok = (fwrite(&lights[0], sizeof(snapshot_light), lights.size(), f)
+              == lights.size());
+    }
+
+    if(ok && !batches.empty()) {
+        ok = (fwrite(&batches[0], sizeof(mesh_batch), batches.size(), f)
+              == batches.size());
+    }
+
+    if(ok && !vertices.empty()) {
+        ok = (fwrite(&vertices[0], sizeof(mesh_vertex), vertices.size(), f)
+              == vertices.size());
+    }
+
+    ok = ok && (fwrite(&random_state[0], random_state.size(), 1, f) == 1);
+    ok = (fclose(f) == 0) && ok;
+
+    if(!ok || (rename(temp, path) != 0)) {
+        remove(temp);
+    }
+}
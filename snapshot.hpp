@@ -0,0 +1,21 @@
+#ifndef SNAPSHOT_HPP_
+#define SNAPSHOT_HPP_
+
+#include "gl-bbox.hpp"
+#include "gl-rgba.hpp"
+
+struct snapshot;
+
+snapshot *SnapshotLoad(unsigned long seed,
+                  char *claim_map,
+                  gl_bbox *hot_zone,
+                  gl_rgba *bloom_color);
+
+void SnapshotSave(unsigned long seed,
+                  char const *claim_map,
+                  gl_bbox const &hot_zone,
+                  gl_rgba bloom_color);
+
+void SnapshotRelease(snapshot *s);
+
+#endif /* SNAPSHOT_HPP_ */
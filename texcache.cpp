@@ -0,0 +1,336 @@
+/*
+ * texcache.cpp
+ *
+ * Keeps finished textures, mipmaps and all, between runs. Every texture is
+ * drawn from its own seed, so the seed plus which texture it is and how big
+ * says exactly what the pixels will be. On startup the cache file is mapped
+ * and anything found in it goes straight to OpenGL without being drawn.
+ * New textures are collected as they're made and the file is rewritten on
+ * the way out, dropping the oldest once it gets too big.
+ *
+ */
+
+#include "texcache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "compress.hpp"
+#include "mipmap.hpp"
+#include "win.hpp"
+
+#define TEXCACHE_MAGIC "PXTEX"
+#define TEXCACHE_FORMAT 2
+#define TEXCACHE_FILE "%s.textures"
+#define TEXCACHE_VERSION \
+    ((VERSION_MAJOR << 24) | (VERSION_MINOR << 16) | VERSION_REVISION)
+#define TEXCACHE_ALIGN 16
+// A couple of cities' worth
+#define TEXCACHE_MAX_BYTES (64 << 20)
+#define MAX_PATH 256
+
+using namespace std;
+
+struct texcache_header {
+    char magic[8];
+    unsigned int format;
+    unsigned int version;
+    unsigned int count;
+    unsigned int reserved;
+};
+
+struct texcache_entry {
+    unsigned int id;
+    unsigned int seed;
+    unsigned int size;
+    unsigned int levels;
+    unsigned int compressed;
+    unsigned int reserved;
+    unsigned long long offset;
+    unsigned long long bytes;
+};
+
+// One texture and where its pixels are, either in the mapping or in memory
+// we own.
+struct texcache_item {
+    texcache_entry entry;
+    unsigned char const *chain;
+    bool owned;
+};
+
+static void *mapped;
+static size_t mapped_size;
+static vector<texcache_item> items;
+static size_t added_bytes;
+
+static void texcache_path(char *path)
+{
+    snprintf(path, MAX_PATH, TEXCACHE_FILE, APP);
+}
+
+static size_t align(size_t bytes)
+{
+    return (bytes + TEXCACHE_ALIGN - 1) & ~(size_t)(TEXCACHE_ALIGN - 1);
+}
+
+static size_t chain_size(texcache_entry const *e)
+{
+    if(e->compressed) {
+        return CompressChainSize(e->size, e->levels);
+    }
+
+    return MipmapChainSize(e->size, e->levels);
+}
+
+static bool entry_valid(texcache_entry const *e)
+{
+    if((e->size == 0) || (e->size & (e->size - 1))) {
+        return false;
+    }
+
+    if((e->levels == 0) || ((int)e->levels > MipmapLevels(e->size))) {
+        return false;
+    }
+
+    if(e->bytes != chain_size(e)) {
+        return false;
+    }
+
+    return (e->offset <= mapped_size) && (e->bytes <= mapped_size - e->offset);
+}
+
+static void load(void)
+{
+    char path[MAX_PATH];
+    int fd;
+    struct stat info;
+    unsigned int i;
+    texcache_header const *h;
+    texcache_entry const *entries;
+    texcache_item item;
+
+    texcache_path(path);
+    fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return;
+    }
+
+    if((fstat(fd, &info) != 0)
+       || (info.st_size < (off_t)sizeof(texcache_header))) {
+        close(fd);
+        return;
+    }
+
+    mapped_size = info.st_size;
+    mapped = mmap(NULL, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED) {
+        mapped = NULL;
+        return;
+    }
+
+    // Anything stale or foreign just means starting with an empty cache
+    h = (texcache_header const *)mapped;
+    if(strncmp(h->magic, TEXCACHE_MAGIC, sizeof(h->magic))
+       || (h->format != TEXCACHE_FORMAT)
+       || (h->version != TEXCACHE_VERSION)
+       || (h->count > ((mapped_size - sizeof(texcache_header))
+                       / sizeof(texcache_entry)))) {
+        munmap(mapped, mapped_size);
+        mapped = NULL;
+        return;
+    }
+
+    entries = (texcache_entry const *)(h + 1);
+    for(i = 0; i < h->count; ++i) {
+        if(!entry_valid(&entries[i])) {
+            continue;
+        }
+
+        item.entry = entries[i];
+        item.chain = (unsigned char const *)mapped + entries[i].offset;
+        item.owned = false;
+        items.push_back(item);
+    }
+}
+
+static void save(void)
+{
+    char path[MAX_PATH];
+    char temp[MAX_PATH + 4];
+    unsigned int i;
+    unsigned int first;
+    unsigned int count;
+    size_t total;
+    size_t offset;
+    FILE *f;
+    bool ok;
+    texcache_header h;
+    vector<texcache_entry> entries;
+    static char const padding[TEXCACHE_ALIGN] = { 0 };
+
+    // The newest textures are at the back. Keep as many as fit, working
+    // forward from there.
+    total = 0;
+    count = 0;
+    for(i = items.size(); i > 0; --i) {
+        if((total + align(items[i - 1].entry.bytes)) > TEXCACHE_MAX_BYTES) {
+            break;
+        }
+
+        total += align(items[i - 1].entry.bytes);
+        ++count;
+    }
+
+    first = items.size() - count;
+    offset = align(sizeof(h) + (count * sizeof(texcache_entry)));
+    for(i = first; i < items.size(); ++i) {
+        texcache_entry e = items[i].entry;
+        e.offset = offset;
+        offset += align(e.bytes);
+        entries.push_back(e);
+    }
+
+    memset(&h, 0, sizeof(h));
+    strncpy(h.magic, TEXCACHE_MAGIC, sizeof(h.magic));
+    h.format = TEXCACHE_FORMAT;
+    h.version = TEXCACHE_VERSION;
+    h.count = count;
+
+    // Write to the side and rename. The old file stays mapped until we're
+    // done reading from it.
+    texcache_path(path);
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    f = fopen(temp, "wb");
+    if(!f) {
+        return;
+    }
+
+    ok = (fwrite(&h, sizeof(h), 1, f) == 1);
+    if(ok && count) {
+        ok = (fwrite(&entries[0], sizeof(texcache_entry), count, f) == count);
+    }
+
+    offset = sizeof(h) + (count * sizeof(texcache_entry));
+    if(ok && (align(offset) != offset)) {
+        ok = (fwrite(padding, align(offset) - offset, 1, f) == 1);
+    }
+
+    for(i = first; ok && (i < items.size()); ++i) {
+        texcache_item const *item = &items[i];
+        size_t bytes = item->entry.bytes;
+
+        ok = (fwrite(item->chain, bytes, 1, f) == 1);
+        if(ok && (align(bytes) != bytes)) {
+            ok = (fwrite(padding, align(bytes) - bytes, 1, f) == 1);
+        }
+    }
+
+    ok = (fclose(f) == 0) && ok;
+    if(ok) {
+        ok = (rename(temp, path) == 0);
+    }
+
+    if(!ok) {
+        remove(temp);
+    }
+}
+
+void TexcacheInit(void)
+{
+    load();
+}
+
+void TexcacheTerm(void)
+{
+    unsigned int i;
+
+    // Nothing new means the file on disk is already right
+    if(added_bytes) {
+        save();
+    }
+
+    for(i = 0; i < items.size(); ++i) {
+        if(items[i].owned) {
+            free((void *)items[i].chain);
+        }
+    }
+
+    items.clear();
+    added_bytes = 0;
+    if(mapped) {
+        munmap(mapped, mapped_size);
+        mapped = NULL;
+    }
+}
+
+// Returns the whole chain for this texture, or NULL if it has to be drawn
+unsigned char const *TexcacheFind(int id,
+                                  unsigned long seed,
+                                  int size,
+                                  int levels,
+                                  bool compressed)
+{
+    unsigned int i;
+    texcache_entry const *e;
+
+    for(i = 0; i < items.size(); ++i) {
+        e = &items[i].entry;
+        if((e->id == (unsigned int)id)
+           && (e->seed == (unsigned int)seed)
+           && (e->size == (unsigned int)size)
+           && (e->levels == (unsigned int)levels)
+           && (e->compressed == (compressed ? 1u : 0u))) {
+            return items[i].chain;
+        }
+    }
+
+    return NULL;
+}
+
+// Takes ownership of a chain that came from malloc(). It's kept until the
+// cache is written out at exit.
+void TexcacheStore(int id,
+                   unsigned long seed,
+                   int size,
+                   int levels,
+                   bool compressed,
+                   unsigned char *chain)
+{
+    texcache_item item;
+
+    item.entry.id = id;
+    item.entry.seed = (unsigned int)seed;
+    item.entry.size = size;
+    item.entry.levels = levels;
+    item.entry.compressed = compressed ? 1 : 0;
+    item.entry.reserved = 0;
+    item.entry.offset = 0;
+    item.entry.bytes = chain_size(&item.entry);
+    item.chain = chain;
+    item.owned = true;
+    items.push_back(item);
+    added_bytes += item.entry.bytes;
+
+    // Don't hang on to more than could ever be written. The oldest new
+    // ones go first; anything mapped costs nothing to keep around.
+    for(unsigned int i = 0;
+        (added_bytes > TEXCACHE_MAX_BYTES) && (i < items.size());
+        /* empty */) {
+        if(items[i].owned) {
+            added_bytes -= items[i].entry.bytes;
+            free((void *)items[i].chain);
+            items.erase(items.begin() + i);
+        }
+        else {
+            ++i;
+        }
+    }
+}
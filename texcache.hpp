@@ -0,0 +1,19 @@
+#ifndef TEXCACHE_HPP_
+#define TEXCACHE_HPP_
+
+void TexcacheInit(void);
+void TexcacheTerm(void);
+unsigned char const *TexcacheFind(int id,
+                                  unsigned long seed,
+                                  int size,
+                                  int levels,
+                                  bool compressed);
+
+void TexcacheStore(int id,
+                   unsigned long seed,
+                   int size,
+                   int levels,
+                   bool compressed,
+                   unsigned char *chain);
+
+#endif /* TEXCACHE_HPP_ */
@@ -19,17 +19,29 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
+#include "bloom.hpp"
 #include "building.hpp"
 #include "camera.hpp"
+#include "canvas.hpp"
 #include "car.hpp"
+#include "compress.hpp"
+#include "font.hpp"
+#include "glext.hpp"
+#include "ini.hpp"
 #include "light.hpp"
 #include "macro.hpp"
+#include "mipmap.hpp"
+#include "pass.hpp"
+#include "profile.hpp"
 #include "random.hpp"
 #include "render.hpp"
 #include "sky.hpp"
+#include "texcache.hpp"
 #include "texture.hpp"
 #include "win.hpp"
+#include "worker.hpp"
 #include "world.hpp"
 
 #define RANDOM_COLOR_SHIFT ((float)(RandomVal(10)) / 50.0f)
@@ -40,6 +52,16 @@
 #define SUFFIX_COUNT (sizeof(suffix) / sizeof(char *))
 #define NAME_COUNT (sizeof(name) / sizeof(char *))
 
+// The widest run of per-pixel noise drawrect() will pull from the generator
+// in one go. No texture is bigger than this.
+#define NOISE_MAX 512
+
+// How much of the soft circle texture the circle itself fills
+#define SOFT_CIRCLE_RADIUS (61.0f / 128.0f)
+
+// All of the building textures are this size, so they can share an array
+#define BUILDING_RESOLUTION 512
+
 static char const *prefix[] = {
     "i",
     "Green ",
@@ -128,22 +150,44 @@ public:
     int size_;
     int half_;
     int segment_size_;
+    int levels_;
     bool ready_;
     bool masked_;
     bool mipmap_;
     bool clamp_;
+    bool synthesized_;
+    bool compressed_;
+    bool building_;
+    unsigned long seed_;
+    canvas *canvas_;
+    unsigned char *chain_;
+    worker_job job_;
     CTexture *next_;
 
     CTexture(int id, int size, bool mipmap, bool clamp, bool masked);
     void Clear();
     void Rebuild();
-    void DrawWindows();
-    void DrawSky();
-    void DrawHeadlight();
+    void Start();
+    void Finish();
+    void Draw(canvas *c);
+    void DrawWindows(canvas *c);
+    void DrawSky(canvas *c);
+    void DrawHeadlight(canvas *c);
+    void DrawLattice(canvas *c);
+    void DrawTrim(canvas *c);
+    void Upload(unsigned char const *chain);
 };
 
 void CTexture::Clear()
 {
+    // Anything still being drawn belongs to the old city
+    if(building_) {
+        WorkerWait(&job_);
+        free(chain_);
+        chain_ = NULL;
+        building_ = false;
+    }
+
     ready_ = false;
 }
 
@@ -154,112 +198,162 @@ static bool name_used[NAME_COUNT];
 static bool suffix_used[SUFFIX_COUNT];
 static int build_time;
 
-void drawrect_simple(int left, int top, int right, int bottom, gl_rgba color)
+// When the driver can do it, the building textures all live in one
+// texture array, and a shader picks the layer. Then a whole cell of
+// buildings can be drawn without changing textures.
+static GLuint array_glid;
+static GLuint array_program;
+static GLint array_fog;
+static GLint array_textured;
+static bool array_bound;
+static bool compress;
+
+// The bright parts of the city, for the bloom effects. The lights and cars
+// use whatever the last frame prepared for them.
+static render_pass bloom_passes[] = {
+    { "bloom buildings", &PASS_SOLID, NULL, NULL, EntityRender },
+    { "bloom cars", &PASS_GLOW, NULL, NULL, CarRender },
+    { "bloom lights", &PASS_GLOW, NULL, NULL, LightRender },
+};
+
+// These just do what the fixed-function pipeline would: modulate the
+// texture by the vertex color, then apply linear fog.
+static char const *array_vertex =
+    "varying float layer;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = ftransform();\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    gl_FogFragCoord = abs((gl_ModelViewMatrix * gl_Vertex).z);\n"
+    "    layer = gl_MultiTexCoord1.x;\n"
+    "}\n";
+
+static char const *array_fragment =
+    "#extension GL_EXT_texture_array : enable\n"
+    "uniform sampler2DArray windows;\n"
+    "uniform float fog;\n"
+    "uniform float textured;\n"
+    "varying float layer;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 color = gl_Color;\n"
+    "    float f;\n"
+    "    if(textured > 0.5) {\n"
+    "        color *= texture2DArray(windows,\n"
+    "                                vec3(gl_TexCoord[0].st,\n"
+    "                                     floor(layer + 0.5)));\n"
+    "    }\n"
+    "    f = (gl_Fog.end - gl_FogFragCoord) * gl_Fog.scale;\n"
+    "    f = clamp(f, 0.0, 1.0);\n"
+    "    f = mix(1.0, f, fog);\n"
+    "    gl_FragColor = vec4(mix(gl_Fog.color.rgb, color.rgb, f), color.a);\n"
+    "}\n";
+
+static void drawrect_simple(canvas *c,
+                            int left,
+                            int top,
+                            int right,
+                            int bottom,
+                            gl_rgba color)
 {
-    glColor3fv(color.get_data());
-    glBegin(GL_QUADS);
-    glVertex2i(left, top);
-    glVertex2i(right, top);
-    glVertex2i(right, bottom);
-    glVertex2i(left, bottom);
-    glEnd();
+    color.set_alpha(1.0f);
+    CanvasFill(c, left, top, right, bottom, color);
 }
 
-void drawrect_simple(int left,
-                     int top,
-                     int right,
-                     int bottom,
-                     gl_rgba color1,
-                     gl_rgba color2)
+static void drawrect_simple(canvas *c,
+                            int left,
+                            int top,
+                            int right,
+                            int bottom,
+                            gl_rgba color1,
+                            gl_rgba color2)
 {
-    glColor3fv(color1.get_data());
-    glBegin(GL_TRIANGLE_FAN);
-    glVertex2i((left + right) / 2, (top + bottom) / 2);
-    glColor3fv(color2.get_data());
-    glVertex2i(left, top);
-    glVertex2i(right, top);
-    glVertex2i(right, bottom);
-    glVertex2i(left, bottom);
-    glVertex2i(left, top);
-    glEnd();
+    color1.set_alpha(1.0f);
+    color2.set_alpha(1.0f);
+    CanvasRectFan(c, left, top, right, bottom, color1, color2);
 }
 
-void drawrect(int left, int top, int right, int bottom, gl_rgba color)
+static void drawrect(canvas *c,
+                     int left,
+                     int top,
+                     int right,
+                     int bottom,
+                     gl_rgba color)
 {
     float average;
     float hue;
     int potential;
     int height;
+    int count;
     int i;
     int j;
+    int n;
     bool bright;
     gl_rgba color_noise;
+    int hue_noise[NOISE_MAX * 3];
+    int alpha_noise[NOISE_MAX];
+    int height_noise[NOISE_MAX];
+    float shade_noise[NOISE_MAX * 2];
 
-    glDisable(GL_CULL_FACE);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
-    glLineWidth(1.0f);
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glColor3fv(color.get_data());
+    color.set_alpha(1.0f);
 
     // In low resolution, a "rect" might be 1 pixel wide
     if(left == right) {
-        glBegin(GL_LINES);
-        glVertex2i(left, top);
-        glVertex2i(left, bottom);
-        glEnd();
+        CanvasFill(c, left, top, left + 1, bottom, color);
     }
 
     // In low resolution, a "rect" might be 1 pixel wide
     if(top == bottom) {
-        glBegin(GL_LINES);
-        glVertex2i(left, top);
-        glVertex2i(right, top);
-        glEnd();
+        CanvasFill(c, left, top, right, top + 1, color);
     }
     else {
         // Draw one of those fancy 2-dimensional rectangles
-        glBegin(GL_QUADS);
-        glVertex2i(left, top);
-        glVertex2i(right, top);
-        glVertex2i(right, bottom);
-        glVertex2i(left, bottom);
-        glEnd();
+        CanvasFill(c, left, top, right, bottom, color);
 
         average = (color.get_red() + color.get_blue() + color.get_green()) / 3.0f;
         bright = (average > 0.5f);
         potential = (int)(average * 255.0f);
 
         if(bright) {
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glBegin(GL_POINTS);
+            // Pull the noise for a whole column at once rather than
+            // calling into the generator several times per pixel.
+            count = MIN((bottom - 1) - (top + 1), NOISE_MAX);
+
             for(i = left + 1; i < right - 1; ++i) {
-                for(j = top + 1; j < bottom - 1; ++j) {
-                    glColor4i(255, 0, RandomVal(potential), 255);
+                if(count <= 0) {
+                    break;
+                }
+
+                RandomFill(hue_noise, count * 3, 100);
+                RandomFill(alpha_noise, count, potential);
+
+                for(n = 0; n < count; ++n) {
+                    j = top + 1 + n;
                     hue = 0.2f
-                        + ((float)RandomVal(100) / 300.0f)
-                        + ((float)RandomVal(100) / 300.0f)
-                        + ((float)RandomVal(100) / 300.0f);
+                        + ((float)hue_noise[(n * 3) + 0] / 300.0f)
+                        + ((float)hue_noise[(n * 3) + 1] / 300.0f)
+                        + ((float)hue_noise[(n * 3) + 2] / 300.0f);
 
                     gl_rgba temp;
                     color_noise = temp.from_hsl(hue, 0.3f, 0.5f);
-                    color_noise.set_alpha((float)RandomVal(potential) / 144.0f);
-                    glColor4f(RANDOM_COLOR_VAL,
-                              RANDOM_COLOR_VAL,
-                              RANDOM_COLOR_VAL,
-                              (float)RandomVal(potential)/144.0f);
-
-                    glColor4fv(color_noise.get_data());
-                    glVertex2i(i, j);
+                    color_noise.set_alpha((float)alpha_noise[n] / 144.0f);
+                    CanvasPlot(c, i, j, color_noise);
                 }
             }
-            glEnd();
         }
 
         height = (bottom - top) + (RandomVal(3) - 1) + (RandomVal(3) - 1);
 
-        for(i = left; i < right; ++i) {
-            if(RandomVal(6) == 0) {
+        count = MIN(right - left, NOISE_MAX);
+        if(count > 0) {
+            RandomFill(height_noise, count, 6);
+            RandomFill(shade_noise, count * 2);
+        }
+
+        for(n = 0; n < count; ++n) {
+            i = left + n;
+            if(height_noise[n] == 0) {
                 height = bottom - top;
                 height = RandomVal(height);
                 height = RandomVal(height);
@@ -267,19 +361,17 @@ void drawrect(int left, int top, int right, int bottom, gl_rgba color)
                 height = ((bottom - top) + height) / 2;
             }
 
-            for(j = 0; j < 1; ++j) {
-                glBegin(GL_LINES);
-                glColor4f(0, 0, 0, (float)RandomVal(256) / 256.0f);
-                glVertex2i(i, bottom - height);
-                glColor4f(0, 0, 0, (float)RandomVal(256) / 256.0f);
-                glVertex2i(i, bottom);
-                glEnd();
-            }
+            CanvasShade(c,
+                        i,
+                        bottom - height,
+                        bottom,
+                        shade_noise[(n * 2) + 0],
+                        shade_noise[(n * 2) + 1]);
         }
     }
 }
 
-static void window(int x, int y, int size, int id, gl_rgba color)
+static void window(canvas *c, int x, int y, int size, int id, gl_rgba color)
 {
     int margin;
     int half;
@@ -291,28 +383,33 @@ static void window(int x, int y, int size, int id, gl_rgba color)
     switch(id) {
     case TEXTURE_BUILDING1:
         // Filled, 1-pixel frame
-        drawrect(x + 1, y + 1, x + size - 1, y + size - 1, color);
+        drawrect(c, x + 1, y + 1, x + size - 1, y + size - 1, color);
         break;
     case TEXTURE_BUILDING2:
         // Vertical
-        drawrect(x + margin, y + 1, x + size - margin, y + size - 1, color);
+        drawrect(c, x + margin, y + 1, x + size - margin, y + size - 1, color);
         break;
     case TEXTURE_BUILDING3:
         // Side-by-side pair
-        drawrect(x + 1, y + 1, x + half - 1, y + size - margin, color);
-        drawrect(x + half + 1, y + 1, x + size - 1, y + size - margin, color);
+        drawrect(c, x + 1, y + 1, x + half - 1, y + size - margin, color);
+        drawrect(c,
+                 x + half + 1,
+                 y + 1,
+                 x + size - 1,
+                 y + size - margin,
+                 color);
         break;
     case TEXTURE_BUILDING4:
         // Windows with blinds
-        drawrect(x + 1, y + 1, x + size - 1, y + size - 1, color);
+        drawrect(c, x + 1, y + 1, x + size - 1, y + size - 1, color);
         i = RandomVal(size - 2);
-        drawrect(x + 1, y + 1, x + size - 1, y + i + 1, color * 0.3f);
+        drawrect(c, x + 1, y + 1, x + size - 1, y + i + 1, color * 0.3f);
         break;
     case TEXTURE_BUILDING5:
         // Vert stripes
-        drawrect(x + 1, y + 1, x + size - 1, y + size - 1, color);
-        drawrect(x + margin, y + 1, x + margin, y + size - 1, color * 0.7f);
-        drawrect(x + size - margin - 1, 
+        drawrect(c, x + 1, y + 1, x + size - 1, y + size - 1, color);
+        drawrect(c, x + margin, y + 1, x + margin, y + size - 1, color * 0.7f);
+        drawrect(c, x + size - margin - 1, 
                  y + 1,
                  x + size - margin - 1,
                  y + size - 1,
@@ -320,47 +417,63 @@ static void window(int x, int y, int size, int id, gl_rgba color)
         break;
     case TEXTURE_BUILDING6:
         // Wide horz line
-        drawrect(x + 1, y + 1, x + size - 1, y + size - margin, color);
+        drawrect(c, x + 1, y + 1, x + size - 1, y + size - margin, color);
         break;
     case TEXTURE_BUILDING7:
         // 4-pane
-        drawrect(x + 2, y + 1, x + size - 1, y + size - 1, color);
-        drawrect(x + 2, y + half, x + size - 1, y + half, color * 0.2f);
-        drawrect(x + half, y + 1, x + half, y + size - 1, color * 0.2f);
+        drawrect(c, x + 2, y + 1, x + size - 1, y + size - 1, color);
+        drawrect(c, x + 2, y + half, x + size - 1, y + half, color * 0.2f);
+        drawrect(c, x + half, y + 1, x + half, y + size - 1, color * 0.2f);
         break;
     case TEXTURE_BUILDING8:
         // Single narrow window
-        drawrect(x + half - 1, y + 1, x + half + 1, y + size - margin, color);
+        drawrect(c,
+                 x + half - 1,
+                 y + 1,
+                 x + half + 1,
+                 y + size - margin,
+                 color);
         break;
     case TEXTURE_BUILDING9:
         // Horizontal
-        drawrect(x + 1, y + margin, x + size - 1, y + size - margin - 1, color);
+        drawrect(c,
+                 x + 1,
+                 y + margin,
+                 x + size - 1,
+                 y + size - margin - 1,
+                 color);
         break;
     }
 }
 
 static void do_bloom(CTexture *t)
 {
+    PROFILE("do_bloom");
+    bool offscreen;
+
+    // Without a framebuffer object this draws into the corner of the
+    // screen and copies it out.
     glBindTexture(GL_TEXTURE_2D, 0);
-    glViewport(0, 0, t->size_, t->size_);
+    offscreen = BloomBegin(t->glid_, t->size_);
+    if(!offscreen) {
+        glViewport(0, 0, t->size_, t->size_);
+    }
+
     glCullFace(GL_BACK);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDepthMask(true);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_FOG);
     glFogf(GL_FOG_START, RenderFogDistance() / 2);
     glFogf(GL_FOG_END, RenderFogDistance());
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glEnable(GL_TEXTURE_2D);
-    EntityRender();
-    CarRender();
-    LightRender();
+    PassDraw(bloom_passes, sizeof(bloom_passes) / sizeof(render_pass));
+    if(offscreen) {
+        BloomEnd();
+        return;
+    }
+
     glBindTexture(GL_TEXTURE_2D, t->glid_);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 0, 0, t->size_, t->size_, 0);
@@ -377,6 +490,18 @@ CTexture::CTexture(int id, int size, bool mipmap, bool clamp, bool masked)
     size_ = size;
     half_ = size / 2;
     segment_size_ = size / SEGMENTS_PER_TEXTURE;
+    synthesized_ = (id != TEXTURE_LOGOS) && (id != TEXTURE_BLOOM);
+
+    // Only the big opaque ones are worth squeezing. BC1 has no real alpha.
+    compressed_ = compress
+        && ((id == TEXTURE_SKY)
+            || (id == TEXTURE_TRIM)
+            || ((id >= TEXTURE_BUILDING1) && (id <= TEXTURE_BUILDING9)));
+
+    building_ = false;
+    canvas_ = NULL;
+    chain_ = NULL;
+    levels_ = 1;
     ready_ = false;
     next_ = head;
     head = this;
@@ -387,7 +512,7 @@ CTexture::CTexture(int id, int size, bool mipmap, bool clamp, bool masked)
 // mean less lit windows). run_length controls how often it will consider
 // changing the lit/unlit status. 1 produces a complete scatter, higher
 // numbers make long strings of lights
-void CTexture::DrawWindows()
+void CTexture::DrawWindows(canvas *c)
 {
     int x;
     int y;
@@ -396,6 +521,8 @@ void CTexture::DrawWindows()
     int lit_density;
     gl_rgba color;
     bool lit;
+    unsigned int shade[SEGMENTS_PER_TEXTURE];
+    int shift[SEGMENTS_PER_TEXTURE * 3];
 
     // color = glRgbaUnique(_my_id);
     for(y = 0; y < SEGMENTS_PER_TEXTURE; ++y) {
@@ -406,31 +533,31 @@ void CTexture::DrawWindows()
             lit_density = 2 + RandomVal(2) + RandomVal(2);
             lit = false;
         }
+
+        // Every window on the floor needs a brightness and a tint,
+        // so grab them for the whole row up front.
+        RandomFill(shade, SEGMENTS_PER_TEXTURE);
+        RandomFill(shift, SEGMENTS_PER_TEXTURE * 3, 10);
         
         for(x = 0; x < SEGMENTS_PER_TEXTURE; ++x) {
             // If this run is over reroll lit and start a new one
             if(run < 1) {
                 run = RandomVal(run_length);
                 lit = (RandomVal(lit_density) == 0);
-                // if(lit) {
-                //     color = glRgba(0.5f + (float)(RandomVal() % 128) / 256.0f)
-                //         + glRgba(RANDOM_COLOR_SHIFT, 
-                //                  RANDOM_COLOR_SHIFT,
-                //                  RANDOM_COLOR_SHIFT);
-                // }
             }
             
             if(lit) {
-                color = gl_rgba(0.5f + ((float)(RandomVal() % 128) / 256.0f))
-                    + gl_rgba(RANDOM_COLOR_SHIFT,
-                             RANDOM_COLOR_SHIFT, 
-                             RANDOM_COLOR_SHIFT);
+                color = gl_rgba(0.5f + ((float)(shade[x] % 128) / 256.0f))
+                    + gl_rgba((float)shift[(x * 3) + 0] / 50.0f,
+                              (float)shift[(x * 3) + 1] / 50.0f,
+                              (float)shift[(x * 3) + 2] / 50.0f);
             }
             else {
-                color = gl_rgba((float)(RandomVal() % 40) / 256.0f);
+                color = gl_rgba((float)(shade[x] % 40) / 256.0f);
             }
 
-            window(x * segment_size_, 
+            window(c,
+                   x * segment_size_,
                    y * segment_size_,
                    segment_size_,
                    my_id_,
@@ -441,7 +568,7 @@ void CTexture::DrawWindows()
     }
 }
 
-void CTexture::DrawSky()
+void CTexture::DrawSky(canvas *c)
 {
     gl_rgba color;
     float grey;
@@ -461,19 +588,13 @@ void CTexture::DrawSky()
 
     // Desaturate, slightly dim
     color = (color + (gl_rgba(grey) * 2.0f)) / 15.0f;
-    glDisable(GL_BLEND);
-    glBegin(GL_QUAD_STRIP);
-    glColor3f(0, 0, 0);
-    glVertex2i(0, half_);
-    glVertex2i(size_, half_);
-    glColor3fv(color.get_data());
-    glVertex2i(0, size_ - 2);
-    glVertex2i(size_, size_ - 2);
-    glEnd();
+    color.set_alpha(1.0f);
+    CanvasGradient(c, half_, size_ - 2, gl_rgba(0.0f, 0.0f, 0.0f, 1.0f), color);
 
     // Draw a bunch of little faux-buildings on the horizon
     for(i = 0; i < size_; i += 5) {
-        drawrect(i, 
+        drawrect(c,
+                 i, 
                  size_ - RandomVal(8) - RandomVal(8) - RandomVal(8),
                  i + RandomVal(9),
                  size_,
@@ -491,13 +612,6 @@ void CTexture::DrawSky()
         height = (int)((float)width * scale);
         height = MAX(height, 4);
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDisable(GL_CULL_FACE);
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, TextureId(TEXTURE_SOFT_CIRCLE));
-        glDepthMask(false);
-        glBegin(GL_QUADS);
         for(offset = -size_; offset <= size_; offset += size_) {
             for(scale = 1.0f; scale > 0.0f; scale -= 0.25f) {
                 inv_scale = 1.0f - scale;
@@ -509,99 +623,283 @@ void CTexture::DrawSky()
                 }
 
                 color.set_alpha(0.2f);
-                glColor4fv(color.get_data());
                 width_adjust = 
                     (int)(((float)width / 2.0f)
                           + (int)(inv_scale * ((float)width / 2.0f)));
                 
                 height_adjust = height + (int)(scale * (float)height * 0.99f);
-                
-                glTexCoord2f(0, 0);
-                glVertex2i(offset + x - width_adjust, 
-                           y + height - height_adjust);
 
-                glTexCoord2f(0, 1);
-                glVertex2i(offset + x - width_adjust, y + height);
-
-                glTexCoord2f(1, 1);
-                glVertex2i(offset + x + width_adjust, y + height);
-                
-                glTexCoord2f(1, 0);
-                glVertex2i(offset + x + width_adjust,
-                           y + height - height_adjust);
+                // The soft circle texture has a little margin around the
+                // edge, so the circle doesn't quite fill the quad.
+                CanvasBlob(c,
+                           offset + x - width_adjust,
+                           y + height - height_adjust,
+                           offset + x + width_adjust,
+                           y + height,
+                           SOFT_CIRCLE_RADIUS,
+                           color);
             }
         }
     }
-
-    glEnd();
 }
 
-void CTexture::DrawHeadlight()
+void CTexture::DrawHeadlight(canvas *c)
 {
     float radius;
-    int i;
     int x;
     int y;
-    gl_vector2 pos;
 
     // Make a simple circle of light, bright in the center and fading out
     radius = ((float)half_) - 20;
     x = half_ - 20;
     y = half_;
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glBegin(GL_TRIANGLE_FAN);
-    glColor4f(0.8f, 0.8f, 0.8f, 0.6f);
-    glVertex2i(half_ - 5, y);
-    glColor4f(0, 0, 0, 0);
-    for(i = 0; i <= 360; i += 36) {
-        pos.set_x(sinf((float)(i % 360) * DEGREES_TO_RADIANS) * radius);
-        pos.set_y(cosf((float)(i % 360) * DEGREES_TO_RADIANS) * radius);
-        glVertex2i(x + (int)pos.get_x(), half_ + (int)pos.get_y());
-    }
-    glEnd();
+    CanvasFan(c,
+              (float)(half_ - 5),
+              (float)y,
+              (float)x,
+              (float)half_,
+              radius,
+              gl_rgba(0.8f, 0.8f, 0.8f, 0.6f),
+              gl_rgba(0.0f, 0.0f, 0.0f, 0.0f));
 
     x = half_ + 20;
-    glBegin(GL_TRIANGLE_FAN);
-    glColor4f(0.8f, 0.8f, 0.8f, 0.6f);
-    glVertex2i(half_ + 5, y);
-    glColor4f(0, 0, 0, 0);
-    for(i = 0; i <= 360; i += 36) {
-        pos.set_x(sinf((float)(i % 360) * DEGREES_TO_RADIANS) * radius);
-        pos.set_y(cosf((float)(i % 360) * DEGREES_TO_RADIANS) * radius);
-        glVertex2i(x + (int)pos.get_x(), half_ + (int)pos.get_y());
-    }
-    glEnd();
+    CanvasFan(c,
+              (float)(half_ + 5),
+              (float)y,
+              (float)x,
+              (float)half_,
+              radius,
+              gl_rgba(0.8f, 0.8f, 0.8f, 0.6f),
+              gl_rgba(0.0f, 0.0f, 0.0f, 0.0f));
 
     x = half_ - 6;
-    drawrect_simple(x - 3, y - 2, x + 2, y + 2, gl_rgba(1.0f));
+    drawrect_simple(c, x - 3, y - 2, x + 2, y + 2, gl_rgba(1.0f));
     x = half_ + 6;
-    drawrect_simple(x - 2, y - 2, x + 3, y + 2, gl_rgba(1.0f));
-};
+    drawrect_simple(c, x - 2, y - 2, x + 3, y + 2, gl_rgba(1.0f));
+}
+
+void CTexture::DrawLattice(canvas *c)
+{
+    int i;
+    int x;
+    int y;
+    int last_x;
+    int last_y;
+    gl_rgba black;
+
+    black = gl_rgba(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // Diagonal
+    CanvasLine(c, 0, 0, size_, size_, 2, black);
+
+    // Vertical
+    CanvasLine(c, 0, 0, 0, size_, 2, black);
+
+    // Vertical
+    CanvasLine(c, 0, 0, size_, 0, 2, black);
+
+    last_x = 0;
+    last_y = 0;
+    for(i = 0; i < size_; i += 9) {
+        x = (i % 2) ? 0 : i;
+        y = i;
+        CanvasLine(c, last_x, last_y, x, y, 2, black);
+        last_x = x;
+        last_y = y;
+    }
+
+    for(i = 0; i < size_; i += 9) {
+        x = i;
+        y = (i % 2) ? 0 : i;
+        CanvasLine(c, last_x, last_y, x, y, 2, black);
+        last_x = x;
+        last_y = y;
+    }
+}
+
+void CTexture::DrawTrim(canvas *c)
+{
+    int margin;
+    int x;
+    int y;
+
+    y = 0;
+    margin = MAX(TRIM_PIXELS / 4, 1);
+
+    for(x = 0; x < size_; x += TRIM_PIXELS) {
+        drawrect_simple(c,
+                        x + margin,
+                        y + margin,
+                        x + TRIM_PIXELS - margin,
+                        y + TRIM_PIXELS - margin,
+                        gl_rgba(1.0f),
+                        gl_rgba(0.5f));
+    }
+    
+    y += TRIM_PIXELS;
+    for(x = 0; x < size_; x += TRIM_PIXELS * 2) {
+        drawrect_simple(c,
+                        x + margin,
+                        y + margin,
+                        x + TRIM_PIXELS - margin,
+                        y + TRIM_PIXELS - margin,
+                        gl_rgba(1.0f),
+                        gl_rgba(0.5f));
+    }
+
+    y += TRIM_PIXELS;
+    for(x = 0; x < size_; x += TRIM_PIXELS * 3) {
+        drawrect_simple(c,
+                        x + margin,
+                        y + margin,
+                        x + TRIM_PIXELS - margin,
+                        y + TRIM_PIXELS - margin,
+                        gl_rgba(1.0f),
+                        gl_rgba(0.5f));
+    }
+
+    y += TRIM_PIXELS;
+    for(x = 0; x < size_; x += TRIM_PIXELS) {
+        drawrect_simple(c,
+                        x + margin,
+                        y + margin,
+                        x + TRIM_PIXELS - margin,
+                        y + TRIM_PIXELS - margin,
+                        gl_rgba(1.0f),
+                        gl_rgba(0.5f));
+    }
+}
 
 // Here is where ALL of the procedural textures are created. It's filled with
 // obscure logic, magic numbers, and message code. Part of this is because
 // there is a lot of "art" being done here, and lots of numbers that could be
 // endlessly tweaked. Also because I'm lazy.
+//
+// This only touches the canvas, never OpenGL.
+void CTexture::Draw(canvas *c)
+{
+    int j;
+    float radius;
+
+    CanvasClear(c, gl_rgba(0.0f, 0.0f, 0.0f, masked_ ? 0.0f : 1.0f));
+
+    switch(my_id_) {
+    case TEXTURE_LATTICE:
+        DrawLattice(c);
+        break;
+    case TEXTURE_SOFT_CIRCLE:
+        // Make a simple circle of light, bright in the center and fading out
+        radius = (float)half_ - 3;
+        CanvasFan(c,
+                  (float)half_,
+                  (float)half_,
+                  (float)half_,
+                  (float)half_,
+                  radius,
+                  gl_rgba(1.0f, 1.0f, 1.0f, 1.0f),
+                  gl_rgba(0.0f, 0.0f, 0.0f, 0.0f));
+        break;
+    case TEXTURE_LIGHT:
+        for(j = 0; j < 2; ++j) {
+            if(!j) {
+                radius = (float)half_ / 2;
+            }
+            else {
+                radius = 8;
+            }
+
+            CanvasFan(c,
+                      (float)half_,
+                      (float)half_,
+                      (float)half_,
+                      (float)half_,
+                      radius,
+                      gl_rgba(1.0f, 1.0f, 1.0f, 1.0f),
+                      gl_rgba(1.0f, 1.0f, 1.0f, 0.0f));
+        }
+        break;
+    case TEXTURE_HEADLIGHT:
+        DrawHeadlight(c);
+        break;
+    case TEXTURE_TRIM:
+        DrawTrim(c);
+        break;
+    case TEXTURE_SKY:
+        DrawSky(c);
+        break;
+    default:
+        // Building textures
+        DrawWindows(c);
+        break;
+    }
+}
+
+// Hand a finished image, and its mipmaps if it has any, to OpenGL
+void CTexture::Upload(unsigned char const *chain)
+{
+    int layer;
+
+    if(array_program
+       && (my_id_ >= TEXTURE_BUILDING1)
+       && (my_id_ <= TEXTURE_BUILDING9)) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, array_glid);
+        layer = my_id_ - TEXTURE_BUILDING1;
+        if(compressed_) {
+            CompressUploadLayer(chain, size_, levels_, layer);
+        }
+        else {
+            MipmapUploadLayer(chain, size_, levels_, layer);
+        }
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, 0);
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, glid_);
+    if(clamp_) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    if(compressed_) {
+        CompressUpload(chain, size_, levels_);
+    }
+    else {
+        MipmapUpload(chain, size_, levels_);
+    }
+
+    if(mipmap_) {
+        glTexParameteri(GL_TEXTURE_2D, 
+                        GL_TEXTURE_MIN_FILTER,
+                        GL_LINEAR_MIPMAP_LINEAR);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    else {
+        // Without mipmaps the default minification filter would leave the
+        // texture incomplete.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+}
+
+// The logos are made from the font, and bloom is a copy of the screen, so
+// these two still have to be drawn by OpenGL into the viewport.
 void CTexture::Rebuild()
 {
+    PROFILE("CTexture::Rebuild");
+    unsigned int start;
+    int lapsed;
     int i;
-    int j;
-    int x;
-    int y;
     int name_num;
     int prefix_num;
     int suffix_num;
     int max_size;
-    float radius;
-    gl_vector2 pos;
-    bool use_framebuffer;
-    unsigned char *bits;
-    unsigned int start;
-    int lapsed;
+    int row;
+    char logo[64];
 
     start = SDL_GetTicks();
-    
+
     // Since we make textures by drawing into the viewport, we can't make
     // them bigger than the current view.
     size_ = desired_size_;
@@ -610,6 +908,7 @@ void CTexture::Rebuild()
         size_ /= 2;
     }
 
+    levels_ = mipmap_ ? MipmapLevels(size_) : 1;
     glBindTexture(GL_TEXTURE_2D, glid_);
     // Set up the texutre
     glTexImage2D(GL_TEXTURE_2D,
@@ -645,202 +944,59 @@ void CTexture::Rebuild()
     glTranslatef(0, 0, -10.0f);
     glClearColor(0, 0, 0, masked_ ? 0.0f : 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    use_framebuffer = true;
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     
-    switch(my_id_) {
-    case TEXTURE_LATTICE:
-        glLineWidth(2.0f);
-
-        glColor3f(0, 0, 0);
-        glBegin(GL_LINES);
-
-        // Diagonal
-        glVertex2i(0, 0);
-        glVertex2i(size_, size_);
-
-        // Vertical
-        glVertex2i(0, 0);
-        glVertex2i(0, size_);
-
-        // Vertical
-        glVertex2i(0, 0);
-        glVertex2i(size_, 0);
-        
-        glEnd();
-
-        glBegin(GL_LINE_STRIP);
-        glVertex2i(0, 0);
-        for(i = 0; i < size_; i += 9) {
-            if(i % 2) {
-                glVertex2i(0, i);
-            }
-            else {
-                glVertex2i(i, i);
-            }
-        }
-
-        for(i = 0; i < size_; i += 9) {
-            if(i % 2) {
-                glVertex2i(i, 0);
-            }
-            else {
-                glVertex2i(i, i);
-            }
-        }
-        glEnd();
-        break;
-    case TEXTURE_SOFT_CIRCLE:
-        // Make a simple circle of light, bright in the center and fading out
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        radius = (float)half_ - 3;
-        glBegin(GL_TRIANGLE_FAN);
-        glColor4f(1, 1, 1, 1);
-        glVertex2i(half_, half_);
-        glColor4f(0, 0, 0, 0);
-        for(i = 0; i <= 360; ++i) {
-            pos.set_x(sinf((float)i * DEGREES_TO_RADIANS) * radius);
-            pos.set_y(cosf((float)i * DEGREES_TO_RADIANS) * radius);
-            glVertex2i(half_ + (int)pos.get_x(), half_ + (int)pos.get_y());
-        }
-        glEnd();
-        break;
-    case TEXTURE_LIGHT:
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        radius = (float)half_ - 3;
-        for(j = 0; j < 2; ++j) {
-            glBegin(GL_TRIANGLE_FAN);
-            glColor4f(1, 1, 1, 1);
-            glVertex2i(half_, half_);
-            if(!j) {
-                radius = (float)half_ / 2;
-            }
-            else {
-                radius = 8;
-            }
-
-            glColor4f(1, 1, 1, 0);
-            for(i = 0; i <= 360; ++i) {
-                pos.set_x(sinf((float)i * DEGREES_TO_RADIANS) * radius);
-                pos.set_y(cosf((float)i * DEGREES_TO_RADIANS) * radius);
-                glVertex2i(half_ + (int)pos.get_x(), half_ + (int)pos.get_y());
-            }
-            glEnd();
-        }
-        break;
-    case TEXTURE_HEADLIGHT:
-        DrawHeadlight();
-        break;
-    case TEXTURE_LOGOS:
-        i = 0;
+    if(my_id_ == TEXTURE_LOGOS) {
         glDepthMask(false);
         glDisable(GL_BLEND);
         name_num = RandomVal(NAME_COUNT);
         prefix_num = RandomVal(PREFIX_COUNT);
         suffix_num = RandomVal(SUFFIX_COUNT);
-        glColor3f(1, 1, 1);
 
-        while(i < size_) {
+        // Each logo gets a row, with the text sitting a little above the
+        // bottom of it. The texture may have shrunk to fit the view.
+        row = size_ / LOGO_ROWS;
+        for(i = 0; i < size_; i += row) {
             // Randomly use a prefix OR suffix, but not both. Too verbose.
             if(COIN_FLIP) {
-                RenderPrint(2,
-                            size_ - i - (LOGO_PIXELS / 4),
-                            RandomVal(),
-                            gl_rgba(1.0f),
-                            "%s%s",
-                            prefix[prefix_num],
-                            name[name_num]);
+                snprintf(logo,
+                         sizeof(logo),
+                         "%s%s",
+                         prefix[prefix_num],
+                         name[name_num]);
             }
             else {
-                RenderPrint(2,
-                            size_ - i - (LOGO_PIXELS / 4),
-                            RandomVal(),
-                            gl_rgba(1.0f),
-                            "%s%s",
-                            name[name_num],
-                            suffix[suffix_num]);
+                snprintf(logo,
+                         sizeof(logo),
+                         "%s%s",
+                         name[name_num],
+                         suffix[suffix_num]);
             }
 
+            FontPrint(2,
+                      size_ - i - (row / 4),
+                      (row * 3) / 4,
+                      RandomVal(FONT_STYLES),
+                      gl_rgba(1.0f),
+                      logo);
+
             name_num = (name_num + 1) % NAME_COUNT;
             prefix_num = (prefix_num + 1) % PREFIX_COUNT;
             suffix_num = (suffix_num + 1) % SUFFIX_COUNT;
         }
-        break;
-    case TEXTURE_TRIM:
-        int margin;
-        y = 0;
-        margin = MAX(TRIM_PIXELS / 4, 1);
-
-        for(x = 0; x < size_; x += TRIM_PIXELS) {
-            drawrect_simple(x + margin,
-                            y + margin,
-                            x + TRIM_PIXELS - margin,
-                            y + TRIM_PIXELS - margin,
-                            gl_rgba(1.0f),
-                            gl_rgba(0.5f));
-        }
-        
-        y += TRIM_PIXELS;
-        for(x = 0; x < size_; x += TRIM_PIXELS * 2) {
-            drawrect_simple(x + margin,
-                            y + margin,
-                            x + TRIM_PIXELS - margin,
-                            y + TRIM_PIXELS - margin,
-                            gl_rgba(1.0f),
-                            gl_rgba(0.5f));
-        }
 
-        y += TRIM_PIXELS;
-        for(x = 0; x < size_; x += TRIM_PIXELS * 3) {
-            drawrect_simple(x + margin,
-                            y + margin,
-                            x + TRIM_PIXELS - margin,
-                            y + TRIM_PIXELS - margin,
-                            gl_rgba(1.0f),
-                            gl_rgba(0.5f));
-        }
-
-        y += TRIM_PIXELS;
-        for(x = 0; x < size_; x += TRIM_PIXELS) {
-            drawrect_simple(x + margin,
-                            y + margin,
-                            x + TRIM_PIXELS - margin,
-                            y + TRIM_PIXELS - margin,
-                            gl_rgba(1.0f),
-                            gl_rgba(0.5f));
-        }
-        break;
-    case TEXTURE_SKY:
-        DrawSky();
-        break;
-    default:
-        // Building textures
-        DrawWindows();
-        break;
+        FontFlush(size_, size_);
     }
 
     glPopMatrix();
 
-    // Now blit the finished image into our texture
-    if(use_framebuffer) {
-        glBindTexture(GL_TEXTURE_2D, glid_);
-        glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 0, 0, size_, size_, 0);
-    }
+    // Now blit the finished image into our texture. If it needs mipmaps,
+    // let the driver make them from the copy rather than reading it back.
+    glBindTexture(GL_TEXTURE_2D, glid_);
+    glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, mipmap_);
+    glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 0, 0, size_, size_, 0);
     
     if(mipmap_) {
-        bits = (unsigned char *)malloc(size_ * size_ * 4);
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, bits);
-        gluBuild2DMipmaps(GL_TEXTURE_2D, 
-                          GL_RGBA,
-                          size_, 
-                          size_,
-                          GL_RGBA,
-                          GL_UNSIGNED_BYTE, 
-                          bits);
-
-        free(bits);
         glTexParameteri(GL_TEXTURE_2D, 
                         GL_TEXTURE_MIN_FILTER,
                         GL_LINEAR_MIPMAP_LINEAR);
@@ -858,6 +1014,69 @@ void CTexture::Rebuild()
     build_time += lapsed;
 }
 
+// Runs on a worker thread
+static void synthesize(void *data)
+{
+    CTexture *t;
+    unsigned char *packed;
+
+    t = (CTexture *)data;
+    RandomInit(t->seed_);
+    t->Draw(t->canvas_);
+
+    // The mipmaps get made out here too. Masks need their coverage kept
+    // as-is. Everything else is color, and looks better averaged as light.
+    t->chain_ = (unsigned char *)malloc(MipmapChainSize(t->size_, t->levels_));
+    memcpy(t->chain_, t->canvas_->bits, t->size_ * t->size_ * 4);
+    MipmapBuild(t->chain_, t->size_, t->levels_, !t->masked_);
+    CanvasDestroy(t->canvas_);
+    t->canvas_ = NULL;
+
+    if(t->compressed_) {
+        packed = (unsigned char *)malloc(CompressChainSize(t->size_,
+                                                           t->levels_));
+
+        CompressChain(t->chain_, packed, t->size_, t->levels_);
+        free(t->chain_);
+        t->chain_ = packed;
+    }
+}
+
+// Everything else is drawn in memory, so the size of the window doesn't
+// matter and it can happen off on a worker. Each texture gets its own seed
+// from the main generator, so they come out the same no matter which
+// thread gets to them first. That also means a texture made from the same
+// seed before can come straight out of the cache.
+void CTexture::Start()
+{
+    unsigned char const *cached;
+
+    size_ = desired_size_;
+    levels_ = mipmap_ ? MipmapLevels(size_) : 1;
+    seed_ = RandomVal();
+    cached = TexcacheFind(my_id_, seed_, size_, levels_, compressed_);
+    if(cached) {
+        Upload(cached);
+        ready_ = true;
+        return;
+    }
+
+    canvas_ = CanvasCreate(size_);
+    building_ = true;
+    WorkerSubmit(&job_, synthesize, this);
+}
+
+void CTexture::Finish()
+{
+    Upload(chain_);
+
+    // The cache keeps the chain from here on
+    TexcacheStore(my_id_, seed_, size_, levels_, compressed_, chain_);
+    chain_ = NULL;
+    building_ = false;
+    ready_ = true;
+}
+
 unsigned int TextureId(int id)
 {
     for(CTexture *t = head; t; t = t->next_) {
@@ -869,6 +1088,78 @@ unsigned int TextureId(int id)
     return 0;
 }
 
+// The reverse of TextureId(): which of our textures owns this GL name?
+int TextureIndex(unsigned int glid)
+{
+    for(CTexture *t = head; t; t = t->next_) {
+        if(t->glid_ == glid) {
+            return t->my_id_;
+        }
+    }
+
+    return -1;
+}
+
+// Which layer of the building array this texture lives in, or -1 if it's
+// just a plain texture.
+static int array_layer(unsigned int glid)
+{
+    if(!array_program || !glid) {
+        return -1;
+    }
+
+    for(CTexture *t = head; t; t = t->next_) {
+        if((t->glid_ == glid)
+           && (t->my_id_ >= TEXTURE_BUILDING1)
+           && (t->my_id_ <= TEXTURE_BUILDING9)) {
+            return t->my_id_ - TEXTURE_BUILDING1;
+        }
+    }
+
+    return -1;
+}
+
+// Use in place of glBindTexture() for anything that might be a building
+// texture. Binding 0 puts things back to normal.
+void TextureBind(unsigned int glid)
+{
+    int layer;
+
+    layer = array_layer(glid);
+    if(layer < 0) {
+        if(array_bound) {
+            pglUseProgram(0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, 0);
+            array_bound = false;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, glid);
+        return;
+    }
+
+    if(!array_bound) {
+        pglUseProgram(array_program);
+        glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, array_glid);
+        array_bound = true;
+    }
+
+    pglMultiTexCoord1f(GL_TEXTURE1, (float)layer);
+}
+
+// The array shader can't see the fixed-function switches, so tell it about
+// the ones that matter before drawing.
+void TexturePrepare(void)
+{
+    if(!array_program) {
+        return;
+    }
+
+    pglUseProgram(array_program);
+    pglUniform1f(array_fog, glIsEnabled(GL_FOG) ? 1.0f : 0.0f);
+    pglUniform1f(array_textured, glIsEnabled(GL_TEXTURE_2D) ? 1.0f : 0.0f);
+    pglUseProgram(0);
+}
+
 unsigned int TextureRandomBuilding(int index)
 {
     index = abs(index) % BUILDING_COUNT;
@@ -895,6 +1186,8 @@ bool TextureReady()
 
 void TextureUpdate(void)
 {
+    PROFILE("TextureUpdate");
+
     if(textures_done) {
         if(!RenderBloom()) {
             return;
@@ -911,13 +1204,34 @@ void TextureUpdate(void)
         }
     }
 
+    // Hand every texture that can be drawn in memory to the workers at once
     for(CTexture *t = head; t; t = t->next_) {
-        if(!t->ready_) {
+        if(!t->ready_ && !t->building_ && t->synthesized_) {
+            t->Start();
+        }
+    }
+
+    // Upload whatever they've finished
+    for(CTexture *t = head; t; t = t->next_) {
+        if(t->building_ && WorkerDone(&t->job_)) {
+            t->Finish();
+        }
+    }
+
+    // The ones OpenGL has to draw are still done one per frame
+    for(CTexture *t = head; t; t = t->next_) {
+        if(!t->ready_ && !t->synthesized_) {
             t->Rebuild();
             return;
         }
     }
 
+    for(CTexture *t = head; t; t = t->next_) {
+        if(!t->ready_) {
+            return;
+        }
+    }
+
     textures_done = true;
 }
 
@@ -927,13 +1241,57 @@ void TextureTerm(void)
     
     while(head) {
         t = head->next_;
+        head->Clear();
         free(head);
         head = t;
     }
+
+    TexcacheTerm();
+}
+
+// Kilobytes of texture memory in use by the ones that are ready
+int TextureMemory(void)
+{
+    size_t bytes;
+
+    bytes = 0;
+    for(CTexture *t = head; t; t = t->next_) {
+        if(!t->ready_) {
+            continue;
+        }
+
+        if(t->compressed_) {
+            bytes += CompressChainSize(t->size_, t->levels_);
+        }
+        else {
+            bytes += MipmapChainSize(t->size_, t->levels_);
+        }
+    }
+
+    return bytes / 1024;
+}
+
+// How many kilobytes compression is saving over plain RGBA
+int TextureMemorySaved(void)
+{
+    size_t bytes;
+
+    bytes = 0;
+    for(CTexture *t = head; t; t = t->next_) {
+        if(t->ready_ && t->compressed_) {
+            bytes += MipmapChainSize(t->size_, t->levels_)
+                - CompressChainSize(t->size_, t->levels_);
+        }
+    }
+
+    return bytes / 1024;
 }
 
 void TextureInit(void)
 {
+    TexcacheInit();
+    MipmapInit();
+    compress = GlextCompression() && (IniInt("CompressTextures") != 0);
     new CTexture(TEXTURE_SKY, 512, true, false, false);
     new CTexture(TEXTURE_LATTICE, 128, true, true, true);
     new CTexture(TEXTURE_LIGHT, 128, false, false, true);
@@ -941,8 +1299,47 @@ void TextureInit(void)
     new CTexture(TEXTURE_HEADLIGHT, 128, false, false, true);
     new CTexture(TEXTURE_TRIM, TRIM_RESOLUTION, true, false, false);
     new CTexture(TEXTURE_LOGOS, LOGO_RESOLUTION, true, false, true);
-    for(int i = TEXTURE_BUILDING1; i < TEXTURE_BUILDING9; ++i) {
-        new CTexture(i, 512, true, false, false);
+    for(int i = TEXTURE_BUILDING1; i <= TEXTURE_BUILDING9; ++i) {
+        new CTexture(i, BUILDING_RESOLUTION, true, false, false);
     }
     new CTexture(TEXTURE_BLOOM, 512, true, false, false);
+
+    if(!GlextTextureArray()) {
+        return;
+    }
+
+    array_program = GlextProgram(array_vertex, array_fragment);
+    if(!array_program) {
+        return;
+    }
+
+    array_fog = pglGetUniformLocation(array_program, "fog");
+    array_textured = pglGetUniformLocation(array_program, "textured");
+    pglUseProgram(array_program);
+    pglUniform1i(pglGetUniformLocation(array_program, "windows"), 0);
+    pglUseProgram(0);
+
+    // Make room for every level of every layer up front, so each texture
+    // can be dropped in whenever it's ready.
+    glGenTextures(1, &array_glid);
+    glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, array_glid);
+    for(int level = 0, size = BUILDING_RESOLUTION; size; ++level, size /= 2) {
+        pglTexImage3D(GL_TEXTURE_2D_ARRAY_EXT,
+                      level,
+                      compress ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGBA,
+                      size,
+                      size,
+                      BUILDING_COUNT,
+                      0,
+                      GL_RGBA,
+                      GL_UNSIGNED_BYTE,
+                      NULL);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT,
+                    GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY_EXT, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY_EXT, 0);
 }
@@ -38,9 +38,14 @@ enum {
 
 #define BUILDING_COUNT ((TEXTURE_BUILDING9 - TEXTURE_BUILDING1) + 1)
 
+void TextureBind(unsigned int glid);
 unsigned int TextureFromName(char *name);
 unsigned int TextureId(int id);
+int TextureIndex(unsigned int glid);
 void TextureInit(void);
+int TextureMemory(void);
+int TextureMemorySaved(void);
+void TexturePrepare(void);
 void TextureTerm(void);
 unsigned int TextureRandomBuilding(int index);
 bool TextureReady();
@@ -0,0 +1,239 @@
+/*
+ * track.cpp
+ *
+ * Camera tracks: where the camera was and which way it faced, at times
+ * counted in milliseconds from the start. They're kept as plain text, one
+ * keyframe to a line, so a track can be written by hand as easily as
+ * recorded:
+ *
+ *   # milliseconds x y z pitch yaw roll
+ *   0 512 60 300 10 0 0
+ *   5000 600 45 512 5 90 0
+ *
+ * Playing one back runs a smooth curve through the keyframes, so a track
+ * recorded a few times a second still flies smoothly, and one written by
+ * hand needs only a handful of lines.
+ *
+ */
+
+#include "track.hpp"
+
+#include <cstdio>
+#include <vector>
+
+#include "macro.hpp"
+#include "math.hpp"
+
+#define TRACK_HEADER "# PixelCity camera track\n" \
+    "# milliseconds x y z pitch yaw roll\n"
+#define TRACK_FORMAT "%u %f %f %f %f %f %f"
+#define MAX_LINE 256
+
+struct track_key {
+    unsigned int time;
+    gl_vector3 position;
+    gl_vector3 angle;
+};
+
+static std::vector<track_key> keys;
+static unsigned int cursor;
+static FILE *record;
+
+// Read in a track to play back. False if there isn't one to play.
+bool TrackLoad(char const *file)
+{
+    FILE *f;
+    char line[MAX_LINE];
+    track_key key;
+    float x;
+    float y;
+    float z;
+    float pitch;
+    float yaw;
+    float roll;
+
+    keys.clear();
+    cursor = 0;
+    if(!file || !file[0]) {
+        return false;
+    }
+
+    f = fopen(file, "r");
+    if(!f) {
+        return false;
+    }
+
+    while(fgets(line, MAX_LINE, f)) {
+        if(sscanf(line,
+                  TRACK_FORMAT,
+                  &key.time,
+                  &x,
+                  &y,
+                  &z,
+                  &pitch,
+                  &yaw,
+                  &roll) != 7) {
+            continue;
+        }
+
+        // Keyframes have to move forward in time
+        if(!keys.empty() && (key.time <= keys.back().time)) {
+            continue;
+        }
+
+        // Always turn the short way round, so the curve doesn't spin
+        // the long way from 350 to 10 degrees
+        if(!keys.empty()) {
+            yaw = keys.back().angle.get_y()
+                + MathAngleDifference(yaw, keys.back().angle.get_y());
+        }
+
+        key.position = gl_vector3(x, y, z);
+        key.angle = gl_vector3(pitch, yaw, roll);
+        keys.push_back(key);
+    }
+
+    fclose(f);
+
+    return !keys.empty();
+}
+
+// Start writing where the camera goes to a new track
+bool TrackRecordStart(char const *file)
+{
+    if(record) {
+        fclose(record);
+        record = NULL;
+    }
+
+    if(!file || !file[0]) {
+        return false;
+    }
+
+    record = fopen(file, "w");
+    if(!record) {
+        return false;
+    }
+
+    fputs(TRACK_HEADER, record);
+
+    return true;
+}
+
+void TrackRecord(unsigned int time, gl_vector3 position, gl_vector3 angle)
+{
+    if(!record) {
+        return;
+    }
+
+    fprintf(record,
+            "%u %.3f %.3f %.3f %.3f %.3f %.3f\n",
+            time,
+            position.get_x(),
+            position.get_y(),
+            position.get_z(),
+            angle.get_x(),
+            angle.get_y(),
+            angle.get_z());
+}
+
+// Where the track has the camera at the given time, looking for the
+// keyframe from the given one on. Playback nearly always moves forward a
+// little at a time, so wherever the last lookup left off is a good place
+// to start. Returns the keyframe it ended up at, or the last one once the
+// track has run out.
+static unsigned int lookup(unsigned int time,
+                           unsigned int from,
+                           gl_vector3 *position,
+                           gl_vector3 *angle)
+{
+    unsigned int last;
+    unsigned int before;
+    unsigned int after;
+    float delta;
+
+    last = keys.size() - 1;
+    if(time >= keys[last].time) {
+        *position = keys[last].position;
+        *angle = keys[last].angle;
+        return last;
+    }
+
+    // A track doesn't have to start at zero, and before it starts we just
+    // sit on the first keyframe
+    if(time <= keys[0].time) {
+        *position = keys[0].position;
+        *angle = keys[0].angle;
+        return 0;
+    }
+
+    if((from > last) || (time < keys[from].time)) {
+        from = 0;
+    }
+
+    while((from < last) && (keys[from + 1].time <= time)) {
+        from++;
+    }
+
+    before = (from > 0) ? (from - 1) : 0;
+    after = MIN(from + 2, last);
+    delta = (float)(time - keys[from].time)
+        / (float)(keys[from + 1].time - keys[from].time);
+
+    *position = spline(keys[before].position,
+                       keys[from].position,
+                       keys[from + 1].position,
+                       keys[after].position,
+                       delta);
+
+    *angle = spline(keys[before].angle,
+                    keys[from].angle,
+                    keys[from + 1].angle,
+                    keys[after].angle,
+                    delta);
+
+    return from;
+}
+
+// Where the track has the camera at the given time. False once it's run
+// past the end, where it stays on the last keyframe.
+bool TrackReplay(unsigned int time, gl_vector3 *position, gl_vector3 *angle)
+{
+    if(keys.empty()) {
+        return false;
+    }
+
+    cursor = lookup(time, cursor, position, angle);
+
+    return time < keys.back().time;
+}
+
+// The same, for looking ahead. Playback doesn't move, so the next frame
+// still picks up where the last one left off.
+bool TrackPeek(unsigned int time, gl_vector3 *position, gl_vector3 *angle)
+{
+    if(keys.empty()) {
+        return false;
+    }
+
+    lookup(time, cursor, position, angle);
+
+    return time < keys.back().time;
+}
+
+// Go back to the start, so the next lookup searches from the first keyframe
+void TrackRewind(void)
+{
+    cursor = 0;
+}
+
+void TrackTerm(void)
+{
+    if(record) {
+        fclose(record);
+        record = NULL;
+    }
+
+    keys.clear();
+    cursor = 0;
+}
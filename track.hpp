@@ -0,0 +1,14 @@
+#ifndef TRACK_HPP_
+#define TRACK_HPP_
+
+#include "gl-vector3.hpp"
+
+bool TrackLoad(char const *file);
+bool TrackRecordStart(char const *file);
+void TrackRecord(unsigned int time, gl_vector3 position, gl_vector3 angle);
+bool TrackReplay(unsigned int time, gl_vector3 *position, gl_vector3 *angle);
+bool TrackPeek(unsigned int time, gl_vector3 *position, gl_vector3 *angle);
+void TrackRewind(void);
+void TrackTerm(void);
+
+#endif /* TRACK_HPP_ */
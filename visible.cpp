@@ -19,10 +19,48 @@
 #include "camera.hpp"
 #include "macro.hpp"
 #include "math.hpp"
+#include "profile.hpp"
 #include "win.hpp"
 #include "world.hpp"
 
+// How far ahead to look along the camera's path: a view every second for
+// the next few
+#define PREFETCH_VIEWS 4
+#define PREFETCH_STEP 1000
+
 static bool vis_grid[GRID_SIZE][GRID_SIZE];
+static bool soon_grid[GRID_SIZE][GRID_SIZE];
+static visible_bounds const *live_bounds;
+static int bounds_serial;
+
+// Where a node of the tree lives. Each level is a square half as wide as
+// the one below, stored after it.
+static int node_index(int level, int x, int z)
+{
+    int first;
+    int size;
+
+    first = 0;
+    for(size = GRID_SIZE; level > 0; --level) {
+        first += size * size;
+        size /= 2;
+    }
+
+    return first + (x * size) + z;
+}
+
+static int height_index(float n)
+{
+    return CLAMP((int)(n / HEIGHT_RESOLUTION), 0, HEIGHT_SIZE - 1);
+}
+
+static void merge(gl_bbox *box, gl_bbox const &part)
+{
+    if(!VisibleBoundsEmpty(part)) {
+        box->contain_point(part.get_min());
+        box->contain_point(part.get_max());
+    }
+}
 
 bool Visible(gl_vector3 pos)
 {
@@ -34,10 +72,198 @@ bool Visible(int x, int z)
     return vis_grid[x][z];
 }
 
-void VisibleUpdate(void)
+// Is this visible now, or about to be? Anything slow to get ready, like a
+// cell's render lists or the cars on its streets, should be started here
+// so it's there by the time the camera turns to it.
+bool VisibleSoon(gl_vector3 pos)
+{
+    return soon_grid[WORLD_TO_GRID(pos.get_x())][WORLD_TO_GRID(pos.get_z())];
+}
+
+bool VisibleSoon(int x, int z)
+{
+    return soon_grid[x][z];
+}
+
+bool VisibleBoundsEmpty(gl_bbox const &box)
+{
+    return box.get_min().get_x() > box.get_max().get_x();
+}
+
+void VisibleBoundsClear(visible_bounds *bounds)
+{
+    int i;
+
+    for(i = 0; i < GRID_NODES; ++i) {
+        bounds->node[i].clear();
+    }
+
+    memset(bounds->height, 0, sizeof(bounds->height));
+}
+
+// Raise the height field under one entity's box
+void VisibleBoundsStamp(visible_bounds *bounds, gl_bbox const &box)
+{
+    int x;
+    int z;
+    int right;
+    int back;
+    float top;
+
+    top = box.get_max().get_y();
+    right = height_index(box.get_max().get_x());
+    back = height_index(box.get_max().get_z());
+    for(x = height_index(box.get_min().get_x()); x <= right; ++x) {
+        for(z = height_index(box.get_min().get_z()); z <= back; ++z) {
+            bounds->height[x][z] = MAX(bounds->height[x][z], top);
+        }
+    }
+}
+
+// Entities fill these in as each cell is compiled
+void VisibleBoundsCell(visible_bounds *bounds,
+                       int x,
+                       int z,
+                       gl_bbox const &box)
+{
+    bounds->node[node_index(0, x, z)] = box;
+}
+
+// Once every cell is in, work out the rest of the tree from them
+void VisibleBoundsBuild(visible_bounds *bounds)
+{
+    gl_bbox *box;
+    int level;
+    int size;
+    int child;
+    int x;
+    int z;
+    int i;
+
+    for(level = 1; level < VisibleTreeLevels(); ++level) {
+        size = VisibleTreeSize(level);
+        for(x = 0; x < size; ++x) {
+            for(z = 0; z < size; ++z) {
+                box = &bounds->node[node_index(level, x, z)];
+                box->clear();
+                for(i = 0; i < 4; ++i) {
+                    child = node_index(level - 1,
+                                       (x * 2) + (i / 2),
+                                       (z * 2) + (i % 2));
+
+                    merge(box, bounds->node[child]);
+                }
+            }
+        }
+    }
+}
+
+// The bounds the rest of these answer from: the city on screen's, once
+// it's compiled
+void VisibleBoundsUse(visible_bounds const *bounds)
+{
+    live_bounds = bounds;
+    bounds_serial++;
+}
+
+// Changes whenever there are new bounds, so anything worked out from the
+// old ones can be redone
+int VisibleBoundsSerial(void)
+{
+    return bounds_serial;
+}
+
+// Level 0 is the cells themselves, and the top level is one node holding
+// the whole city
+int VisibleTreeLevels(void)
+{
+    int levels;
+    int size;
+
+    levels = 0;
+    for(size = GRID_SIZE; size > 0; size /= 2) {
+        levels++;
+    }
+
+    return levels;
+}
+
+// How many nodes across a level of the tree is
+int VisibleTreeSize(int level)
+{
+    return GRID_SIZE >> level;
+}
+
+gl_bbox VisibleTreeBounds(int level, int x, int z)
+{
+    gl_bbox box;
+
+    if(!live_bounds) {
+        box.clear();
+        return box;
+    }
+
+    return live_bounds->node[node_index(level, x, z)];
+}
+
+gl_bbox VisibleCellBounds(int x, int z)
+{
+    return VisibleTreeBounds(0, x, z);
+}
+
+// How high the tallest thing at this spot reaches
+float VisibleHeight(float x, float z)
+{
+    if(!live_bounds) {
+        return 0.0f;
+    }
+
+    return live_bounds->height[height_index(x)][height_index(z)];
+}
+
+// The same, for anywhere within a square around the spot
+float VisibleHeightNear(float x, float z, float radius)
+{
+    int i;
+    int j;
+    int right;
+    int back;
+    float top;
+
+    if(!live_bounds) {
+        return 0.0f;
+    }
+
+    top = 0.0f;
+    right = height_index(x + radius);
+    back = height_index(z + radius);
+    for(i = height_index(x - radius); i <= right; ++i) {
+        for(j = height_index(z - radius); j <= back; ++j) {
+            top = MAX(top, live_bounds->height[i][j]);
+        }
+    }
+
+    return top;
+}
+
+// How high the tallest thing in the cell reaches
+float VisibleCellHeight(int x, int z)
+{
+    gl_bbox box;
+
+    box = VisibleCellBounds(x, z);
+    if(VisibleBoundsEmpty(box)) {
+        return 0.0f;
+    }
+
+    return box.get_max().get_y();
+}
+
+// Mark the cells that can be seen from one place looking one way
+static void mark(bool grid[GRID_SIZE][GRID_SIZE],
+                 gl_vector3 position,
+                 gl_vector3 angle)
 {
-    gl_vector3 angle;
-    gl_vector3 position;
     int x;
     int y;
     int grid_x;
@@ -49,16 +275,14 @@ void VisibleUpdate(void)
     float angle_to;
     float angle_diff;
     float target_x;
-    float target_z;
-
-    // Clear the visibility table
-    memset(vis_grid, '0', sizeof(vis_grid));
+    float targets_x[GRID_SIZE];
+    float targets_z[GRID_SIZE];
+    float angles_to[GRID_SIZE];
 
     // Calculate which cell the camera is in
-    angle = camera_angle();
-    position = camera_position();
     grid_x = WORLD_TO_GRID(position.get_x());
     grid_z = WORLD_TO_GRID(position.get_z());
+    angle.set_y(MathAngle(angle.get_y()));
 
     // Cells directly adjacent to the camera might technically fall out of the
     // fov, but still have a few objects poking into screenspace when looking up
@@ -102,46 +326,84 @@ void VisibleUpdate(void)
                 continue;
             }
 
-            vis_grid[x][y] = true;
+            grid[x][y] = true;
         }
     }
 
     // Doesn't matter where we are facing, objects in current cell are always
     // visible
-    vis_grid[grid_x][grid_z] = true;
+    if((grid_x >= 0) && (grid_x < GRID_SIZE)
+       && (grid_z >= 0) && (grid_z < GRID_SIZE)) {
+        grid[grid_x][grid_z] = true;
+    }
 
     // Here, we look at the angle from the current camera position to
     // the cell on the grid, and home much that angle deviates from the
-    // current view angle.
+    // current view angle. A whole column of cells goes through at once.
     for(x = 0; x < GRID_SIZE; ++x) {
-        for(y = 0; y < GRID_SIZE; ++y) {
-            // If we marked it visible earlier, skip all this math
-            if(vis_grid[x][y]) {
-                continue;
-            }
+        // If the camera is to the left of this cell use the
+        // left edge
+        if(grid_x < x) {
+            target_x = (float)x * GRID_RESOLUTION;
+        }
+        else {
+            target_x = (float)(x + 1) * GRID_RESOLUTION;
+        }
 
-            // If the camera is to the left of this cell use the
-            // left edge
-            if(grid_x < x) {
-                target_x = (float)x * GRID_RESOLUTION;
-            }
-            else {
-                target_x = (float)(x + 1) * GRID_RESOLUTION;
-            }
-            
+        for(y = 0; y < GRID_SIZE; ++y) {
+            targets_x[y] = target_x;
             if(grid_z < y) {
-                target_z = (float)y * GRID_RESOLUTION;
+                targets_z[y] = (float)y * GRID_RESOLUTION;
             }
             else {
-                target_z = (float)(y + 1) * GRID_RESOLUTION;
+                targets_z[y] = (float)(y + 1) * GRID_RESOLUTION;
             }
+        }
+
+        MathAngles(targets_x,
+                   targets_z,
+                   position.get_x(),
+                   position.get_z(),
+                   angles_to,
+                   GRID_SIZE);
 
-            angle_to = 
-                10 - MathAngle(target_x, target_z, position.get_x(), position.get_z());
+        for(y = 0; y < GRID_SIZE; ++y) {
+            // If we marked it visible earlier, skip all this math
+            if(grid[x][y]) {
+                continue;
+            }
 
             // Store how many degrees the cell is to the camera
-            angle_diff = (float)fabs(MathAngleDifference(angle.get_y(), angle_to));
-            vis_grid[x][y] = (angle_diff < 45);
+            angle_to = 180 - angles_to[y];
+            angle_diff = fabsf(MathAngleDifference(angle.get_y(), angle_to));
+            grid[x][y] = (angle_diff < 45);
+        }
+    }
+}
+
+void VisibleUpdate(void)
+{
+    PROFILE("VisibleUpdate");
+    gl_vector3 positions[PREFETCH_VIEWS];
+    gl_vector3 angles[PREFETCH_VIEWS];
+    int views;
+    int i;
+    int x;
+    int y;
+
+    memset(vis_grid, 0, sizeof(vis_grid));
+    mark(vis_grid, camera_position(), camera_angle());
+
+    // Then everything the camera is about to see, where we can know that
+    memset(soon_grid, 0, sizeof(soon_grid));
+    views = camera_predict(positions, angles, PREFETCH_VIEWS, PREFETCH_STEP);
+    for(i = 0; i < views; ++i) {
+        mark(soon_grid, positions[i], angles[i]);
+    }
+
+    for(x = 0; x < GRID_SIZE; ++x) {
+        for(y = 0; y < GRID_SIZE; ++y) {
+            soon_grid[x][y] = soon_grid[x][y] || vis_grid[x][y];
         }
     }
 }
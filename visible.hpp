@@ -1,16 +1,52 @@
 #ifndef VISIBLE_HPP_
 #define VISIBLE_HPP_
 
+#include "gl-bbox.hpp"
 #include "gl-vector3.hpp"
+#include "win.hpp"
 
 #define GRID_RESOLUTION 32
 #define GRID_CELL (GRID_RESOLUTION / 2)
 #define GRID_SIZE (WORLD_SIZE / GRID_RESOLUTION)
 #define WORLD_TO_GRID(x) (int)(x / GRID_RESOLUTION)
 #define GRID_TO_WORLD(x) ((float)x * GRID_RESOLUTION)
+// Every cell, then every square of four, and so on up to the whole city
+#define GRID_NODES (((GRID_SIZE * GRID_SIZE) * 4) / 3)
+// The height field is finer than the grid, about the width of a street
+#define HEIGHT_RESOLUTION 8
+#define HEIGHT_SIZE (WORLD_SIZE / HEIGHT_RESOLUTION)
+
+// How much room a city's worth of entities takes up, cell by cell and in
+// a tree of ever bigger squares of cells. Boxes with nothing in them are
+// left cleared, with their min above their max. The height field holds
+// how high the tallest thing over each patch of ground reaches.
+struct visible_bounds {
+    gl_bbox node[GRID_NODES];
+    float height[HEIGHT_SIZE][HEIGHT_SIZE];
+};
 
 void VisibleUpdate(void);
 bool Visible(gl_vector3 pos);
 bool Visible(int x, int z);
+bool VisibleSoon(gl_vector3 pos);
+bool VisibleSoon(int x, int z);
+void VisibleBoundsClear(visible_bounds *bounds);
+void VisibleBoundsCell(visible_bounds *bounds,
+                       int x,
+                       int z,
+                       gl_bbox const &box);
+
+void VisibleBoundsStamp(visible_bounds *bounds, gl_bbox const &box);
+void VisibleBoundsBuild(visible_bounds *bounds);
+void VisibleBoundsUse(visible_bounds const *bounds);
+int VisibleBoundsSerial(void);
+bool VisibleBoundsEmpty(gl_bbox const &box);
+gl_bbox VisibleCellBounds(int x, int z);
+float VisibleCellHeight(int x, int z);
+int VisibleTreeLevels(void);
+int VisibleTreeSize(int level);
+gl_bbox VisibleTreeBounds(int level, int x, int z);
+float VisibleHeight(float x, float z);
+float VisibleHeightNear(float x, float z, float radius);
 
 #endif /* VISIBLE_HPP_ */
@@ -20,11 +20,15 @@
 #include "entity.hpp"
 #include "ini.hpp"
 #include "macro.hpp"
+#include "math.hpp"
+#include "profile.hpp"
+#include "quality.hpp"
 #include "random.hpp"
 #include "render.hpp"
 #include "texture.hpp"
 #include "visible.hpp"
 #include "win.hpp"
+#include "worker.hpp"
 #include "world.hpp"
 
 #define MOUSE_MOVEMENT 0.5f
@@ -60,6 +64,11 @@ void AppQuit()
 
 void AppUpdate()
 {
+    PROFILE("AppUpdate");
+
+    ProfileUpdate();
+    IniUpdate();
+    QualityUpdate();
     camera_update();
     EntityUpdate();
     WorldUpdate();
@@ -71,7 +80,12 @@ void AppUpdate()
 
 void AppInit(void)
 {
+    IniInit();
+    ProfileInit();
+    MathInit();
     RandomInit(time(NULL));
+    WorkerInit(IniInt("Threads"));
+    QualityInit();
     camera_init();
     RenderInit();
     TextureInit();
@@ -82,8 +96,11 @@ void AppTerm(void)
 {
     TextureTerm();
     WorldTerm();
+    WorkerTerm();
     RenderTerm();
     camera_term();
+    ProfileTerm();
+    IniTerm();
     WinTerm();
 }
 
@@ -100,7 +117,16 @@ int main(int argc, char *argv[])
     // glutKeyboardFunc(keyboard);
     // glutSpecialFunc(keyboard_s);
 
+    if((argc > 1) && !strcmp(argv[1], "--math-benchmark")) {
+        MathBenchmark();
+        return 0;
+    }
+
+    IniArgs(argc, argv);
     AppInit();
+    if((argc > 1) && !strcmp(argv[1], "--benchmark")) {
+        QualityBenchmark();
+    }
     
     // glutMainLoop();
     
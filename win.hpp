@@ -11,12 +11,6 @@
 // Do we hide scene building behind a loading screen or show it?
 #define LOADING_SCREEN 1
 
-// Controls the density of cars
-#define CARS 500
-
-// The "dead zone" along the edge of the world, with super-low detail
-#define WORLD_EDGE 200
-
 // How often to rebuild the city
 #define RESET_INTERVAL (999999) // Milliseconds
 
@@ -51,6 +45,8 @@ enum {
     WEST
 };
 
+void AppQuit(void);
+void AppUpdate(void);
 void WinPopup(char *message, ...);
 void WinTerm(void);
 bool WinInit(void);
@@ -0,0 +1,214 @@
+/*
+ * worker.cpp
+ *
+ * A handful of background threads that pull jobs off a queue. Nothing that
+ * runs here may touch OpenGL, since the context belongs to the main thread.
+ *
+ */
+
+#include "worker.hpp"
+
+#include <SDL.h>
+#include <SDL_thread.h>
+#include <unistd.h>
+
+#include "profile.hpp"
+
+#define MAX_WORKERS 16
+
+static SDL_Thread *threads[MAX_WORKERS];
+static int thread_count;
+static SDL_mutex *lock;
+static SDL_cond *wake;
+static SDL_cond *finished;
+static worker_job *queue_head;
+static worker_job *queue_tail;
+static bool quit;
+
+static int worker_main(void *unused)
+{
+    worker_job *job;
+
+    ProfileThread("worker");
+    SDL_LockMutex(lock);
+    while(!quit) {
+        if(!queue_head) {
+            SDL_CondWait(wake, lock);
+            continue;
+        }
+
+        job = queue_head;
+        queue_head = job->next;
+        if(!queue_head) {
+            queue_tail = NULL;
+        }
+
+        SDL_UnlockMutex(lock);
+        job->run(job->data);
+        SDL_LockMutex(lock);
+
+        job->queued = false;
+        job->done = true;
+        SDL_CondBroadcast(finished);
+    }
+    SDL_UnlockMutex(lock);
+
+    return 0;
+}
+
+// Queue up a job. If there are no worker threads it just runs right here.
+void WorkerSubmit(worker_job *job, void (*run)(void *data), void *data)
+{
+    job->run = run;
+    job->data = data;
+    job->done = false;
+    job->next = NULL;
+
+    if(!thread_count) {
+        job->queued = false;
+        run(data);
+        job->done = true;
+        return;
+    }
+
+    SDL_LockMutex(lock);
+    job->queued = true;
+    if(queue_tail) {
+        queue_tail->next = job;
+    }
+    else {
+        queue_head = job;
+    }
+
+    queue_tail = job;
+    SDL_CondSignal(wake);
+    SDL_UnlockMutex(lock);
+}
+
+bool WorkerDone(worker_job *job)
+{
+    bool done;
+
+    if(!thread_count) {
+        return job->done;
+    }
+
+    SDL_LockMutex(lock);
+    done = job->done;
+    SDL_UnlockMutex(lock);
+
+    return done;
+}
+
+// Block until the given job has finished. Jobs that were never submitted
+// count as finished.
+void WorkerWait(worker_job *job)
+{
+    if(!thread_count) {
+        return;
+    }
+
+    SDL_LockMutex(lock);
+    while(job->queued) {
+        SDL_CondWait(finished, lock);
+    }
+    SDL_UnlockMutex(lock);
+}
+
+// Make sure the job is done, running it right here if no thread has got
+// to it yet. For work the caller needs now, rather than sitting behind
+// whatever else is in the queue.
+void WorkerFinish(worker_job *job)
+{
+    worker_job *prev;
+    worker_job *j;
+
+    if(!thread_count) {
+        return;
+    }
+
+    SDL_LockMutex(lock);
+    prev = NULL;
+    for(j = queue_head; j && (j != job); j = j->next) {
+        prev = j;
+    }
+
+    if(j) {
+        if(prev) {
+            prev->next = job->next;
+        }
+        else {
+            queue_head = job->next;
+        }
+
+        if(queue_tail == job) {
+            queue_tail = prev;
+        }
+
+        SDL_UnlockMutex(lock);
+        job->run(job->data);
+        SDL_LockMutex(lock);
+
+        job->queued = false;
+        job->done = true;
+        SDL_CondBroadcast(finished);
+    }
+
+    while(job->queued) {
+        SDL_CondWait(finished, lock);
+    }
+    SDL_UnlockMutex(lock);
+}
+
+// Zero threads means one for every core but the one the main thread has
+void WorkerInit(int count)
+{
+    int i;
+
+    if(count <= 0) {
+        count = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+        if(count < 1) {
+            count = 1;
+        }
+    }
+
+    if(count > MAX_WORKERS) {
+        count = MAX_WORKERS;
+    }
+
+    lock = SDL_CreateMutex();
+    wake = SDL_CreateCond();
+    finished = SDL_CreateCond();
+    quit = false;
+
+    for(i = 0; i < count; ++i) {
+        threads[thread_count] = SDL_CreateThread(worker_main, NULL);
+        if(threads[thread_count]) {
+            thread_count++;
+        }
+    }
+}
+
+void WorkerTerm(void)
+{
+    int i;
+
+    if(!lock) {
+        return;
+    }
+
+    SDL_LockMutex(lock);
+    quit = true;
+    SDL_CondBroadcast(wake);
+    SDL_UnlockMutex(lock);
+
+    for(i = 0; i < thread_count; ++i) {
+        SDL_WaitThread(threads[i], NULL);
+    }
+
+    thread_count = 0;
+    SDL_DestroyCond(finished);
+    SDL_DestroyCond(wake);
+    SDL_DestroyMutex(lock);
+    lock = NULL;
+}
@@ -0,0 +1,21 @@
+#ifndef WORKER_HPP_
+#define WORKER_HPP_
+
+// A unit of work for the background threads. The caller owns the struct and
+// must keep it alive until WorkerDone() says it's finished.
+struct worker_job {
+    void (*run)(void *data);
+    void *data;
+    bool queued;
+    bool done;
+    worker_job *next;
+};
+
+void WorkerInit(int threads);
+void WorkerTerm(void);
+void WorkerSubmit(worker_job *job, void (*run)(void *data), void *data);
+bool WorkerDone(worker_job *job);
+void WorkerWait(worker_job *job);
+void WorkerFinish(worker_job *job);
+
+#endif /* WORKER_HPP_ */
@@ -27,16 +27,24 @@
 #include "macro.hpp"
 #include "math.hpp"
 #include "mesh.hpp"
+#include "profile.hpp"
+#include "quality.hpp"
 #include "random.hpp"
 #include "render.hpp"
 #include "sky.hpp"
+#include "snapshot.hpp"
 #include "texture.hpp"
 #include "visible.hpp"
 #include "win.hpp"
+#include "worker.hpp"
 #include "world.hpp"
 
 #define LIGHT_COLOR_COUNT (sizeof(light_colors) / sizeof(HSL))
 
+// Re-init Random to make the same city each time.
+// Helpful when running tests.
+#define CITY_SEED 6
+
 using namespace std;
 
 struct plot {
@@ -46,6 +54,12 @@ struct plot {
     int depth;
 };
 
+enum {
+    BUILD_IDLE,
+    BUILD_RUNNING,
+    BUILD_DONE,
+};
+
 enum {
     FADE_IDLE,
     FADE_OUT,
@@ -53,6 +67,16 @@ enum {
     FADE_IN,
 };
 
+// Everything about a city that isn't an entity or a light. We keep two: the
+// one on display and the one being generated in the background.
+struct city {
+    char map[WORLD_SIZE][WORLD_SIZE];
+    gl_bbox hot_zone;
+    gl_rgba bloom_color;
+    snapshot *cache;
+    vector<char> random_state;
+};
+
 struct HSL {
     float hue;
     float sat;
@@ -89,9 +113,12 @@ static HSL light_colors[] = {
     {0.65, 0.0f, 0.6f}, // Dimmest white
 };
 
-static gl_rgba bloom_color;
+static city cities[2];
+static city *live_city = &cities[0];
+static city *next_city = &cities[1];
+static worker_job build_job;
+static int build_state;
 static long int last_update;
-static char world[WORLD_SIZE][WORLD_SIZE];
 static Sky *sky;
 static int fade_state;
 static unsigned int fade_start;
@@ -101,11 +128,15 @@ static int tower_count;
 static int blocky_count;
 static bool reset_needed;
 static int skyscrapers;
-static gl_bbox hot_zone;
 static int logo_index;
 static unsigned int start_time;
 static int scene_begin;
 
+// The knobs the city being built was started with, so they can't change
+// under the worker, and a city built with old ones can be spotted
+static quality building;
+static unsigned int building_serial;
+
 static gl_rgba get_light_color(float sat, float lum)
 {
     int index;
@@ -115,6 +146,14 @@ static gl_rgba get_light_color(float sat, float lum)
     return temp.from_hsl(light_colors[index].hue, sat, lum);
 }
 
+// Remember where the generator left off, so the main thread can carry on
+// from the same spot once this city goes on display.
+static void save_random_state(void)
+{
+    next_city->random_state.resize(RandomStateSize());
+    RandomStateGet(&next_city->random_state[0]);
+}
+
 static void claim(int x, int y, int width, int depth, int val)
 {
     int xx;
@@ -125,7 +164,7 @@ static void claim(int x, int y, int width, int depth, int val)
             int x_index = CLAMP(xx, 0, WORLD_SIZE - 1);
             int y_index = CLAMP(yy, 0, WORLD_SIZE - 1);
 
-            world[x_index][y_index] |= val;
+            next_city->map[x_index][y_index] |= val;
         }
     }
 }
@@ -140,7 +179,7 @@ static bool claimed(int x, int y, int width, int depth)
             int x_index = CLAMP(xx, 0, WORLD_SIZE - 1);
             int y_index = CLAMP(yy, 0, WORLD_SIZE - 1);
 
-            if(world[x_index][y_index]) {
+            if(next_city->map[x_index][y_index]) {
                 return true;
             }
         }
@@ -415,7 +454,7 @@ static int build_light_strip(int x1, int z1, int direction)
     length = 0;
 
     while((x2 > 0) && (x2 < WORLD_SIZE) && (z2 > 0) && (z2 < WORLD_SIZE)) {
-        if(world[x2][z2] & CLAIM_ROAD) {
+        if(next_city->map[x2][z2] & CLAIM_ROAD) {
             break;
         }
 
@@ -424,7 +463,7 @@ static int build_light_strip(int x1, int z1, int direction)
         z2 += dir_z;
     }
 
-    if(length < 10) {
+    if(length < building.light_strip_min) {
         return length;
     }
 
@@ -469,8 +508,27 @@ static int build_light_strip(int x1, int z1, int direction)
     return length;
 }
 
-static void do_reset(void)
+// Cities built with different knobs can't share a snapshot, even though
+// they start from the same seed
+static unsigned long city_key(void)
+{
+    unsigned int key;
+
+    key = CITY_SEED;
+    key = (key * 31) + building.world_edge;
+    key = (key * 31) + building.skyscrapers;
+    key = (key * 31) + building.skyscraper_attempts;
+    key = (key * 31) + building.light_strip_min;
+
+    return key;
+}
+
+// This runs on a worker thread, filling in next_city along with the pending
+// entity and light lists. It must not touch OpenGL, the textures or the cars,
+// since the city on screen is still using them.
+static void generate(void *unused)
 {
+    PROFILE("generate");
     int x;
     int y;
     int width;
@@ -487,30 +545,37 @@ static void do_reset(void)
     float east_street;
     float south_street;
 
-    // Re-init Random to make the same city each time.
-    // Helpful when running tests.
-    RandomInit(6);
-    reset_needed = false;
+    RandomInit(CITY_SEED);
     broadway_done = false;
     skyscrapers = 0;
     logo_index = 0;
-    scene_begin = 0;
     modern_count = 0;
     blocky_count = 0;
     tower_count = 0;
-    hot_zone.clear();
-    EntityClear();
-    LightClear();
-    CarClear();
-    TextureReset();
+    next_city->hot_zone.clear();
 
     // Pink a tint for the bloom
-    bloom_color = get_light_color(0.5f + ((float)RandomVal(10) / 20.0f), 0.75f);
+    next_city->bloom_color =
+        get_light_color(0.5f + ((float)RandomVal(10) / 20.0f), 0.75f);
+
+    // If we've built this city before, just pick it up off the disk
+    next_city->cache = SnapshotLoad(city_key(),
+                                    &next_city->map[0][0],
+                                    &next_city->hot_zone,
+                                    &next_city->bloom_color);
+
+    if(next_city->cache) {
+        save_random_state();
+        return;
+    }
+
     gl_rgba temp;
     light_color = temp.from_hsl(0.11f, 1.0f, 0.65f);
-    memset(world, '0', WORLD_SIZE * WORLD_SIZE);
-    y = WORLD_EDGE;
-    for(/* empty */; y < (WORLD_SIZE - WORLD_EDGE); y += RandomVal(25) + 25) {
+    memset(next_city->map, 0, WORLD_SIZE * WORLD_SIZE);
+    y = building.world_edge;
+    for(/* empty */;
+        y < (WORLD_SIZE - building.world_edge);
+        y += RandomVal(25) + 25) {
         if(!broadway_done && (y > (WORLD_HALF - 20))) {
             build_road(0, y, WORLD_SIZE, 19);
             y += 20;
@@ -531,8 +596,10 @@ static void do_reset(void)
     }
 
     broadway_done = false;
-    x = WORLD_EDGE;
-    for(/* empty */; x < (WORLD_SIZE - WORLD_EDGE); x += RandomVal(25) + 25) {
+    x = building.world_edge;
+    for(/* empty */;
+        x < (WORLD_SIZE - building.world_edge);
+        x += RandomVal(25) + 25) {
         if(!broadway_done && (x > (WORLD_HALF - 20))) {
             build_road(x, 0, 19, WORLD_SIZE);
             x += 20;
@@ -555,26 +622,30 @@ static void do_reset(void)
     // high-detail hot zone in the middle of the world. Save this in a 
     // bounding box so that late we can have the camera fly around without
     // clipping through buildings.
-    hot_zone.contain_point(gl_vector3(west_street, 0.0f, north_street));
+    next_city->hot_zone.contain_point(gl_vector3(west_street,
+                                                 0.0f,
+                                                 north_street));
 
-    hot_zone.contain_point(gl_vector3(east_street, 0.0f, south_street));
+    next_city->hot_zone.contain_point(gl_vector3(east_street,
+                                                 0.0f,
+                                                 south_street));
 
     // Scan for places to put runs of streetlights on the east and west
     // size of the road
     for(x = 1; x < (WORLD_SIZE - 1); ++x) {
         for(y = 0; y < WORLD_SIZE; ++y) {
             // If this isn't a bit of sidewalk, then keep looking
-            if(!(world[x][y] & CLAIM_WALK)) {
+            if(!(next_city->map[x][y] & CLAIM_WALK)) {
                 continue;
             }
 
             // If it's used as a road, skip it.
-            if((world[x][y] & CLAIM_ROAD)) {
+            if((next_city->map[x][y] & CLAIM_ROAD)) {
                 continue;
             }
 
-            road_left = ((world[x + 1][y] & CLAIM_ROAD) != 0);
-            road_right = ((world[x - 1][y] & CLAIM_ROAD) != 0);
+            road_left = ((next_city->map[x + 1][y] & CLAIM_ROAD) != 0);
+            road_right = ((next_city->map[x - 1][y] & CLAIM_ROAD) != 0);
             
             // If the cells to our east and west are not road,
             // then we're not on a corner.
@@ -597,17 +668,17 @@ static void do_reset(void)
     for(y = 1; y < (WORLD_SIZE - 1); ++y) {
         for(x = 1; x < (WORLD_SIZE - 1); ++x) {
             // If this isn't a bit of sidewalk, then keep looking
-            if(!(world[x][y] & CLAIM_WALK)) {
+            if(!(next_city->map[x][y] & CLAIM_WALK)) {
                 continue;
             }
 
             // If it's used as a road, skip it.
-            if(world[x][y] & CLAIM_ROAD) {
+            if(next_city->map[x][y] & CLAIM_ROAD) {
                 continue;
             }
 
-            road_left = ((world[x][y + 1] & CLAIM_ROAD) != 0);
-            road_right = ((world[x][y - 1] & CLAIM_ROAD) != 0);
+            road_left = ((next_city->map[x][y + 1] & CLAIM_ROAD) != 0);
+            road_right = ((next_city->map[x][y - 1] & CLAIM_ROAD) != 0);
 
             // If the cell to our east and west is road, then we're on
             // a median. skip it
@@ -627,7 +698,8 @@ static void do_reset(void)
         
     // Scan over the center area of the map and place the big buildings
     attempts = 0;
-    while((skyscrapers < 50) && (attempts < 350)) {
+    while((skyscrapers < building.skyscrapers)
+          && (attempts < building.skyscraper_attempts)) {
         x = (WORLD_HALF / 2) + (RandomVal() % WORLD_HALF);
         y = (WORLD_HALF / 2) + (RandomVal() % WORLD_HALF);
         if(!claimed(x, y, 1, 1)) {
@@ -641,7 +713,7 @@ static void do_reset(void)
     // Now blanket the rest of the world with lesser buildings
     for(x = 0; x < WORLD_SIZE; ++x) {
         for(y = 0; y < WORLD_SIZE; ++y) {
-            if(world[CLAMP(x, 0, WORLD_SIZE)][CLAMP(y, 0, WORLD_SIZE)]) {
+            if(next_city->map[CLAMP(x, 0, WORLD_SIZE)][CLAMP(y, 0, WORLD_SIZE)]) {
                 continue;
             }
 
@@ -665,10 +737,10 @@ static void do_reset(void)
                     building_color = WorldLightColor(RandomVal());
 
                     // If we're out of the host zone use simple builings
-                    if((x < hot_zone.get_min().get_x())
-                       || (x > hot_zone.get_max().get_x())
-                       || (y < hot_zone.get_min().get_z())
-                       || (y > hot_zone.get_max().get_z())) {
+                    if((x < next_city->hot_zone.get_min().get_x())
+                       || (x > next_city->hot_zone.get_max().get_x())
+                       || (y < next_city->hot_zone.get_min().get_z())
+                       || (y > next_city->hot_zone.get_max().get_z())) {
                         height = 5 + RandomVal(height) + RandomVal(height);
 
                         new Building(BUILDING_SIMPLE,
@@ -716,16 +788,86 @@ static void do_reset(void)
 
             // Leave big gaps near the edge of the map, 
             // no need to pack detail there.
-            if((y < WORLD_EDGE) || (y > (WORLD_SIZE - WORLD_EDGE))) {
+            if((y < building.world_edge)
+               || (y > (WORLD_SIZE - building.world_edge))) {
                 y += 32;
             }
         }
 
         // Leave big gaps near the edge of the map
-        if((x < WORLD_EDGE) || (x > (WORLD_SIZE - WORLD_EDGE))) {
+        if((x < building.world_edge)
+           || (x > (WORLD_SIZE - building.world_edge))) {
             x += 28;
         }
     }
+
+    SnapshotSave(city_key(),
+                 &next_city->map[0][0],
+                 next_city->hot_zone,
+                 next_city->bloom_color);
+
+    save_random_state();
+}
+
+// Hand the next city to the worker. Leftovers from the last build have to
+// be cleared out here, since that involves OpenGL.
+static void start_build(void)
+{
+    EntityClear();
+    LightClear();
+    building = *QualityGet();
+    building_serial = QualitySerial();
+    build_state = BUILD_RUNNING;
+    WorkerSubmit(&build_job, generate, NULL);
+}
+
+// Put the finished city on screen and send the old one off to be recycled
+static void swap_worlds(void)
+{
+    city *c;
+
+    EntitySwap();
+    LightSwap();
+    CarClear();
+    TextureReset();
+
+    c = live_city;
+    live_city = next_city;
+    next_city = c;
+    SnapshotRelease(next_city->cache);
+    next_city->cache = NULL;
+
+    // The textures are built next, and should come out the same no matter
+    // which thread made the city or how long ago.
+    RandomStateSet(&live_city->random_state[0]);
+    build_state = BUILD_IDLE;
+    scene_begin = 0;
+}
+
+static void do_reset(void)
+{
+    PROFILE("do_reset");
+
+    reset_needed = false;
+
+    // A city started before the knobs changed is the wrong city
+    if((build_state != BUILD_IDLE) && (building_serial != QualitySerial())) {
+        WorkerWait(&build_job);
+        build_state = BUILD_IDLE;
+    }
+
+    // Usually the next city has been ready for a while. If not, then
+    // either start it now or wait for the one in progress.
+    if(build_state == BUILD_IDLE) {
+        start_build();
+    }
+
+    WorkerWait(&build_job);
+    if(build_state == BUILD_RUNNING) {
+        EntityPendingDone();
+    }
+
+    swap_worlds();
 }
 
 // This will return a random color which is suitable for light sources, taken
@@ -744,12 +886,12 @@ char WorldCell(int x, int y)
     int x_index = CLAMP(x, 0, WORLD_SIZE - 1);
     int y_index = CLAMP(y, 0, WORLD_SIZE - 1);
 
-    return world[x_index][y_index];
+    return live_city->map[x_index][y_index];
 }
 
 gl_rgba WorldBloomColor()
 {
-    return bloom_color;
+    return live_city->bloom_color;
 }
 
 int WorldLogoIndex()
@@ -760,11 +902,12 @@ int WorldLogoIndex()
 
 gl_bbox WorldHotZone()
 {
-    return hot_zone;
+    return live_city->hot_zone;
 }
 
 void WorldTerm(void)
 {
+    WorkerWait(&build_job);
 }
 
 void WorldReset(void)
@@ -790,10 +933,6 @@ void WorldRender()
 
     // Render a single texture over the city that shows
     // traffic lances
-    glDepthMask(false);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_BLEND);
-    glEnable(GL_TEXTURE_2D);
     glColor3f(1, 1, 1);
     glBindTexture(GL_TEXTURE_2D, 0);
     glBegin(GL_QUADS);
@@ -811,8 +950,6 @@ void WorldRender()
     glVertex3f(1024, 0, 0);
 
     glEnd();
-
-    glDepthMask(true);
 }
 
 float WorldFade(void)
@@ -825,6 +962,19 @@ int WorldSceneBegin()
     return scene_begin;
 }
 
+// The city is on screen and nothing is being built behind it. The next
+// city gets started as soon as this one is up, so that means waiting until
+// it's been generated and compiled too. After that the background is idle
+// until the next reset.
+bool WorldSettled(void)
+{
+    return ((fade_state == FADE_IDLE)
+            && (build_state == BUILD_DONE)
+            && EntityPendingReady()
+            && EntityReady()
+            && TextureReady());
+}
+
 // How long since this current iteration of the city went
 // on display
 int WorldSceneElapsed()
@@ -845,6 +995,7 @@ int WorldSceneElapsed()
 
 void WorldUpdate(void)
 {
+    PROFILE("WorldUpdate");
     unsigned fade_delta;
     int now;
 
@@ -871,7 +1022,7 @@ void WorldUpdate(void)
                 fade_current = 1.0f;
             }
             else {
-                fade_start = FADE_IDLE;
+                fade_state = FADE_IDLE;
                 fade_current = 0.0f;
                 start_time = time(NULL);
                 scene_begin = SDL_GetTicks();
@@ -898,6 +1049,21 @@ void WorldUpdate(void)
         fade_start = now;
     }
 
+    // Once the generator is done, let the entities start trickling the
+    // new city into render lists.
+    if((build_state == BUILD_RUNNING) && WorkerDone(&build_job)) {
+        EntityPendingDone();
+        build_state = BUILD_DONE;
+    }
+
+    // While this city is on display, get started on the next one
+    if((fade_state == FADE_IDLE)
+       && (build_state == BUILD_IDLE)
+       && EntityReady()
+       && TextureReady()) {
+        start_build();
+    }
+
     if((fade_state == FADE_IDLE) && (WorldSceneElapsed() > RESET_INTERVAL)) {
         WorldReset();
     }
@@ -906,10 +1072,6 @@ void WorldUpdate(void)
 void WorldInit(void)
 {
     last_update = SDL_GetTicks();
-    for(int i = 0; i < CARS; ++i) {
-        new Car();
-    }
-
     sky = new Sky();
     WorldReset();
     fade_state = FADE_OUT;
@@ -15,6 +15,7 @@ void WorldRender();
 void WorldReset(void);
 int WorldSceneBegin();
 int WorldSceneElapsed();
+bool WorldSettled(void);
 void WorldTerm(void);
 void WorldUpdate(void);
 